@@ -22,6 +22,57 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Реализация хранилища текста (см. editor_core/text_storage_impl.h). По
+#  умолчанию - сплошной буфер
+#DEFINES += TEXT_STORAGE_IMPL_GAP_BUFFER
+#DEFINES += TEXT_STORAGE_IMPL_PIECE_TABLE
+#DEFINES += TEXT_STORAGE_IMPL_ROPE
+#DEFINES += TEXT_STORAGE_IMPL_PAGED
+#DEFINES += TEXT_STORAGE_IMPL_MMAP
+
+# Индекс начал строк в хранилище текста (см. editor_core/line_index.h)
+#DEFINES += TEXT_STORAGE_LINE_INDEX
+
+# Только скалярный вариант просмотра текста (см. editor_core/text_scan.h)
+#DEFINES += TEXT_SCAN_SCALAR_ONLY
+
+# Таблица начал всех страниц документа (см. editor_core/page_formatter.h)
+#DEFINES += PAGE_FORMATTER_PAGE_INDEX
+
+# Разбивка всего текста на страницы в нескольких потоках (см.
+#  editor_core/pagination.h)
+#DEFINES += PAGINATION_THREADS
+#LIBS += -lpthread
+
+# Точка восстановления в простое клавиатуры после правки (см. editor_core/core.c)
+#DEFINES += CORE_IDLE_AUTOSAVE
+
+# Изменение строк на экране: побайтовая CRC16 вместо расчета по 8 байт (см.
+#  editor_core/crc16_table.h) или перерисовка всех пересчитанных строк без CRC
+#  (см. editor_core/page_formatter.c)
+#DEFINES += CRC16_TABLE_BYTEWISE
+#DEFINES += PAGE_FORMATTER_EXACT_LINE_CHANGES
+
+# Отладочная проверка частичного пересчета строк страницы полным пересчетом
+#  после каждой правки, расхождение - сигнал (см. editor_core/page_formatter.c)
+#DEFINES += PAGE_FORMATTER_CHECK_REFLOW
+
+# Копия кадра на дисплее: вывод только изменившихся участков строк (см.
+#  editor_core/page_formatter.h)
+#DEFINES += PAGE_FORMATTER_SHADOW_FRAME
+
+# Сдвиг вида по строкам вместо перелистывания страниц (см.
+#  editor_core/page_formatter.h)
+#DEFINES += PAGE_FORMATTER_SCROLL
+
+# Только скалярная проверка текста при перекодировании (см.
+#  editor_support/encoding.h)
+#DEFINES += ENCODING_SCALAR_ONLY
+
+# Замена концов строк загруженного текста одним видом (см.
+#  editor_core/controller.c)
+#DEFINES += CONTROLLER_NORMALIZE_ENDLS
+
 
 SOURCES += \
         main.cpp \
@@ -41,9 +92,18 @@ SOURCES += \
     editor_core/page_formatter.c \
     editor_core/text_operator.c \
     editor_core/text_storage_impl.c \
+    editor_core/text_storage_impl_gap.c \
+    editor_core/text_storage_impl_piece.c \
+    editor_core/text_storage_impl_rope.c \
+    editor_core/text_storage_impl_paged.c \
+    editor_core/text_storage_impl_mmap.c \
+    editor_core/line_index.c \
+    editor_core/text_scan.c \
+    editor_core/pagination.c \
     editor_core/text_buffer.c \
     editor_core/screen_painter.c \
     editor_support/lang_rus_eng.c \
+    editor_support/encoding.c \
     tests/test_editor_sw_support.cpp \
     editor_core/template_loader.c \
     tests/test_file.cpp
@@ -76,6 +136,14 @@ HEADERS += \
     editor_core/crc16_table.h \
     editor_core/line_buffer_support.h \
     editor_core/text_storage_impl.h \
+    editor_core/text_storage_impl_gap.h \
+    editor_core/text_storage_impl_piece.h \
+    editor_core/text_storage_impl_rope.h \
+    editor_core/text_storage_impl_paged.h \
+    editor_core/text_storage_impl_mmap.h \
+    editor_core/line_index.h \
+    editor_core/text_scan.h \
+    editor_core/pagination.h \
     editor_core/text_buffer.h \
     editor_core/screen_painter.h \
     editor_api/lpm_editor_api.h \
@@ -84,6 +152,8 @@ HEADERS += \
     editor_api/lpm_encoding_api.h \
     editor_api/lpm_meteo_api.h \
     editor_support/lang_rus_eng.h \
+    editor_support/encoding.h \
+    editor_support/encoding_tables.h \
     tests/test_editor_sw_support.h \
     editor_core/template_loader.h \
     tests/test_file.h
@@ -134,6 +134,11 @@ typedef struct LPM_EditorSettings
     LPM_EndlType defaultEndOfLineType;
     LPM_insertionInputPolicy insertionInputPolicy;
     uint8_t tabSpaceAmount;
+    // Файл с текстом в UCS-2LE для режимов правки и просмотра текста. Файл
+    //  отображается в память вместо загрузки в буфер текста, результат правки
+    //  выгружается в буфер текста, файл не меняется. NULL - текст в буфере.
+    //  Учитывается только в сборке с TEXT_STORAGE_IMPL_MMAP
+    const char * textFileName;
 } LPM_EditorSettings;
 
 /*
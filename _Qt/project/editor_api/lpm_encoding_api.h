@@ -9,7 +9,8 @@ typedef enum LPM_Encoding
     LPM_ENCODING_ASCII,
     LPM_ENCODING_KOI_7H0,
     LPM_ENCODING_KOI_7H1,
-    LPM_ENCODING_KOI_8
+    LPM_ENCODING_KOI_8,
+    LPM_ENCODING_UTF8
 } LPM_Encoding;
 
 typedef struct LPM_EncodingFxns
@@ -18,8 +19,16 @@ typedef struct LPM_EncodingFxns
     bool (*checkText)  (const LPM_Buf * text, LPM_Encoding encoding, size_t maxSize, bool ignoreSpecChars);
     void (*toUnicode)  (const LPM_Buf * text, LPM_Encoding encoding);
     void (*fromUnicode)(const LPM_Buf * text, LPM_Encoding encoding);
+    // Необязательная (может быть NULL): checkText и toUnicode за один проход.
+    //  Возвращает LPM_ENCODING_TEXT_OK или смещение в байтах первого символа,
+    //  не прошедшего проверку (текст тогда не перекодируется). Попутно
+    //  считает концы строк текста по видам в endlCount (если не NULL) -
+    //  значение действительно, только если текст прошел проверку
+    size_t (*checkTextAndToUnicode)(const LPM_Buf * text, LPM_Encoding encoding, size_t maxSize, bool ignoreSpecChars, LPM_EndlCount * endlCount);
 } LPM_EncodingFxns;
 
+#define LPM_ENCODING_TEXT_OK ((size_t)-1)
+
 static inline bool LPM_Encoding_checkText
         ( const LPM_EncodingFxns * fxns,
           const LPM_Buf * text,
@@ -46,5 +55,21 @@ static inline void LPM_Encoding_fromUnicode
     (*fxns->fromUnicode)(text, encoding);
 }
 
+static inline bool LPM_Encoding_hasCheckTextAndToUnicode(const LPM_EncodingFxns * fxns)
+{
+    return fxns->checkTextAndToUnicode != NULL;
+}
+
+static inline size_t LPM_Encoding_checkTextAndToUnicode
+        ( const LPM_EncodingFxns * fxns,
+          const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount )
+{
+    return (*fxns->checkTextAndToUnicode)(text, encoding, maxSize, ignoreSpecChars, endlCount);
+}
+
 
 #endif // LPM_ENCODING_API_H
@@ -61,6 +61,10 @@ EditorCmd CmdReader_read(CmdReader * obj)
 
 Cmd _processAndConvertToCmd(Obj * obj, const UBuf * rxBuf)
 {
+    // Клавиатура не нажималась дольше timeout
+    if(rxBuf->data[0] == UNICODE_TIMEOUT)
+        return EDITOR_CMD_TIMEOUT;
+
     if(_firstCharIsModifier(rxBuf))
     {
         _processAsHavingModifier(obj, rxBuf);
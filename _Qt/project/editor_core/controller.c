@@ -12,6 +12,7 @@
 #include "screen_painter.h"
 #include "lang_rus_eng.h"
 #include "template_loader.h"
+#include "text_scan.h"
 
 #include <string.h>
 
@@ -19,6 +20,12 @@ extern const unicode_t * editorTextShortcut;
 extern const unicode_t * editorTextTextBufferFull;
 extern const unicode_t * editorTextClipboardFull;
 
+#ifdef CONTROLLER_NORMALIZE_ENDLS
+static const unicode_t chrCr = 0x000D;
+static const unicode_t chrLf = 0x000A;
+#endif
+static const unicode_t chrEndOfText = 0x0000;
+
 static ScreenPainterTextTable screenPainterTextTable;
 
 static bool _insufficientHeapSize(const LPM_EditorSystemParams * sp);
@@ -57,12 +64,24 @@ static uint32_t _execEditorInInsertionsMode
           const LPM_EditorUserParams * up,
           const LPM_EditorSystemParams * sp );
 
+#ifdef TEXT_STORAGE_IMPL_MMAP
+static uint32_t _execEditorOnMappedFile
+        ( const Modules * m,
+          const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp );
+#endif
+
 
 
+static size_t _calcMaxTextSize
+        ( const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp );
+
 static uint32_t _prepareEditorInTextOrMeteoMode
         ( const Modules * m,
           const LPM_EditorUserParams * up,
-          const LPM_EditorSystemParams * sp );
+          const LPM_EditorSystemParams * sp,
+          TextScan_EndlCount * endlCount );
 
 
 
@@ -77,7 +96,29 @@ static uint32_t _checkTextAndTranscodeToUnicodeIfOk
           const LPM_EditorUserParams * up,
           const LPM_EditorSystemParams * sp ,
           size_t maxSize,
-          bool ignoreSpecChars );
+          bool ignoreSpecChars,
+          TextScan_EndlCount * endlCount );
+
+static uint32_t _setEndlTypeByText
+        ( const Modules * m,
+          const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp,
+          const TextScan_EndlCount * cnt );
+
+static LPM_EndlType _dominantEndlType
+        ( const TextScan_EndlCount * cnt,
+          LPM_EndlType defaultType );
+
+static size_t _endlAmount(const TextScan_EndlCount * cnt, LPM_EndlType endlType);
+
+#ifdef CONTROLLER_NORMALIZE_ENDLS
+static bool _normalizeEndls
+        ( Unicode_Buf * text,
+          size_t textLen,
+          size_t maxTextLen,
+          const TextScan_EndlCount * cnt,
+          LPM_EndlType endlType );
+#endif
 
 static uint32_t _transformToPrintFormat
         ( const Modules * m,
@@ -159,6 +200,22 @@ size_t Controller_calcDesiredHeapSize(const LPM_EditorSystemParams * p)
             _alignSize(p->settings->charBufferSize) +
             _alignSize(p->settings->copyBufferSize) +
             _alignSize(p->settings->maxTemplateAmount * sizeof(uint16_t)) +
+#ifdef TEXT_STORAGE_IMPL_ROPE
+            _alignSize(TextStorageImpl_calcHeapSize(
+                           p->settings->textBuffer.size / sizeof(unicode_t))) +
+#endif
+#ifdef TEXT_STORAGE_LINE_INDEX
+            _alignSize(LineIndex_calcHeapSize(
+                           p->settings->textBuffer.size / sizeof(unicode_t))) +
+#endif
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+            _alignSize(PageFormatter_calcPageBaseTableSize(
+                           p->settings->textBuffer.size / sizeof(unicode_t),
+                           p->settings->pageParams.lineAmount)) +
+#endif
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+            _alignSize(PageFormatter_calcShadowFrameSize(&p->settings->pageParams)) +
+#endif
             _alignSize(p->settings->pageParams.lineAmount * sizeof(LineMap)) +
             _alignSize(p->settings->pageParams.pageGroupAmount * sizeof(size_t) );
 }
@@ -223,6 +280,34 @@ Modules * _allocateModules(const LPM_EditorSystemParams * sp)
     m->pageGroupBaseTable = (size_t*)heapAddr;
     heapAddr += _alignSize(sp->settings->pageParams.pageGroupAmount * sizeof(size_t));
 
+#ifdef TEXT_STORAGE_IMPL_ROPE
+    // Разместить куски хранилища текста
+    m->textStorageImplHeap = (void*)heapAddr;
+    heapAddr += _alignSize(TextStorageImpl_calcHeapSize(
+                               sp->settings->textBuffer.size / sizeof(unicode_t)));
+#endif
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+    // Разместить индекс начал строк
+    m->lineIndexHeap = (void*)heapAddr;
+    heapAddr += _alignSize(LineIndex_calcHeapSize(
+                               sp->settings->textBuffer.size / sizeof(unicode_t)));
+#endif
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    // Разместить таблицу начал страниц
+    m->pageBaseTable = (size_t*)heapAddr;
+    heapAddr += _alignSize(PageFormatter_calcPageBaseTableSize(
+                               sp->settings->textBuffer.size / sizeof(unicode_t),
+                               sp->settings->pageParams.lineAmount));
+#endif
+
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    // Разместить копию кадра на дисплее
+    m->shadowFrameHeap = (void*)heapAddr;
+    heapAddr += _alignSize(PageFormatter_calcShadowFrameSize(&sp->settings->pageParams));
+#endif
+
     m->lineMapTable = (LineMap*)heapAddr;
 
     return m;
@@ -240,15 +325,23 @@ void _initModules
 {
     Unicode_Buf tmp;
 
+    TextScan_init(TextScan_bestVariant());
     Core_init(m->core, m, sp);
 
     CmdReader_init(m->cmdReader, &m->charBuffer, sp);
 
     tmp.data = (unicode_t*)sp->settings->textBuffer.data;
     tmp.size = sp->settings->textBuffer.size / sizeof(unicode_t);
+#ifdef TEXT_STORAGE_IMPL_ROPE
+    TextStorageImpl_setHeap(m->textStorageImpl, m->textStorageImplHeap, tmp.size);
+#endif
     TextStorageImpl_init(m->textStorageImpl, &tmp);
     TextStorage_init(m->textStorage, m);
 
+    // Куча очищается только в конце Controller_exec, а драйвер может не
+    //  заполнить необязательные функции - они должны остаться NULL
+    memset(m->encodingFxns, 0, sizeof(*m->encodingFxns));
+
     LPM_SupportFxns fxns;
     fxns.lang     = m->langFxns;
     fxns.encoding = m->encodingFxns;
@@ -338,15 +431,36 @@ uint32_t _execEditorInTextOrMeteoMode
 {
     uint32_t result = LPM_EDITOR_OK;
 
+#ifdef TEXT_STORAGE_IMPL_MMAP
+    if( sp->settings->textFileName != NULL &&
+        ( up->mode == LPM_EDITOR_MODE_TEXT_EDIT ||
+          up->mode == LPM_EDITOR_MODE_TEXT_VIEW ) )
+        return _execEditorOnMappedFile(m, up, sp);
+#endif
+
+    // Концы строк загруженного текста считаются при его проверке, в новом
+    //  тексте их нет
+    TextScan_EndlCount endlCount = { 0, 0, 0 };
     if( up->mode == LPM_EDITOR_MODE_TEXT_NEW ||
         up->mode == LPM_EDITOR_MODE_METEO_NEW )
         TextStorage_clear(m->textStorage, true);
     else
-        result = _prepareEditorInTextOrMeteoMode(m, up, sp);
+        result = _prepareEditorInTextOrMeteoMode(m, up, sp, &endlCount);
 
     if(result != LPM_EDITOR_OK)
         return result;
 
+    // Текст должен поместиться в буфер текста и после перекодирования,
+    //  загруженный текст уже проверен на этот размер
+    size_t maxTextSize = _calcMaxTextSize(up, sp);
+    if(maxTextSize < sp->settings->textBuffer.size)
+        TextStorageImpl_setMaxSize(m->textStorageImpl, maxTextSize/sizeof(unicode_t));
+
+    // У метеосообщений концы строк задает формат
+    uint32_t warnings = LPM_EDITOR_OK;
+    if(!_modeIsOneOfMeteoModes(up->mode))
+        warnings = _setEndlTypeByText(m, up, sp, &endlCount);
+
     if( up->mode == LPM_EDITOR_MODE_TEXT_VIEW ||
         up->mode == LPM_EDITOR_MODE_METEO_VIEW )
         Core_setReadOnly(m->core);
@@ -354,8 +468,60 @@ uint32_t _execEditorInTextOrMeteoMode
     result = _execEditor(m);
 
     result |= _shutDownEditorInTextOrMeteoMode(m, up, sp);
+    return result | warnings;
+}
+
+#ifdef TEXT_STORAGE_IMPL_MMAP
+uint32_t _execEditorOnMappedFile
+        ( const Modules * m,
+          const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp )
+{
+    // Файл правится только в UCS-2LE, и его текст не проверяется на
+    //  допустимые символы: проверка и перекодирование прочитали бы его целиком
+    if(up->beginEncoding != LPM_ENCODING_UNICODE_UCS2LE)
+        return LPM_EDITOR_ERROR_BAD_ENCODING;
+
+    bool viewMode = up->mode == LPM_EDITOR_MODE_TEXT_VIEW;
+    if(!TextStorageImpl_mapFile( m->textStorageImpl,
+                                 sp->settings->textFileName, !viewMode ))
+        return LPM_EDITOR_ERROR_FLASH_READ;
+
+    // Текст должен поместиться в буфер текста и после перекодирования, как и
+    //  загруженный в буфер: больший текст не выгрузится в конечной кодировке
+    size_t maxTextSize = _calcMaxTextSize(up, sp);
+    if(!viewMode && maxTextSize < sp->settings->textBuffer.size)
+    {
+        if(TextStorageImpl_endOfText(m->textStorageImpl) > maxTextSize/sizeof(unicode_t))
+        {
+            TextStorageImpl_unmapFile(m->textStorageImpl);
+            return LPM_EDITOR_ERROR_BAD_ENCODING;
+        }
+        TextStorageImpl_setMaxSize(m->textStorageImpl, maxTextSize/sizeof(unicode_t));
+    }
+
+    // Концы строк тоже не считаются, чтобы не читать файл: без явного типа берется
+    //  тип по умолчанию, а если не задан и он - CR LF
+    LPM_EndlType endlType = up->endlType != LPM_ENDL_TYPE_AUTO ?
+                up->endlType : sp->settings->defaultEndOfLineType;
+    if(endlType == LPM_ENDL_TYPE_AUTO)
+        endlType = LPM_ENDL_TYPE_CRLF;
+    Core_setEndlType(m->core, endlType);
+
+    // Страницы файла читаются только при выводе
+    Core_startAtTextBegin(m->core);
+    if(viewMode)
+        Core_setReadOnly(m->core);
+
+    uint32_t result = _execEditor(m);
+    TextStorageImpl_unmapFile(m->textStorageImpl);
+
+    // При просмотре текст в буфер текста не выгружался
+    if(!viewMode)
+        result |= _shutDownEditorInTextOrMeteoMode(m, up, sp);
     return result;
 }
+#endif
 
 uint32_t _execEditorInTemplateMode
         ( const Modules * m,
@@ -426,6 +592,7 @@ uint32_t _execEditorInInsertionsMode
         Core_setReadOnly(m->core);
 
     result = Core_exec(m->core);
+    TextStorageImpl_sync(m->textStorageImpl);
 
     if(dontSaveInsertions)
     {
@@ -442,17 +609,33 @@ uint32_t _execEditorInInsertionsMode
 }
 
 
+// Наибольший размер текста в байтах UCS-2, с которым текст после
+//  перекодирования в endEncoding помещается в буфер текста. В UTF-8 символ
+//  занимает до трех байтов, поэтому текст ограничивается двумя третями буфера
+//  (хранилище может заполнить его без нуля в конце, а в UTF-8 нуль нужен)
+size_t _calcMaxTextSize
+        ( const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp )
+{
+    size_t size = sp->settings->textBuffer.size;
+    if(up->endEncoding == LPM_ENCODING_UTF8 && size != 0)
+        size = (size - 1) / 3 * sizeof(unicode_t);
+    return size;
+}
+
 uint32_t _prepareEditorInTextOrMeteoMode
         ( const Modules * m,
           const LPM_EditorUserParams * up,
-          const LPM_EditorSystemParams * sp )
+          const LPM_EditorSystemParams * sp,
+          TextScan_EndlCount * endlCount )
 {
     bool modeIsMeteo = _modeIsOneOfMeteoModes(up->mode);
-    size_t maxTextSize = modeIsMeteo ? sp->settings->maxMeteoSize :
-                                       sp->settings->textBuffer.size;
+    size_t maxTextSize = _calcMaxTextSize(up, sp);
+    if(modeIsMeteo && sp->settings->maxMeteoSize < maxTextSize)
+        maxTextSize = sp->settings->maxMeteoSize;
 
     size_t result = _checkTextAndTranscodeToUnicodeIfOk
-            (m, up, sp, maxTextSize, modeIsMeteo);
+            (m, up, sp, maxTextSize, modeIsMeteo, endlCount);
     if(result != LPM_EDITOR_OK)
         return result;
 
@@ -504,13 +687,29 @@ uint32_t _shutDownEditorInTextOrMeteoMode
     return LPM_EDITOR_OK;
 }
 
+// Концы строк в endlCount (если не NULL) считаются в том же проходе, а без
+//  него - отдельно после перекодирования
 uint32_t _checkTextAndTranscodeToUnicodeIfOk
         ( const Modules * m,
           const LPM_EditorUserParams * up,
           const LPM_EditorSystemParams * sp,
           size_t maxSize,
-          bool ignoreSpecChars )
+          bool ignoreSpecChars,
+          TextScan_EndlCount * endlCount )
 {
+    // Проверка и перекодирование за один проход, если кодировки это умеют
+    if(LPM_Encoding_hasCheckTextAndToUnicode(m->encodingFxns))
+    {
+        size_t badPos = LPM_Encoding_checkTextAndToUnicode( m->encodingFxns,
+                                                            &sp->settings->textBuffer,
+                                                            up->beginEncoding,
+                                                            maxSize,
+                                                            ignoreSpecChars,
+                                                            endlCount );
+        return badPos == LPM_ENCODING_TEXT_OK ? LPM_EDITOR_OK :
+                                                LPM_EDITOR_ERROR_BAD_ENCODING;
+    }
+
     if(!LPM_Encoding_checkText( m->encodingFxns,
                                 &sp->settings->textBuffer,
                                 up->beginEncoding,
@@ -522,9 +721,145 @@ uint32_t _checkTextAndTranscodeToUnicodeIfOk
                             &sp->settings->textBuffer,
                             up->beginEncoding );
 
+    if(endlCount != NULL)
+    {
+        Unicode_Buf text;
+        _lpmBufToUnicodeBuf(&text, &sp->settings->textBuffer);
+        TextScan_countEndlTypes( text.data,
+                                 TextScan_findEndOfText(text.data, text.data + text.size),
+                                 chrEndOfText, endlCount );
+    }
+
     return LPM_EDITOR_OK;
 }
 
+/*
+ * Конец строки для нового текста: заданный пользователем или, для
+ *  LPM_ENDL_TYPE_AUTO, самый частый в загруженном тексте (в тексте без концов
+ *  строк и при равенстве - из настроек). Концы строк других видов дают
+ *  предупреждение LPM_EDITOR_WARNING_DIFF_ENDLS. С CONTROLLER_NORMALIZE_ENDLS
+ *  они заменяются на месте выбранным, и предупреждения нет, если текст после
+ *  замены поместился в буфер и не превысил размер из _calcMaxTextSize (иначе
+ *  текст остается как есть). Концы строк cnt посчитаны при проверке текста,
+ *  сам текст просматривается только для замены
+ */
+uint32_t _setEndlTypeByText
+        ( const Modules * m,
+          const LPM_EditorUserParams * up,
+          const LPM_EditorSystemParams * sp,
+          const TextScan_EndlCount * cnt )
+{
+    LPM_EndlType endlType = up->endlType != LPM_ENDL_TYPE_AUTO ?
+                up->endlType :
+                _dominantEndlType(cnt, sp->settings->defaultEndOfLineType);
+    Core_setEndlType(m->core, endlType);
+
+    if(_endlAmount(cnt, endlType) == cnt->cr + cnt->lf + cnt->crLf)
+        return LPM_EDITOR_OK;
+
+#ifdef CONTROLLER_NORMALIZE_ENDLS
+    Unicode_Buf text;
+    _lpmBufToUnicodeBuf(&text, &sp->settings->textBuffer);
+    const unicode_t * end = TextScan_findEndOfText(text.data, text.data + text.size);
+    size_t maxTextLen = _calcMaxTextSize(up, sp) / sizeof(unicode_t);
+    if(_normalizeEndls(&text, end - text.data, maxTextLen, cnt, endlType))
+        return LPM_EDITOR_OK;
+#endif
+    return LPM_EDITOR_WARNING_DIFF_ENDLS;
+}
+
+LPM_EndlType _dominantEndlType
+        ( const TextScan_EndlCount * cnt,
+          LPM_EndlType defaultType )
+{
+    static const LPM_EndlType endlTypeTable[] =
+    {
+        LPM_ENDL_TYPE_CRLF,
+        LPM_ENDL_TYPE_LF,
+        LPM_ENDL_TYPE_CR
+    };
+
+    LPM_EndlType endlType = defaultType != LPM_ENDL_TYPE_AUTO ?
+                defaultType : LPM_ENDL_TYPE_CRLF;
+    for(size_t i = 0; i < sizeof(endlTypeTable)/sizeof(endlTypeTable[0]); i++)
+        if(_endlAmount(cnt, endlTypeTable[i]) > _endlAmount(cnt, endlType))
+            endlType = endlTypeTable[i];
+    return endlType;
+}
+
+size_t _endlAmount(const TextScan_EndlCount * cnt, LPM_EndlType endlType)
+{
+    switch(endlType)
+    {
+    case LPM_ENDL_TYPE_CR:   return cnt->cr;
+    case LPM_ENDL_TYPE_LF:   return cnt->lf;
+    case LPM_ENDL_TYPE_CRLF: return cnt->crLf;
+    default:                 return 0;
+    }
+}
+
+#ifdef CONTROLLER_NORMALIZE_ENDLS
+bool _normalizeEndls
+        ( Unicode_Buf * text,
+          size_t textLen,
+          size_t maxTextLen,
+          const TextScan_EndlCount * cnt,
+          LPM_EndlType endlType )
+{
+    unicode_t * const begin = text->data;
+    const unicode_t * const end = begin + textLen;
+
+    if(endlType != LPM_ENDL_TYPE_CRLF)
+    {
+        // Текст сжимается - вперед, участки между концами строк сдвигаются
+        //  целиком
+        const unicode_t newEndl = endlType == LPM_ENDL_TYPE_CR ? chrCr : chrLf;
+        const unicode_t * src = begin;
+        unicode_t * dst = begin;
+        for(;;)
+        {
+            const unicode_t * endl = TextScan_findEndOfLine(src, end);
+            memmove(dst, src, (endl - src) * sizeof(unicode_t));
+            dst += endl - src;
+            if(endl == end)
+                break;
+
+            src = endl + 1;
+            if(*endl == chrCr && src != end && *src == chrLf)
+                src++;
+            *dst++ = newEndl;
+        }
+        if(dst != end)
+            *dst = chrEndOfText;
+        return true;
+    }
+
+    // Текст растет - назад от нового конца, нужно место под нуль в конце, и
+    //  текст не должен превысить размер, допустимый для конечной кодировки
+    size_t newLen = textLen + cnt->cr + cnt->lf;
+    if(newLen > maxTextLen || newLen + 1 > text->size)
+        return false;
+
+    const unicode_t * src = end;
+    unicode_t * dst = begin + newLen;
+    *dst = chrEndOfText;
+    while(src != begin)
+    {
+        unicode_t chr = *--src;
+        if(chr == chrLf && src != begin && src[-1] == chrCr)
+            --src;
+        if(chr == chrCr || chr == chrLf)
+        {
+            *--dst = chrLf;
+            *--dst = chrCr;
+        }
+        else
+            *--dst = chr;
+    }
+    return true;
+}
+#endif
+
 uint32_t _transformToPrintFormat
         ( const Modules * m,
           const LPM_EditorUserParams * up,
@@ -586,7 +921,7 @@ uint32_t _loadExistedTemplateByNameFromInsertionsText
     if(result != LPM_EDITOR_OK)
         return result;
 
-    result = _checkTextAndTranscodeToUnicodeIfOk(m, up, sp, sp->settings->insertionsBuffer.size, false);
+    result = _checkTextAndTranscodeToUnicodeIfOk(m, up, sp, sp->settings->insertionsBuffer.size, false, NULL);
     if(result != LPM_EDITOR_OK)
         return result;
 
@@ -629,6 +964,11 @@ void _copyInsertionToInsertionsBuffer(const Modules * m)
 
 uint32_t _execEditor(const Modules * m)
 {
-    TextStorageImpl_recalcEndOfText(m->textStorageImpl);
-    return Core_exec(m->core);
+    TextStorage_recalcEndOfText(m->textStorage);
+    uint32_t result = Core_exec(m->core);
+
+    // Дальше с текстом работают напрямую через буфер текста из настроек,
+    //  поэтому хранилище нужно привести к сплошному виду
+    TextStorageImpl_sync(m->textStorageImpl);
+    return result;
 }
@@ -14,10 +14,21 @@
 #define FLAG_READ_ONLY          (0x02)
 #define FLAG_TEMPLATE_MODE      (0x04)
 #define FLAG_INSERTIONS_MODE    (0x08)
+#define FLAG_START_AT_TEXT_BEGIN (0x10)
+#define FLAG_HAS_NOT_SYNCED_TEXT (0x20)
+
+// Объем работы в простое за один таймаут клавиатуры
+#ifndef CORE_IDLE_PAGES_PER_TIMEOUT
+#define CORE_IDLE_PAGES_PER_TIMEOUT 8
+#endif
+#ifndef CORE_IDLE_LINE_INDEX_BLOCKS_PER_TIMEOUT
+#define CORE_IDLE_LINE_INDEX_BLOCKS_PER_TIMEOUT 64
+#endif
 
 typedef Core Obj;
 typedef LPM_SelectionCursor SlcCurs;
 typedef void(*CmdHandler)(Core*);
+typedef bool(*IdleTask)(Core*);
 
 static const unicode_t chrCr = 0x000D;
 static const unicode_t chrLf = 0x000A;
@@ -46,6 +57,17 @@ static void _outlineHelpCmdHandler(Core * o);
 static void _outlineStateHandler(Core * o);
 static void _timeoutCmdHandler(Core * o);
 
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+static bool _extendPageIndexIdleTask(Core * o);
+#endif
+#ifdef TEXT_STORAGE_LINE_INDEX
+static bool _rebuildLineIndexIdleTask(Core * o);
+#endif
+#ifdef CORE_IDLE_AUTOSAVE
+static bool _autosaveIdleTask(Core * o);
+#endif
+static bool _cmdChangesText(EditorCmd cmd);
+
 static bool _processEnteredChar(Core * o);
 static bool _processEnteredTab(Core * o);
 static bool _processEnteredNewLine(Core * o);
@@ -102,6 +124,26 @@ static const CmdHandler cmdHandlerTable[] =
     &_timeoutCmdHandler,
 };
 
+/*
+ * Отложенная работа в простое клавиатуры (EDITOR_CMD_TIMEOUT). За один
+ *  таймаут выполняется одна задача - первая, у которой есть работа, и ее
+ *  объем ограничен, чтобы не задерживать обработку следующей клавиши. Часов
+ *  в ядре нет, поэтому объем задается количеством работы, а не временем.
+ */
+static const IdleTask idleTaskTable[] =
+{
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    &_extendPageIndexIdleTask,
+#endif
+#ifdef TEXT_STORAGE_LINE_INDEX
+    &_rebuildLineIndexIdleTask,
+#endif
+#ifdef CORE_IDLE_AUTOSAVE
+    &_autosaveIdleTask,
+#endif
+    NULL
+};
+
 void Core_init
         ( Core * o,
           const Modules * modules,
@@ -128,6 +170,9 @@ uint32_t Core_exec(Core * o)
         else if(cmd < __EDITOR_NO_CMD)
             (*(cmdHandlerTable[cmd]))(o);
 
+        if(_cmdChangesText(cmd) && !_readOnlyMode(o))
+            o->flags |= FLAG_HAS_NOT_SYNCED_TEXT;
+
         if(TextStorage_needToSync(o->modules->textStorage))
             _syncTextStorage(o);
     }
@@ -136,6 +181,11 @@ uint32_t Core_exec(Core * o)
     return LPM_EDITOR_OK;
 }
 
+void Core_setEndlType(Core * o, LPM_EndlType endlType)
+{
+    o->endlType = endlType;
+}
+
 void Core_setReadOnly(Core * o)
 {
     o->flags |= FLAG_READ_ONLY;
@@ -151,6 +201,11 @@ void Core_setInsertionsMode(Core * o)
     o->flags |= FLAG_INSERTIONS_MODE;
 }
 
+void Core_startAtTextBegin(Core * o)
+{
+    o->flags |= FLAG_START_AT_TEXT_BEGIN;
+}
+
 void Core_checkTemplateFormat(Core * o, uint32_t * badPageMap)
 {
     (void)o;
@@ -165,8 +220,9 @@ bool Core_checkInsertionFormatAndReadNameIfOk(Core * o, uint16_t * templateName)
 
 void _prepare(Obj * o)
 {
-    size_t endOfText = TextStorage_endOfText(o->modules->textStorage);
-    o->textCursor.pos = endOfText;
+    // Переход в конец размечает весь текст до него
+    o->textCursor.pos = (o->flags & FLAG_START_AT_TEXT_BEGIN) ?
+                0 : TextStorage_endOfText(o->modules->textStorage);
     o->textCursor.len = 0;
     PageFormatter_startWithPageAtTextPosition(o->modules->pageFormatter, &o->textCursor);
     PageFormatter_updateDisplay(o->modules->pageFormatter);
@@ -333,9 +389,18 @@ void _undoHandler(Core * o)
 
 void _recvHandler(Core * o)
 {
+    // Текст не менялся - восстанавливать нечего
+    if(_readOnlyMode(o))
+        return;
+
     TextStorage_recv(o->modules->textStorage, &o->textCursor);
     _setHasActionToUndo(o, false);
-    PageFormatter_updatePageWhenTextChanged(o->modules->pageFormatter, &o->textCursor);
+    // Снимок возвращает весь текст, в т.ч. до текущей страницы - страницы
+    //  нужно разметить заново
+    if(TextStorage_changes(o->modules->textStorage)->known)
+        PageFormatter_updatePageWhenTextChanged(o->modules->pageFormatter, &o->textCursor);
+    else
+        PageFormatter_startWithPageAtTextPosition(o->modules->pageFormatter, &o->textCursor);
     PageFormatter_updateDisplay(o->modules->pageFormatter);
 }
 
@@ -352,7 +417,46 @@ void _outlineStateHandler(Core * o)
 
 void _timeoutCmdHandler(Core * o)
 {
-    (void)o;
+    const IdleTask * task = idleTaskTable;
+    for( ; *task != NULL; task++)
+        if((*(*task))(o))
+            break;
+}
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+bool _extendPageIndexIdleTask(Core * o)
+{
+    return PageFormatter_extendPageIndex(o->modules->pageFormatter, CORE_IDLE_PAGES_PER_TIMEOUT);
+}
+#endif
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+// Индекс строк строится заранее, а не при первом запросе, и по частям: за
+//  таймаут - не больше CORE_IDLE_LINE_INDEX_BLOCKS_PER_TIMEOUT блоков
+bool _rebuildLineIndexIdleTask(Core * o)
+{
+    return TextStorage_rebuildLineIndexStep( o->modules->textStorage,
+                                             CORE_IDLE_LINE_INDEX_BLOCKS_PER_TIMEOUT );
+}
+#endif
+
+#ifdef CORE_IDLE_AUTOSAVE
+// Точка восстановления ставится на текст, измененный после прошлой
+bool _autosaveIdleTask(Core * o)
+{
+    if(!(o->flags & FLAG_HAS_NOT_SYNCED_TEXT))
+        return false;
+    _syncTextStorage(o);
+    return true;
+}
+#endif
+
+bool _cmdChangesText(EditorCmd cmd)
+{
+    return cmd == EDITOR_CMD_TEXT_CHANGED ||
+            cmd == EDITOR_CMD_PASTE ||
+            cmd == EDITOR_CMD_CUT ||
+            cmd == EDITOR_CMD_UNDO;
 }
 
 bool _processEnteredChar(Core * o)
@@ -760,6 +864,7 @@ bool _hasNotActionToUndo(Core * o)
 void _syncTextStorage(Core * o)
 {
     test_beep();
+    o->flags &= ~FLAG_HAS_NOT_SYNCED_TEXT;
     TextStorage_sync
             ( o->modules->textStorage,
               PageFormatter_getCurrPagePos(o->modules->pageFormatter) );
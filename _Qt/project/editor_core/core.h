@@ -23,9 +23,12 @@ void Core_init
 
 uint32_t Core_exec(Core * o);
 
+void Core_setEndlType(Core * o, LPM_EndlType endlType);
 void Core_setReadOnly(Core * o);
 void Core_setTemplateMode(Core * o);
 void Core_setInsertionsMode(Core * o);
+// Работа начинается с начала текста, а не с конца
+void Core_startAtTextBegin(Core * o);
 void Core_checkTemplateFormat(Core * o, uint32_t * badPageMap);
 bool Core_checkInsertionFormatAndReadNameIfOk(Core * o, uint16_t * templateName);
 
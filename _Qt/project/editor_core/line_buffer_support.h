@@ -17,6 +17,20 @@ static inline unicode_t * LineBuffer_LoadText(const Modules * m, size_t pos, siz
     return m->lineBuffer.data;
 }
 
+static inline const unicode_t * LineBuffer_ViewText(const Modules * m, size_t pos, size_t amount)
+{
+    // Если все amount символов лежат в хранилище одним участком, возвращается
+    //  указатель прямо в хранилище - только для чтения и только до следующего
+    //  обращения к хранилищу. Иначе (в т.ч. у конца текста, где за текстом
+    //  нужны нули) текст копируется в буфер строки
+
+    TextStorageImpl_Span spans[TEXT_STORAGE_IMPL_SPANS_AMOUNT];
+    if(TextStorage_readSpans(m->textStorage, pos, amount, spans) == 1)
+        if(spans[0].size == amount)
+            return spans[0].data;
+    return LineBuffer_LoadText(m, pos, amount);
+}
+
 static inline unicode_t * LineBuffer_LoadTextBack(const Modules * m, size_t pos, size_t amount)
 {
     size_t actualAmount = pos < amount ? pos : amount;
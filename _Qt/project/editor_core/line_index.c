@@ -0,0 +1,452 @@
+#include "line_index.h"
+#include "text_storage_impl.h"
+#include "text_scan.h"
+#include <string.h>
+
+/*
+ * Деревья Фенвика нумеруются с единицы: элемент i дерева хранит сумму
+ *  значений блоков (i - (i & -i)) .. (i-1). Блоки, опустевшие после удаления,
+ *  остаются в индексе с нулевым размером до перестроения или деления блока.
+ */
+
+#define BLOCK_SIZE      LINE_INDEX_BLOCK_SIZE
+#define MAX_BLOCK_SIZE  (2*LINE_INDEX_BLOCK_SIZE)
+
+static const unicode_t chrCr = 0x000D;
+static const unicode_t chrLf = 0x000A;
+
+static void _rebuild(LineIndex * o, TextStorageImpl * storage);
+static void _rebuildBlocks(LineIndex * o, TextStorageImpl * storage, size_t blocksAmount);
+static void _buildTrees(LineIndex * o, size_t usedBlocks);
+static bool _splitBlock(LineIndex * o, size_t * block, size_t size);
+static void _dropRebuiltBlocks(LineIndex * o, size_t pos);
+static void _ensureValid(LineIndex * o, TextStorageImpl * storage);
+
+static void _treeChange( size_t * tree, size_t n, size_t block,
+                         size_t oldValue, size_t newValue );
+static size_t _treePrefix(const size_t * tree, size_t block);
+static size_t _treeFind(const size_t * tree, size_t n, size_t value, size_t * before);
+static size_t _findBlock(const LineIndex * o, size_t pos, size_t * blockBegin);
+
+static void _setBlockSize(LineIndex * o, size_t block, size_t size);
+static void _recountLines( LineIndex * o, TextStorageImpl * storage,
+                           size_t block, size_t blockBegin );
+
+static size_t _readBlock( TextStorageImpl * storage,
+                          size_t begin,
+                          size_t size,
+                          unicode_t * buf );
+static size_t _countEndsOfLine( TextStorageImpl * storage,
+                                size_t begin,
+                                size_t size,
+                                unicode_t * buf );
+static bool _isEndOfLine(const unicode_t * buf, size_t i, size_t bufSize);
+
+size_t LineIndex_calcHeapSize(size_t textBufferSize)
+{
+    size_t blocksAmount = textBufferSize / BLOCK_SIZE + 1;
+    return 2 * (blocksAmount + 1) * sizeof(size_t) +
+           2 * blocksAmount * sizeof(uint16_t);
+}
+
+void LineIndex_init(LineIndex * o, void * heap, size_t textBufferSize)
+{
+    o->blocksAmount = textBufferSize / BLOCK_SIZE + 1;
+    o->sizeTree     = (size_t*)heap;
+    o->lineTree     = o->sizeTree + o->blocksAmount + 1;
+    o->blockSizes   = (uint16_t*)(o->lineTree + o->blocksAmount + 1);
+    o->blockLines   = o->blockSizes + o->blocksAmount;
+    o->usedBlocks   = 0;
+    o->rebuiltBlocks = 0;
+    o->valid        = false;
+}
+
+void LineIndex_update
+        ( LineIndex * o,
+          TextStorageImpl * storage,
+          size_t pos,
+          size_t removeLen,
+          size_t writeLen )
+{
+    if(!o->valid)
+    {
+        _dropRebuiltBlocks(o, pos);
+        return;
+    }
+
+    size_t firstBlock = o->blocksAmount;
+    size_t lastBlock  = 0;
+    size_t block;
+    size_t blockBegin;
+
+    // Удаленные символы вычитаются из блоков, в которых лежали
+    while(removeLen > 0)
+    {
+        block = _findBlock(o, pos, &blockBegin);
+        size_t cutLen = o->blockSizes[block] - (pos - blockBegin);
+        if(cutLen > removeLen)
+            cutLen = removeLen;
+
+        _setBlockSize(o, block, o->blockSizes[block] - cutLen);
+        removeLen -= cutLen;
+
+        if(block < firstBlock) firstBlock = block;
+        if(block > lastBlock)  lastBlock  = block;
+    }
+
+    // Записанные - добавляются в блок, куда попала позиция правки
+    if(writeLen > 0)
+    {
+        block = _findBlock(o, pos, &blockBegin);
+        size_t size = o->blockSizes[block] + writeLen;
+        if(size > MAX_BLOCK_SIZE)
+        {
+            if(!_splitBlock(o, &block, size))
+            {
+                LineIndex_invalidate(o);
+                return;
+            }
+
+            // Номера блоков изменились. Пересчитываются все части блока и
+            //  блок, который теперь начинается сразу за записанным текстом
+            firstBlock = block;
+            lastBlock  = _findBlock(o, pos + writeLen, &blockBegin);
+            if(lastBlock < block + size / BLOCK_SIZE - 1)
+                lastBlock = block + size / BLOCK_SIZE - 1;
+        }
+        else
+        {
+            _setBlockSize(o, block, size);
+
+            if(block < firstBlock) firstBlock = block;
+            if(block > lastBlock)  lastBlock  = block;
+        }
+    }
+
+    if(firstBlock > lastBlock)
+        return;
+
+    // Конец строки CR перед местом правки зависит от следующего символа
+    if(pos > 0)
+    {
+        block = _findBlock(o, pos-1, &blockBegin);
+        if(block < firstBlock)
+            firstBlock = block;
+    }
+
+    blockBegin = _treePrefix(o->sizeTree, firstBlock);
+    for(block = firstBlock; block <= lastBlock; block++)
+    {
+        _recountLines(o, storage, block, blockBegin);
+        blockBegin += o->blockSizes[block];
+    }
+}
+
+bool LineIndex_rebuildStep
+        ( LineIndex * o,
+          TextStorageImpl * storage,
+          size_t blocksAmount )
+{
+    if(o->valid)
+        return false;
+    _rebuildBlocks(o, storage, blocksAmount);
+    return true;
+}
+
+size_t LineIndex_linesAmount(LineIndex * o, TextStorageImpl * storage)
+{
+    _ensureValid(o, storage);
+    return _treePrefix(o->lineTree, o->blocksAmount) + 1;
+}
+
+size_t LineIndex_lineBeginPosition
+        ( LineIndex * o,
+          TextStorageImpl * storage,
+          size_t lineIndex )
+{
+    _ensureValid(o, storage);
+
+    if(lineIndex == 0)
+        return 0;
+
+    if(lineIndex > _treePrefix(o->lineTree, o->blocksAmount))
+        return TextStorageImpl_endOfText(storage);
+
+    size_t linesBefore;
+    size_t block = _treeFind(o->lineTree, o->blocksAmount, lineIndex-1, &linesBefore);
+    size_t blockBegin = _treePrefix(o->sizeTree, block);
+
+    unicode_t buf[MAX_BLOCK_SIZE + 1];
+    size_t bufSize = _readBlock(storage, blockBegin, o->blockSizes[block], buf);
+    size_t i;
+    for(i = 0; i < o->blockSizes[block]; i++)
+    {
+        if(_isEndOfLine(buf, i, bufSize))
+        {
+            linesBefore++;
+            if(linesBefore == lineIndex)
+                return blockBegin + i + 1;
+        }
+    }
+
+    return TextStorageImpl_endOfText(storage);
+}
+
+size_t LineIndex_lineIndexOf
+        ( LineIndex * o,
+          TextStorageImpl * storage,
+          size_t pos )
+{
+    _ensureValid(o, storage);
+
+    if(pos >= TextStorageImpl_endOfText(storage))
+        return _treePrefix(o->lineTree, o->blocksAmount);
+
+    size_t blockBegin;
+    size_t block = _findBlock(o, pos, &blockBegin);
+    size_t linesBefore = _treePrefix(o->lineTree, block);
+
+    unicode_t buf[MAX_BLOCK_SIZE + 1];
+    _readBlock(storage, blockBegin, o->blockSizes[block], buf);
+
+    // Символ за pos лежит в том же блоке
+    return linesBefore + TextScan_countEndsOfLine( buf, buf + (pos - blockBegin),
+                                                   buf[pos - blockBegin] );
+}
+
+void _rebuild(LineIndex * o, TextStorageImpl * storage)
+{
+    _rebuildBlocks(o, storage, o->blocksAmount);
+}
+
+// Блоки строятся по порядку, все, кроме последнего, - по BLOCK_SIZE символов.
+//  Деревья собираются из значений блоков, когда построен последний
+void _rebuildBlocks(LineIndex * o, TextStorageImpl * storage, size_t blocksAmount)
+{
+    size_t endOfText = TextStorageImpl_endOfText(storage);
+    size_t usedBlocks = endOfText / BLOCK_SIZE + 1;
+    size_t lastBlock = o->rebuiltBlocks + blocksAmount;
+    size_t i;
+
+    if(lastBlock > usedBlocks)
+        lastBlock = usedBlocks;
+
+    for(i = o->rebuiltBlocks; i < lastBlock; i++)
+    {
+        size_t blockBegin = i * BLOCK_SIZE;
+        size_t size = endOfText - blockBegin < BLOCK_SIZE ?
+                        endOfText - blockBegin : BLOCK_SIZE;
+
+        o->blockSizes[i] = (uint16_t)size;
+        o->blockLines[i] = 0;
+
+        if(size > 0)
+        {
+            unicode_t buf[MAX_BLOCK_SIZE + 1];
+            o->blockLines[i] = (uint16_t)_countEndsOfLine(storage, blockBegin, size, buf);
+        }
+    }
+
+    o->rebuiltBlocks = lastBlock;
+    if(lastBlock == usedBlocks)
+        _buildTrees(o, usedBlocks);
+}
+
+void _buildTrees(LineIndex * o, size_t usedBlocks)
+{
+    size_t i;
+
+    o->usedBlocks = usedBlocks;
+    for(i = usedBlocks; i < o->blocksAmount; i++)
+    {
+        o->blockSizes[i] = 0;
+        o->blockLines[i] = 0;
+    }
+    for(i = 0; i < o->blocksAmount; i++)
+    {
+        o->sizeTree[i+1] = o->blockSizes[i];
+        o->lineTree[i+1] = o->blockLines[i];
+    }
+
+    // Построение деревьев за линейное время: каждый элемент добавляется к
+    //  ближайшему покрывающему его элементу
+    for(i = 1; i <= o->blocksAmount; i++)
+    {
+        size_t parent = i + (i & (~i + 1));
+        if(parent <= o->blocksAmount)
+        {
+            o->sizeTree[parent] += o->sizeTree[i];
+            o->lineTree[parent] += o->lineTree[i];
+        }
+    }
+
+    o->valid = true;
+}
+
+// Блок, разросшийся до size символов, делится на size / BLOCK_SIZE блоков
+//  почти равного размера (не меньше BLOCK_SIZE и не больше MAX_BLOCK_SIZE).
+//  Пустые блоки при этом убираются, следующие блоки сдвигаются, а деревья
+//  строятся заново за линейное время. block - новый номер первой части.
+//  Строки частей не посчитаны - их пересчитывает LineIndex_update. Если
+//  блоков не хватает, возвращает false
+bool _splitBlock(LineIndex * o, size_t * block, size_t size)
+{
+    size_t partsAmount = size / BLOCK_SIZE;
+    size_t splitBlock = *block;
+    size_t usedBlocks = 0;
+    size_t i;
+
+    for(i = 0; i < o->usedBlocks; i++)
+    {
+        if(o->blockSizes[i] == 0 && i != splitBlock)
+            continue;
+        if(i == splitBlock)
+            *block = usedBlocks;
+        o->blockSizes[usedBlocks] = o->blockSizes[i];
+        o->blockLines[usedBlocks] = o->blockLines[i];
+        usedBlocks++;
+    }
+    o->usedBlocks = usedBlocks;
+
+    if(usedBlocks + partsAmount - 1 > o->blocksAmount)
+        return false;
+
+    memmove( o->blockSizes + *block + partsAmount, o->blockSizes + *block + 1,
+             (usedBlocks - *block - 1) * sizeof(uint16_t) );
+    memmove( o->blockLines + *block + partsAmount, o->blockLines + *block + 1,
+             (usedBlocks - *block - 1) * sizeof(uint16_t) );
+
+    for(i = 0; i < partsAmount; i++)
+    {
+        o->blockSizes[*block + i] = (uint16_t)(size / partsAmount +
+                                               (i < size % partsAmount ? 1 : 0));
+        o->blockLines[*block + i] = 0;
+    }
+
+    _buildTrees(o, usedBlocks + partsAmount - 1);
+    return true;
+}
+
+// Количество строк блока зависит и от первого символа за ним (CR LF), поэтому
+//  правка с позиции pos портит и блок, который кончается на pos
+void _dropRebuiltBlocks(LineIndex * o, size_t pos)
+{
+    size_t keptBlocks = pos > 0 ? (pos - 1) / BLOCK_SIZE : 0;
+    if(o->rebuiltBlocks > keptBlocks)
+        o->rebuiltBlocks = keptBlocks;
+}
+
+void _ensureValid(LineIndex * o, TextStorageImpl * storage)
+{
+    if(!o->valid)
+        _rebuild(o, storage);
+}
+
+void _treeChange( size_t * tree, size_t n, size_t block,
+                  size_t oldValue, size_t newValue )
+{
+    size_t i;
+    for(i = block + 1; i <= n; i += i & (~i + 1))
+        tree[i] = tree[i] - oldValue + newValue;
+}
+
+size_t _treePrefix(const size_t * tree, size_t block)
+{
+    size_t sum = 0;
+    size_t i;
+    for(i = block; i > 0; i -= i & (~i + 1))
+        sum += tree[i];
+    return sum;
+}
+
+size_t _treeFind(const size_t * tree, size_t n, size_t value, size_t * before)
+{
+    // Первый блок, на котором префиксная сумма превышает value
+    size_t step = 1;
+    while(step * 2 <= n)
+        step *= 2;
+
+    size_t i = 0;
+    size_t rest = value;
+    for( ; step > 0; step /= 2)
+    {
+        if(i + step <= n && tree[i + step] <= rest)
+        {
+            i += step;
+            rest -= tree[i];
+        }
+    }
+
+    *before = value - rest;
+    return i;
+}
+
+size_t _findBlock(const LineIndex * o, size_t pos, size_t * blockBegin)
+{
+    size_t block = _treeFind(o->sizeTree, o->blocksAmount, pos, blockBegin);
+
+    // Позиция в конце текста относится к последнему блоку
+    if(block >= o->usedBlocks)
+    {
+        block = o->usedBlocks - 1;
+        *blockBegin = _treePrefix(o->sizeTree, block);
+    }
+    return block;
+}
+
+void _setBlockSize(LineIndex * o, size_t block, size_t size)
+{
+    _treeChange(o->sizeTree, o->blocksAmount, block, o->blockSizes[block], size);
+    o->blockSizes[block] = (uint16_t)size;
+}
+
+void _recountLines( LineIndex * o, TextStorageImpl * storage,
+                    size_t block, size_t blockBegin )
+{
+    size_t lines = 0;
+    size_t size = o->blockSizes[block];
+
+    if(size > 0)
+    {
+        unicode_t buf[MAX_BLOCK_SIZE + 1];
+        lines = _countEndsOfLine(storage, blockBegin, size, buf);
+    }
+
+    _treeChange(o->lineTree, o->blocksAmount, block, o->blockLines[block], lines);
+    o->blockLines[block] = (uint16_t)lines;
+}
+
+size_t _readBlock( TextStorageImpl * storage,
+                   size_t begin,
+                   size_t size,
+                   unicode_t * buf )
+{
+    // Читается и символ за блоком, если он есть: от него зависит, конец ли
+    //  строки CR в конце блока
+    size_t endOfText = TextStorageImpl_endOfText(storage);
+    if(begin + size < endOfText)
+        size++;
+
+    Unicode_Buf readBuf = { buf, size };
+    TextStorageImpl_read(storage, begin, &readBuf);
+    return size;
+}
+
+size_t _countEndsOfLine( TextStorageImpl * storage,
+                         size_t begin,
+                         size_t size,
+                         unicode_t * buf )
+{
+    size_t bufSize = _readBlock(storage, begin, size, buf);
+    unicode_t nextChr = bufSize > size ? buf[size] : 0x0000;
+    return TextScan_countEndsOfLine(buf, buf + size, nextChr);
+}
+
+bool _isEndOfLine(const unicode_t * buf, size_t i, size_t bufSize)
+{
+    if(buf[i] == chrLf)
+        return true;
+    if(buf[i] != chrCr)
+        return false;
+    return (i + 1 >= bufSize) || (buf[i+1] != chrLf);
+}
@@ -0,0 +1,82 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include "lpm_unicode.h"
+
+struct TextStorageImpl;
+
+/*
+ * Индекс начал строк. Текст делится на блоки (сразу после построения - по
+ *  LINE_INDEX_BLOCK_SIZE символов), для каждого блока хранятся размер и
+ *  количество концов строк, а их префиксные суммы - в двух деревьях Фенвика.
+ *  Поэтому поиск начала строки по номеру и номера строки по позиции стоят
+ *  O(log n) плюс просмотр одного блока.
+ * Правка меняет размер и количество строк только затронутых блоков. Блок,
+ *  разросшийся больше, чем вдвое, делится на несколько, а деревья строятся
+ *  заново из значений блоков. Только если блоков для деления не хватает,
+ *  индекс помечается недействительным и строится заново при следующем
+ *  запросе. Построение можно вести и заранее,
+ *  по нескольку блоков за раз (LineIndex_rebuildStep): готовые блоки
+ *  сохраняются, пока правки идут за ними.
+ * Конец строки - символ LF или CR, за которым не следует LF. Строки
+ *  нумеруются с нуля, строка lineIndex начинается сразу за концом строки
+ *  lineIndex-1.
+ * Память под индекс запрашивается контроллером в куче (LineIndex_calcHeapSize).
+ */
+
+#ifndef LINE_INDEX_BLOCK_SIZE
+#define LINE_INDEX_BLOCK_SIZE 64
+#endif
+
+typedef struct LineIndex
+{
+    size_t * sizeTree;
+    size_t * lineTree;
+    uint16_t * blockSizes;
+    uint16_t * blockLines;
+    size_t blocksAmount;
+    size_t usedBlocks;
+    size_t rebuiltBlocks;
+    bool valid;
+} LineIndex;
+
+size_t LineIndex_calcHeapSize(size_t textBufferSize);
+void LineIndex_init(LineIndex * o, void * heap, size_t textBufferSize);
+
+// Правка: на месте removeLen символов с позиции pos записано writeLen символов
+void LineIndex_update
+        ( LineIndex * o,
+          struct TextStorageImpl * storage,
+          size_t pos,
+          size_t removeLen,
+          size_t writeLen );
+
+// Строит заново не больше blocksAmount блоков недействительного индекса.
+//  Возвращает false, если индекс уже действителен
+bool LineIndex_rebuildStep
+        ( LineIndex * o,
+          struct TextStorageImpl * storage,
+          size_t blocksAmount );
+
+size_t LineIndex_linesAmount(LineIndex * o, struct TextStorageImpl * storage);
+size_t LineIndex_lineBeginPosition
+        ( LineIndex * o,
+          struct TextStorageImpl * storage,
+          size_t lineIndex );
+size_t LineIndex_lineIndexOf
+        ( LineIndex * o,
+          struct TextStorageImpl * storage,
+          size_t pos );
+
+static inline void LineIndex_invalidate(LineIndex * o)
+{
+    o->valid = false;
+    o->rebuiltBlocks = 0;
+}
+
+static inline bool LineIndex_valid(const LineIndex * o)
+{
+    return o->valid;
+}
+
+#endif // LINE_INDEX_H
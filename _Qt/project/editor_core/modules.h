@@ -26,6 +26,18 @@ typedef struct Modules
     uint16_t * templateNameTable;
     size_t * pageGroupBaseTable;
     struct LineMap * lineMapTable;
+#ifdef TEXT_STORAGE_IMPL_ROPE
+    void * textStorageImplHeap;
+#endif
+#ifdef TEXT_STORAGE_LINE_INDEX
+    void * lineIndexHeap;
+#endif
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    size_t * pageBaseTable;
+#endif
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    void * shadowFrameHeap;
+#endif
     struct Core             * core;
     struct CmdReader        * cmdReader;
     struct PageFormatter    * pageFormatter;
@@ -24,6 +24,10 @@ typedef enum PageStatus
     PAGE_CURR,
     PAGE_NEXT,
     PAGE_PREV,
+#ifdef PAGE_FORMATTER_SCROLL
+    PAGE_SCROLL_DOWN,
+    PAGE_SCROLL_UP,
+#endif
 } PageStatus;
 
 static const unicode_t chrCr = 0x000D;
@@ -34,6 +38,7 @@ static const unicode_t chrSpace = 0x0020;
 static void _setFirstPageInGroup(Obj * o, size_t groupIndex);
 static void _setNextPage(Obj * o);
 static void _setFirstPageInNearestGroup(Obj * o, size_t pos);
+static void _setPrevPage(Obj * o);
 static bool _changePageIfNotOnCurrTextPosition(Obj * o, size_t pos);
 
 static void _fillCurrPageAttr(Obj * o, PageAttr * attr);
@@ -48,9 +53,46 @@ static size_t _calcCurrPageLen(Obj * o);
 static size_t _calcCurrPageFirstLineBase(Obj * o);
 static size_t _calcLineBase(Obj * o, size_t lineIndex);
 static bool _incPageIndex(Obj * o);
+static void _decPageIndex(Obj * o);
+static size_t _calcLineBaseBackward(Obj * o, size_t lineBase, size_t lineAmount);
+static size_t _findParagraphBase(Obj * o, size_t lineBase);
+static size_t _countLines(Obj * o, size_t lineBase, size_t endBase);
+static size_t _skipLines(Obj * o, size_t lineBase, size_t lineAmount);
+#ifndef PAGE_FORMATTER_PAGE_INDEX
 static size_t _findGroupWithNearestOffset(Obj * o, size_t pos);
+#endif
+static void _setNextPageTowards(Obj * o, size_t pos);
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+static size_t _currPageNumber(Obj * o);
+static void _setPage(Obj * o, size_t pageNumber);
+static size_t _countKnownPagesBefore(Obj * o, size_t pos);
+static bool _appendNextPageBase(Obj * o);
+static void _dropPagesAfterChanges(Obj * o);
+#endif
+static size_t _calcLineLen(Obj * o, size_t lineBase, bool * endOfTextReached);
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+static size_t _calcCurrPageBase(Obj * o);
+#endif
+
+#ifdef PAGE_FORMATTER_SCROLL
+static void _resetScroll(Obj * o);
+static bool _unscroll(Obj * o);
+static void _scrollDown(Obj * o);
+static void _scrollUp(Obj * o);
+static size_t _calcPrevPageBase(Obj * o);
+static void _scrollDisplay(Obj * o, bool up);
+static void _shiftDisplayCursorWithLines(Obj * o, bool up);
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+static void _scrollShadowFrame(Obj * o, bool up);
+#endif
+#endif
 
 static void _updateLinesMap(Obj * o);
+static void _reflowLinesMap(Obj * o);
+#ifdef PAGE_FORMATTER_CHECK_REFLOW
+static void _checkLinesMap(Obj * o);
+#endif
 
 static bool _isCurrPageFirst(Obj * o);
 static bool _isCurrPageLast(Obj * o);
@@ -61,19 +103,29 @@ static size_t _updateLineMap(Obj * o, LineMap * lineMap, size_t lineBase);
 
 static void _copyLineMap(LineMap * dst, const LineMap * src);
 static bool _lineChanged(const LineMap * before, const LineMap * after);
-static uint16_t _calcLineCrc(Obj * o, LineMap * lineMap);
+static uint16_t _calcLineCrc(const unicode_t * line, const LineMap * lineMap);
 static void _makePrevLineMapForFirstPage(LineMap * lineMap);
 
 static void _setAllLineChangedFlags(Obj * o);
 static void _resetAllLineChangedFlags(Obj * o);
 static bool _readLineChangedFlag(Obj * o, size_t lineIndex);
+static bool _readLineCursorChangedFlag(Obj * o, size_t lineIndex);
 static void _setLineChangedFlag(Obj * o, size_t lineIndex);
 
 static void _displayLine(Obj * o, size_t lineIndex, size_t lineOffset);
-static void _readDisplayedLineToBuffer(Obj * o, const LineMap * lineMap, size_t lineOffset, Unicode_Buf * lineBuf);
-static size_t _calcPositionOfDisplayXvalue(Obj * o, size_t x);
+static void _displayLineCursor(Obj * o, size_t lineIndex, size_t lineOffset);
+static void _readDisplayedLineToBuffer(Obj * o, const LineMap * lineMap, size_t lineOffset, Unicode_ConstBuf * lineBuf);
+static size_t _calcPositionOfDisplayXvalue(Obj * o, const unicode_t * line, size_t lineSize, size_t x);
 
-static void _displayCursorToLineCursor(Obj * o, size_t lineIndex, SlcCurs * lineCursor);
+static void _displayCursorToLineCursor(Obj * o, size_t lineIndex, const unicode_t * line, SlcCurs * lineCursor);
+
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+static void _invalidateShadowFrame(Obj * o);
+static void _writeLineThroughShadowFrame(Obj * o, size_t lineIndex, const Unicode_ConstBuf * lineBuf, const SlcCurs * lineCursor);
+static void _findChangedSpan(const unicode_t * before, const unicode_t * after, size_t size, size_t * begin, size_t * end);
+static void _extendSpanBySelection(const SlcCurs * lineCursor, size_t size, size_t * begin, size_t * end);
+static void _saveShadowLine(Obj * o, size_t lineIndex, const Unicode_ConstBuf * lineBuf, const SlcCurs * lineCursor);
+#endif
 
 static PageStatus _moveFlagsToDisplayCursor(Obj * o, uint32_t moveFlags, DspCurs * dspCurs);
 static void _moveCursorToLineBorder(Obj * o, uint32_t borderFlag, DspCurs * dspCurs);
@@ -148,6 +200,20 @@ void PageFormatter_init
     o->pageNavi.groupBaseTable = modules->pageGroupBaseTable;
     memset(o->pageNavi.groupBaseTable, 0, sizeof(size_t) * o->pageParams->pageGroupAmount);
     memset(o->pageStruct.lineMapTable, 0, sizeof(LineMap) * o->pageParams->lineAmount);
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    o->pageNavi.pageBaseTable = modules->pageBaseTable;
+    o->pageNavi.pagesAmount = PageFormatter_calcMaxPagesAmount(
+                TextStorage_freeSize(modules->textStorage) +
+                TextStorage_endOfText(modules->textStorage),
+                pageParams->lineAmount );
+    o->pageNavi.pageBaseTable[0] = 0;
+    o->pageNavi.pagesKnown = 1;
+#endif
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    o->shadowFrame.lineTable = modules->shadowFrameHeap;
+    o->shadowFrame.text = (unicode_t*)(o->shadowFrame.lineTable + pageParams->lineAmount);
+    _invalidateShadowFrame(o);
+#endif
 }
 
 void PageFormatter_startWithPageAtTextPosition
@@ -156,10 +222,20 @@ void PageFormatter_startWithPageAtTextPosition
 {
     DspCurs dspCurs;
     _resetAddChars(o);
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    o->pageNavi.pagesKnown = 1;
+#endif
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    _invalidateShadowFrame(o);
+#endif
+#ifdef PAGE_FORMATTER_SCROLL
+    o->scroll.pending = 0;
+#endif
     _setFirstPageInGroup(o, 0);
     _changePageIfNotOnCurrTextPosition(o, txtCurs->pos);
     _textCursorToDisplayCursor(o, &dspCurs, txtCurs);
     _copyDisplayCursor(&o->displayCursor, &dspCurs);
+    TextStorage_resetChanges(o->modules->textStorage);
 }
 
 void PageFormatter_updatePageWhenTextChanged
@@ -171,7 +247,13 @@ void PageFormatter_updatePageWhenTextChanged
     _resetAddChars(o);
     _resetAllLineChangedFlags(o);
 
-    _updateLinesMap(o);
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    _dropPagesAfterChanges(o);
+#endif
+    _reflowLinesMap(o);
+#ifdef PAGE_FORMATTER_CHECK_REFLOW
+    _checkLinesMap(o);
+#endif
     _copyDisplayCursor(&dspCurs, &o->displayCursor);
 
     if(!_changePageIfNotOnCurrTextPosition(o, txtCurs->pos))
@@ -185,6 +267,7 @@ void PageFormatter_updatePageWhenTextChanged
     }
 
     _copyDisplayCursor(&o->displayCursor, &dspCurs);
+    TextStorage_resetChanges(o->modules->textStorage);
 }
 
 
@@ -205,6 +288,14 @@ void PageFormatter_updatePageWhenCursorMoved
 
     if(pageStatus == PAGE_CURR)
         _updateLineChangedFlagsByDisplayCursor(o, &dspCurs);
+#ifdef PAGE_FORMATTER_SCROLL
+    // Прежний курсор сдвинулся вместе со строками
+    else if(pageStatus == PAGE_SCROLL_DOWN || pageStatus == PAGE_SCROLL_UP)
+    {
+        _shiftDisplayCursorWithLines(o, pageStatus == PAGE_SCROLL_DOWN);
+        _updateLineChangedFlagsByDisplayCursor(o, &dspCurs);
+    }
+#endif
     _copyDisplayCursor(&o->displayCursor, &dspCurs);
 
     _displayCursorToTextCursor(o, txtCurs);
@@ -212,6 +303,10 @@ void PageFormatter_updatePageWhenCursorMoved
 
 void PageFormatter_updateWholePage(PageFormatter * o)
 {
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    // Дисплей мог быть перерисован в обход форматера (сообщения редактора)
+    _invalidateShadowFrame(o);
+#endif
     _setAllLineChangedFlags(o);
     PageFormatter_updateDisplay(o);
 }
@@ -219,13 +314,34 @@ void PageFormatter_updateWholePage(PageFormatter * o)
 void PageFormatter_updateDisplay
         ( PageFormatter * o )
 {
+    if(o->lineChangedFlags == 0 && o->lineCursorChangedFlags == 0)
+        return;
+
+    // Все строки одной команды выводятся одним кадром
+    LPM_UnicodeDisplay_beginFrame(o->display);
+
+#ifdef PAGE_FORMATTER_SCROLL
+    if(o->scroll.pending != 0)
+    {
+        bool up = o->scroll.pending > 0;
+        LPM_UnicodeDisplay_scroll(o->display, up, up ? o->scroll.pending : -o->scroll.pending);
+        o->scroll.pending = 0;
+    }
+#endif
+
     const LineMap * lineMap = o->pageStruct.lineMapTable;
     const LineMap * end     = lineMap + o->pageParams->lineAmount;
     size_t lineBase = _calcCurrPageFirstLineBase(o);
     size_t lineIndex  = 0;
     for( ; lineMap != end; lineBase += lineMap->fullLen, lineMap++, lineIndex++)
+    {
         if(_readLineChangedFlag(o, lineIndex))
             _displayLine(o, lineIndex, lineBase);
+        else if(_readLineCursorChangedFlag(o, lineIndex))
+            _displayLineCursor(o, lineIndex, lineBase);
+    }
+
+    LPM_UnicodeDisplay_endFrame(o->display);
 }
 
 size_t PageFormatter_getCurrLinePos(PageFormatter * o)
@@ -365,6 +481,23 @@ size_t PageFormatter_fillPageWithEmptyLines
     return offset;
 }
 
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+bool PageFormatter_extendPageIndex(PageFormatter * o, size_t pagesAmount)
+{
+    // Начала страниц считаются по текущему тексту, поэтому правка, еще не
+    //  обработанная форматированием, откладывает досчет
+    const TextStorage_Changes * changes = TextStorage_changes(o->modules->textStorage);
+    if(!changes->known || changes->changed)
+        return false;
+
+    size_t pageCnt;
+    for(pageCnt = 0; pageCnt < pagesAmount; pageCnt++)
+        if(!_appendNextPageBase(o))
+            break;
+    return pageCnt > 0;
+}
+#endif
+
 void _setFirstPageInGroup(Obj * o, size_t groupIndex)
 {
     _switchToFirstPageInGroup(o, groupIndex);
@@ -384,10 +517,52 @@ void _setNextPage(Obj * o)
     _updateLinesMap(o);
 }
 
+void _setPrevPage(Obj * o)
+{
+    if(_isCurrPageFirst(o))
+    {
+        _resetAllLineChangedFlags(o);
+        return;
+    }
+
+#ifdef PAGE_FORMATTER_SCROLL
+    // Из сдвинутого вида - к началу его же страницы
+    if(_unscroll(o))
+        return;
+#endif
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    size_t pageNumber = _currPageNumber(o);
+    if(pageNumber <= o->pageNavi.pagesKnown)
+    {
+        _setPage(o, pageNumber-1);
+        return;
+    }
+#endif
+
+    // Начало страницы - начало последней строки предыдущей страницы, поэтому
+    //  предыдущая страница начинается на lineAmount строк раньше текущей
+    size_t base = _calcLineBaseBackward(o, o->pageStruct.base, o->pageParams->lineAmount);
+    _decPageIndex(o);
+    o->pageStruct.base = _isCurrPageFirst(o) ? 0 : base;
+#ifdef PAGE_FORMATTER_SCROLL
+    _resetScroll(o);
+#endif
+    _setAllLineChangedFlags(o);
+    _updateLinesMap(o);
+}
+
 void _setFirstPageInNearestGroup(Obj * o, size_t pos)
 {
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    // Предпоследняя из известных страниц, начинающихся до позиции: с нее
+    //  позиция достигается не больше, чем за один шаг вперед
+    size_t pagesBefore = _countKnownPagesBefore(o, pos);
+    _setPage(o, pagesBefore > 1 ? pagesBefore-2 : 0);
+#else
     size_t groupIndex = _findGroupWithNearestOffset(o, pos);
     _setFirstPageInGroup(o, groupIndex);
+#endif
 }
 
 bool _changePageIfNotOnCurrTextPosition(Obj * o, size_t pos)
@@ -437,7 +612,7 @@ bool _changePageIfNotOnCurrTextPositionWhenPageFirst(Obj * o, size_t pos, const
 
     // Защита от зацикливания: если достигли последней страницы, то нет смысла
     //  продолжать переключаться на следующую страницу
-    _setNextPage(o);
+    _setNextPageTowards(o, pos);
     return _isCurrPageLast(o);
 }
 
@@ -476,7 +651,7 @@ bool _changePageIfNotOnCurrTextPositionWhenPageCommon(Obj * o, size_t pos, const
     {
         // Защита от зацикливания: если достигли последней страницы, то нет смысла
         //  продолжать переключаться на следующую страницу
-        _setNextPage(o);
+        _setNextPageTowards(o, pos);
         return _isCurrPageLast(o);
     }
 
@@ -488,21 +663,45 @@ void _switchToFirstPageInGroup(Obj * o, size_t groupIndex)
     o->pageNavi.currPageIndex  = 0;
     o->pageNavi.currGroupIndex = groupIndex;
     o->pageStruct.base         = o->pageNavi.groupBaseTable[groupIndex];
+#ifdef PAGE_FORMATTER_SCROLL
+    _resetScroll(o);
+#endif
 }
 
 void _switchToNextPage(Obj * o)
 {
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    size_t prevBase = _calcCurrPageBase(o);
+#endif
     o->pageStruct.base = _calcNextPageBase(o);
+#ifdef PAGE_FORMATTER_SCROLL
+    _resetScroll(o);
+#endif
     if(_incPageIndex(o))
         o->pageNavi.groupBaseTable[o->pageNavi.currGroupIndex] =
                 o->pageStruct.base;
-}
-
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    // Начало следующей страницы запоминается, только если текущая страница -
+    //  последняя из известных
+    PageNavigation * navi = &o->pageNavi;
+    size_t pageNumber = _currPageNumber(o);
+    if( pageNumber == navi->pagesKnown && pageNumber < navi->pagesAmount &&
+            navi->pageBaseTable[pageNumber-1] == prevBase )
+        navi->pageBaseTable[navi->pagesKnown++] = o->pageStruct.base;
+#endif
+}
+
+// Следующая страница начинается с последней строки текущей. Вид, сдвинутый
+//  на scroll.lines строк, доходит до нее раньше на столько же строк
 size_t _calcNextPageBase(Obj * o)
 {
     size_t base = _calcCurrPageFirstLineBase(o);
     const LineMap * lineMap   = o->pageStruct.lineMapTable;
+#ifdef PAGE_FORMATTER_SCROLL
+    const LineMap * const end = o->pageStruct.lineMapTable+o->pageParams->lineAmount-1-o->scroll.lines;
+#else
     const LineMap * const end = o->pageStruct.lineMapTable+o->pageParams->lineAmount-1;
+#endif
     for( ; lineMap != end; lineMap++)
         base += lineMap->fullLen;
     return base;
@@ -548,6 +747,92 @@ bool _incPageIndex(Obj * o)
     return false;
 }
 
+void _decPageIndex(Obj * o)
+{
+    if(o->pageNavi.currPageIndex > 0)
+    {
+        o->pageNavi.currPageIndex--;
+    }
+    else if(o->pageNavi.currGroupIndex > 0)
+    {
+        o->pageNavi.currGroupIndex--;
+        o->pageNavi.currPageIndex = o->pageParams->pageInGroupAmount-1u;
+    }
+}
+
+// Начало строки на lineAmount строк раньше строки lineBase. Строки абзаца
+//  переносятся заново с начала абзаца, поэтому разбирается текст только от
+//  начала абзаца нужной строки
+size_t _calcLineBaseBackward(Obj * o, size_t lineBase, size_t lineAmount)
+{
+    while(lineAmount > 0 && lineBase > 0)
+    {
+        size_t paragraphBase = _findParagraphBase(o, lineBase);
+        size_t linesInParagraph = _countLines(o, paragraphBase, lineBase);
+        if(linesInParagraph >= lineAmount)
+            return _skipLines(o, paragraphBase, linesInParagraph - lineAmount);
+        lineAmount -= linesInParagraph;
+        lineBase = paragraphBase;
+    }
+    return lineBase;
+}
+
+// Абзац строки перед строкой lineBase: текст просматривается назад частями
+//  по размеру буфера строки до конца строки, не считая конца самой
+//  предыдущей строки
+size_t _findParagraphBase(Obj * o, size_t lineBase)
+{
+    size_t end = lineBase;
+    const unicode_t * pend = LineBuffer_LoadTextBack(o->modules, end, 2);
+    if(pend[-1] == chrLf)
+    {
+        end--;
+        if(pend[-2] == chrCr)
+            end--;
+    }
+    else if(pend[-1] == chrCr)
+    {
+        end--;
+    }
+
+    while(end > 0)
+    {
+        size_t amount = end < o->modules->lineBuffer.size ? end : o->modules->lineBuffer.size;
+        pend = LineBuffer_LoadTextBack(o->modules, end, amount);
+        const unicode_t * paragraph =
+                TextOperator_findParagraphBegin(o->modules->textOperator, pend-amount, pend);
+        if(paragraph != NULL)
+            return end - (size_t)(pend - paragraph);
+        end -= amount;
+    }
+    return 0;
+}
+
+// Количество строк с lineBase до endBase
+size_t _countLines(Obj * o, size_t lineBase, size_t endBase)
+{
+    bool endOfTextReached;
+    size_t lineAmount = 0;
+    while(lineBase < endBase)
+    {
+        size_t lineLen = _calcLineLen(o, lineBase, &endOfTextReached);
+        if(lineLen == 0)
+            break;
+        lineBase += lineLen;
+        lineAmount++;
+    }
+    return lineAmount;
+}
+
+size_t _skipLines(Obj * o, size_t lineBase, size_t lineAmount)
+{
+    bool endOfTextReached;
+    for( ; lineAmount > 0; lineAmount--)
+        lineBase += _calcLineLen(o, lineBase, &endOfTextReached);
+    return lineBase;
+}
+
+#ifndef PAGE_FORMATTER_PAGE_INDEX
 size_t _findGroupWithNearestOffset(Obj * o, size_t pos)
 {
     size_t * poffs = o->pageNavi.groupBaseTable + o->pageNavi.currGroupIndex;
@@ -562,6 +847,312 @@ size_t _findGroupWithNearestOffset(Obj * o, size_t pos)
     }
     return groupIndex;
 }
+#endif
+
+void _setNextPageTowards(Obj * o, size_t pos)
+{
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    // Недостающие начала страниц досчитываются до позиции, и если до нее
+    //  больше одной страницы, то переход сразу на нужную
+    PageNavigation * navi = &o->pageNavi;
+    if(!_isCurrPageLast(o))
+    {
+        while(navi->pageBaseTable[navi->pagesKnown-1] < pos)
+            if(!_appendNextPageBase(o))
+                break;
+        size_t pagesBefore = _countKnownPagesBefore(o, pos);
+        size_t pageNumber  = pagesBefore > 1 ? pagesBefore-2 : 0;
+        if(pageNumber > _currPageNumber(o) + 1)
+        {
+            _setPage(o, pageNumber);
+            return;
+        }
+    }
+#else
+    (void)pos;
+#endif
+    _setNextPage(o);
+}
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+size_t _currPageNumber(Obj * o)
+{
+    return o->pageNavi.currGroupIndex * o->pageParams->pageInGroupAmount +
+            o->pageNavi.currPageIndex;
+}
+
+void _setPage(Obj * o, size_t pageNumber)
+{
+    // Последняя группа вмещает все оставшиеся страницы (см. _incPageIndex)
+    size_t groupIndex = pageNumber / o->pageParams->pageInGroupAmount;
+    if(groupIndex > o->pageParams->pageGroupAmount-1u)
+        groupIndex = o->pageParams->pageGroupAmount-1u;
+    o->pageNavi.currGroupIndex = groupIndex;
+    o->pageNavi.currPageIndex  = pageNumber - groupIndex * o->pageParams->pageInGroupAmount;
+    o->pageStruct.base         = o->pageNavi.pageBaseTable[pageNumber];
+#ifdef PAGE_FORMATTER_SCROLL
+    _resetScroll(o);
+#endif
+    _setAllLineChangedFlags(o);
+    _updateLinesMap(o);
+}
+
+// Количество известных страниц, которые начинаются раньше позиции pos. Начала
+//  страниц возрастают, поэтому поиск двоичный
+size_t _countKnownPagesBefore(Obj * o, size_t pos)
+{
+    const size_t * const table = o->pageNavi.pageBaseTable;
+    size_t low  = 0;
+    size_t high = o->pageNavi.pagesKnown;
+    while(low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if(table[mid] < pos)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// Начало страницы за последней известной считается по длинам строк, как в
+//  _updateLinesMap, но без карт строк. Возвращает false, если последняя
+//  известная страница - последняя в тексте или таблица заполнена
+bool _appendNextPageBase(Obj * o)
+{
+    PageNavigation * navi = &o->pageNavi;
+    if(navi->pagesKnown == navi->pagesAmount)
+        return false;
+
+    bool endOfTextReached;
+    size_t lineBase = navi->pageBaseTable[navi->pagesKnown-1];
+    if(navi->pagesKnown > 1)
+        lineBase += _calcLineLen(o, lineBase, &endOfTextReached);
+
+    size_t lastLineBase = lineBase;
+    size_t lineIndex;
+    for(lineIndex = 0; lineIndex < o->pageParams->lineAmount; lineIndex++)
+    {
+        lastLineBase = lineBase;
+        lineBase += _calcLineLen(o, lineBase, &endOfTextReached);
+        if(endOfTextReached)
+            return false;
+    }
+
+    navi->pageBaseTable[navi->pagesKnown++] = lastLineBase;
+    return true;
+}
+
+// Начало страницы зависит от текста до конца ее предпоследней строки (перенос
+//  слов смотрит в следующую строку), поэтому после правки остаются только
+//  страницы, за которыми следующая страница начинается до правки
+void _dropPagesAfterChanges(Obj * o)
+{
+    const TextStorage_Changes * changes = TextStorage_changes(o->modules->textStorage);
+    PageNavigation * navi = &o->pageNavi;
+
+    if(!changes->known)
+    {
+        navi->pagesKnown = 1;
+        return;
+    }
+
+    if(!changes->changed)
+        return;
+
+    size_t pagesBefore = _countKnownPagesBefore(o, changes->begin);
+    navi->pagesKnown = pagesBefore > 1 ? pagesBefore-1 : 1;
+}
+#endif
+
+size_t _calcLineLen(Obj * o, size_t lineBase, bool * endOfTextReached)
+{
+    const unicode_t * const begin =
+            LineBuffer_ViewText(o->modules, lineBase, o->modules->lineBuffer.size);
+
+    LPM_TextLineMap textLineMap;
+    *endOfTextReached = TextOperator_analizeLine( o->modules->textOperator,
+                                                  begin,
+                                                  begin + o->modules->lineBuffer.size,
+                                                  o->pageParams->charAmount,
+                                                  &textLineMap );
+    return textLineMap.nextLine - begin;
+}
+
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+size_t _calcCurrPageBase(Obj * o)
+{
+#ifdef PAGE_FORMATTER_SCROLL
+    return o->scroll.pageBase;
+#else
+    return o->pageStruct.base;
+#endif
+}
+#endif
+
+#ifdef PAGE_FORMATTER_SCROLL
+
+// Вид совпадает со страницей (вызывается после смены страницы)
+void _resetScroll(Obj * o)
+{
+    o->scroll.pageBase = o->pageStruct.base;
+    o->scroll.lines    = 0;
+}
+
+// Вернуть вид к началу его страницы. Возвращает false, если вид не сдвинут
+bool _unscroll(Obj * o)
+{
+    if(o->scroll.lines == 0)
+        return false;
+
+    o->pageStruct.base = o->scroll.pageBase;
+    o->scroll.lines    = 0;
+    _setAllLineChangedFlags(o);
+    _updateLinesMap(o);
+    return true;
+}
+
+// Вид на строку ниже: первая строка вида уходит в строку перед видом, снизу
+//  разбирается одна новая строка. Вид, сдвинутый на lineAmount строк, -
+//  следующая страница
+void _scrollDown(Obj * o)
+{
+    PageStruct * ps = &o->pageStruct;
+    const size_t lineAmount = o->pageParams->lineAmount;
+    size_t newLineBase = _calcCurrPageFirstLineBase(o) + _calcCurrPageLen(o);
+
+    ps->base = _calcCurrPageFirstLineBase(o);
+    _copyLineMap(&ps->prevLastLine, &ps->lineMapTable[0]);
+    memmove(ps->lineMapTable, ps->lineMapTable+1, (lineAmount-1) * sizeof(LineMap));
+    ps->lastPageReached = _updateLineMap(o, &ps->lineMapTable[lineAmount-1], newLineBase);
+
+    if(++o->scroll.lines == lineAmount)
+    {
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+        size_t prevBase = o->scroll.pageBase;
+#endif
+        _resetScroll(o);
+        if(_incPageIndex(o))
+            o->pageNavi.groupBaseTable[o->pageNavi.currGroupIndex] = ps->base;
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+        PageNavigation * navi = &o->pageNavi;
+        size_t pageNumber = _currPageNumber(o);
+        if( pageNumber == navi->pagesKnown && pageNumber < navi->pagesAmount &&
+                navi->pageBaseTable[pageNumber-1] == prevBase )
+            navi->pageBaseTable[navi->pagesKnown++] = ps->base;
+#endif
+    }
+
+    _scrollDisplay(o, true);
+}
+
+// Вид на строку выше: строка перед видом становится первой строкой вида.
+//  Сверху несдвинутой страницы - последний вид предыдущей страницы
+void _scrollUp(Obj * o)
+{
+    PageStruct * ps = &o->pageStruct;
+    const size_t lineAmount = o->pageParams->lineAmount;
+    size_t prevBase = ps->base;
+
+    memmove(ps->lineMapTable+1, ps->lineMapTable, (lineAmount-1) * sizeof(LineMap));
+    _copyLineMap(&ps->lineMapTable[0], &ps->prevLastLine);
+
+    if(o->scroll.lines == 0)
+    {
+        size_t pageBase = _calcPrevPageBase(o);
+        _decPageIndex(o);
+        o->scroll.pageBase = _isCurrPageFirst(o) ? 0 : pageBase;
+        o->scroll.lines    = lineAmount-1;
+    }
+    else
+    {
+        o->scroll.lines--;
+    }
+
+    if(_isCurrPageFirst(o))
+    {
+        ps->base = 0;
+        _makePrevLineMapForFirstPage(&ps->prevLastLine);
+    }
+    else
+    {
+        ps->base = _calcLineBaseBackward(o, prevBase, 1);
+        _updateLineMap(o, &ps->prevLastLine, ps->base);
+    }
+
+    // Конец текста на виде - только в его последней строке
+    bool endOfTextReached;
+    _calcLineLen(o, _calcLineBase(o, lineAmount-1), &endOfTextReached);
+    ps->lastPageReached = endOfTextReached;
+
+    _scrollDisplay(o, false);
+}
+
+// Начало предыдущей страницы - из таблицы начал страниц, если оно там есть
+size_t _calcPrevPageBase(Obj * o)
+{
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    size_t pageNumber = _currPageNumber(o);
+    if(pageNumber <= o->pageNavi.pagesKnown)
+        return o->pageNavi.pageBaseTable[pageNumber-1];
+#endif
+    return _calcLineBaseBackward(o, o->scroll.pageBase, o->pageParams->lineAmount);
+}
+
+// Дисплей со сдвигом строк выводит только открывшуюся строку, иначе все
+//  строки выводятся заново
+void _scrollDisplay(Obj * o, bool up)
+{
+    if(!LPM_UnicodeDisplay_hasScroll(o->display))
+    {
+        _setAllLineChangedFlags(o);
+        return;
+    }
+
+    o->scroll.pending += up ? 1 : -1;
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    _scrollShadowFrame(o, up);
+#endif
+    _setLineChangedFlag(o, up ? o->pageParams->lineAmount-1 : 0);
+}
+
+void _shiftDisplayCursorWithLines(Obj * o, bool up)
+{
+    if(up)
+    {
+        o->displayCursor.begin.y--;
+        o->displayCursor.end.y--;
+    }
+    else
+    {
+        o->displayCursor.begin.y++;
+        o->displayCursor.end.y++;
+    }
+}
+
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+void _scrollShadowFrame(Obj * o, bool up)
+{
+    const size_t lineAmount = o->pageParams->lineAmount;
+    const size_t charAmount = o->pageParams->charAmount;
+    ShadowLine * lineTable = o->shadowFrame.lineTable;
+    unicode_t * text = o->shadowFrame.text;
+    if(up)
+    {
+        memmove(lineTable, lineTable+1, (lineAmount-1) * sizeof(ShadowLine));
+        memmove(text, text+charAmount, (lineAmount-1) * charAmount * sizeof(unicode_t));
+        lineTable[lineAmount-1].size = 0;
+    }
+    else
+    {
+        memmove(lineTable+1, lineTable, (lineAmount-1) * sizeof(ShadowLine));
+        memmove(text+charAmount, text, (lineAmount-1) * charAmount * sizeof(unicode_t));
+        lineTable[0].size = 0;
+    }
+}
+#endif
+
+#endif
 
 void _updateLinesMap(Obj * o)
 {    
@@ -591,8 +1182,112 @@ void _updateLinesMap(Obj * o)
     }
 }
 
+void _reflowLinesMap(Obj * o)
+{
+    TextStorage * textStorage = o->modules->textStorage;
+    const TextStorage_Changes * changes = TextStorage_changes(textStorage);
+    size_t firstLineBase = _calcCurrPageFirstLineBase(o);
+
+    if(!changes->known || changes->begin < firstLineBase)
+    {
+        _updateLinesMap(o);
+        return;
+    }
+
+    if(!changes->changed)
+        return;
+
+    // Правка может изменить строку, до конца которой она дошла, и строку перед
+    //  ней: перенос слов в предыдущей строке зависит от начала следующей
+    LineMap * lineMap   = o->pageStruct.lineMapTable;
+    LineMap * const end = o->pageStruct.lineMapTable + o->pageParams->lineAmount;
+    size_t oldLineBase  = firstLineBase;
+    size_t lineIndex    = 0;
+    for( ; lineMap != end; lineMap++, lineIndex++)
+    {
+        if(oldLineBase + lineMap->fullLen >= changes->begin)
+            break;
+        oldLineBase += lineMap->fullLen;
+    }
+
+    if(lineIndex > 0)
+    {
+        lineMap--;
+        lineIndex--;
+        oldLineBase -= lineMap->fullLen;
+    }
+    else if(!_isCurrPageFirst(o))
+    {
+        _updateLineMap(o, &o->pageStruct.prevLastLine, o->pageStruct.base);
+    }
+
+    size_t lineBase  = lineIndex > 0 ? oldLineBase : _calcCurrPageFirstLineBase(o);
+    size_t endOfText = TextStorage_endOfText(textStorage);
+    bool lastPageReached = false;
+    LineMap copy;
+    for( ; lineMap != end; lineMap++, lineIndex++)
+    {
+        // Текст за правкой не изменился, только сдвинулся. Если строка за
+        //  правкой начинается там же, где раньше (с учетом сдвига), то и она,
+        //  и все следующие строки остались прежними
+        if( lineBase >= changes->end &&
+                lineBase + changes->oldEndOfText == oldLineBase + endOfText )
+            return;
+
+        _copyLineMap(&copy, lineMap);
+        if(_updateLineMap(o, lineMap, lineBase))
+            lastPageReached = true;
+        lineBase    += lineMap->fullLen;
+        oldLineBase += copy.fullLen;
+        if(_lineChanged(lineMap, &copy))
+            _setLineChangedFlag(o, lineIndex);
+    }
+
+    o->pageStruct.lastPageReached = lastPageReached;
+}
+
+#ifdef PAGE_FORMATTER_CHECK_REFLOW
+// Отладочная проверка частичного пересчета: строки страницы пересчитываются
+//  целиком (как в _updateLinesMap, но без записи в страницу) и сравниваются с
+//  результатом _reflowLinesMap. Расхождение - сигнал test_beep
+void _checkLinesMap(Obj * o)
+{
+    bool mismatch = false;
+    LineMap lineMap;
+
+    size_t lineBase = o->pageStruct.base;
+    if(!_isCurrPageFirst(o))
+    {
+        _updateLineMap(o, &lineMap, lineBase);
+        if(memcmp(&lineMap, &o->pageStruct.prevLastLine, sizeof(LineMap)) != 0)
+            mismatch = true;
+        lineBase += lineMap.fullLen;
+    }
+
+    bool lastPageReached = false;
+    for(size_t i = 0; i < o->pageParams->lineAmount; i++)
+    {
+        if(_updateLineMap(o, &lineMap, lineBase))
+            lastPageReached = true;
+        if(memcmp(&lineMap, &o->pageStruct.lineMapTable[i], sizeof(LineMap)) != 0)
+            mismatch = true;
+        lineBase += lineMap.fullLen;
+    }
+
+    if(lastPageReached != o->pageStruct.lastPageReached)
+        mismatch = true;
+
+    if(mismatch)
+        test_beep();
+}
+#endif
+
 bool _isCurrPageFirst(Obj * o)
 {
+#ifdef PAGE_FORMATTER_SCROLL
+    if(o->scroll.lines > 0)
+        return false;
+#endif
     return (o->pageNavi.currPageIndex == 0) &&
             (o->pageNavi.currGroupIndex == 0);
 }
@@ -616,11 +1311,12 @@ size_t _updateLineMap(Obj * o, LineMap * lineMap, size_t lineBase)
 {
     bool endOfTextFind = false;
     const unicode_t * const begin =
-            LineBuffer_LoadText(o->modules, lineBase, o->modules->lineBuffer.size);
+            LineBuffer_ViewText(o->modules, lineBase, o->modules->lineBuffer.size);
 
     LPM_TextLineMap textLineMap;
     if(TextOperator_analizeLine( o->modules->textOperator,
                                      begin,
+                                     begin + o->modules->lineBuffer.size,
                                      o->pageParams->charAmount,
                                      &textLineMap) )
         endOfTextFind = true;
@@ -628,7 +1324,7 @@ size_t _updateLineMap(Obj * o, LineMap * lineMap, size_t lineBase)
     lineMap->fullLen    = (uint8_t)(textLineMap.nextLine    - begin);
     lineMap->payloadLen = (uint8_t)(textLineMap.printBorder - begin);
     lineMap->restLen    = o->pageParams->charAmount - textLineMap.lenInChr;
-    lineMap->crc        = _calcLineCrc(o, lineMap);
+    lineMap->crc        = _calcLineCrc(begin, lineMap);
     lineMap->endsWithEndl = textLineMap.endsWithEndl;
     return endOfTextFind;
 }
@@ -640,19 +1336,35 @@ void _copyLineMap(LineMap * dst, const LineMap * src)
 
 bool _lineChanged(const LineMap * before, const LineMap * after)
 {
+#ifdef PAGE_FORMATTER_EXACT_LINE_CHANGES
+    // Разные строки с одинаковой CRC не останутся на экране прежними ценой
+    //  перерисовки всех пересчитанных строк
+    (void)before; (void)after;
+    return true;
+#else
     if(before->restLen == after->restLen)
         if(before->fullLen == after->fullLen)
-            if(before->restLen == after->restLen)
+            if(before->payloadLen == after->payloadLen)
                 if(before->crc == after->crc)
                     return false;
     return true;
+#endif
 }
 
-uint16_t _calcLineCrc(Obj * o, LineMap * lineMap)
+uint16_t _calcLineCrc(const unicode_t * line, const LineMap * lineMap)
 {
+#if defined(PAGE_FORMATTER_EXACT_LINE_CHANGES)
+    (void)line; (void)lineMap;
+    return 0;
+#elif defined(CRC16_TABLE_BYTEWISE)
     return crc16_table_calc_for_array(
-                (uint8_t*)(o->modules->lineBuffer.data),
+                (const uint8_t*)line,
+                lineMap->payloadLen * sizeof(unicode_t) );
+#else
+    return crc16_slice8_calc_for_array(
+                (const uint8_t*)line,
                 lineMap->payloadLen * sizeof(unicode_t) );
+#endif
 }
 
 void _makePrevLineMapForFirstPage(LineMap * lineMap)
@@ -668,6 +1380,7 @@ void _setAllLineChangedFlags(Obj * o)
 void _resetAllLineChangedFlags(Obj * o)
 {
     o->lineChangedFlags = 0;
+    o->lineCursorChangedFlags = 0;
 }
 
 bool _readLineChangedFlag(Obj * o, size_t lineIndex)
@@ -675,6 +1388,11 @@ bool _readLineChangedFlag(Obj * o, size_t lineIndex)
     return o->lineChangedFlags & (1 << lineIndex);
 }
 
+bool _readLineCursorChangedFlag(Obj * o, size_t lineIndex)
+{
+    return o->lineCursorChangedFlags & (1 << lineIndex);
+}
+
 void _setLineChangedFlag(Obj * o, size_t lineIndex)
 {
     o->lineChangedFlags |= (1 << lineIndex);
@@ -774,8 +1492,13 @@ PageStatus _moveCursorAtChar(Obj * o, uint32_t dirFlags, DspCurs * dspCurs)
             {
                 if(!_isCurrPageFirst(o))
                 {
+#ifdef PAGE_FORMATTER_SCROLL
+                    pageStatus = PAGE_SCROLL_UP;
+                    dspCurs->begin.x = o->pageParams->charAmount;
+#else
                     pageStatus = PAGE_PREV;
                     _setDspPosToPageEnd(o, &dspCurs->begin);
+#endif
                 }
             }
         }
@@ -789,8 +1512,13 @@ PageStatus _moveCursorAtChar(Obj * o, uint32_t dirFlags, DspCurs * dspCurs)
             {
                 if(!_isCurrPageLast(o))
                 {
+#ifdef PAGE_FORMATTER_SCROLL
+                    pageStatus = PAGE_SCROLL_DOWN;
+                    _setDspPosToLineBegin(o, &dspCurs->end);
+#else
                     pageStatus = PAGE_NEXT;
                     _setDspPosToPageBegin(o, &dspCurs->end);
+#endif
                 }
             }
         }
@@ -804,8 +1532,12 @@ PageStatus _moveCursorAtChar(Obj * o, uint32_t dirFlags, DspCurs * dspCurs)
             {
                 if(!_isCurrPageFirst(o))
                 {
+#ifdef PAGE_FORMATTER_SCROLL
+                    pageStatus = PAGE_SCROLL_UP;
+#else
                     pageStatus = PAGE_PREV;
                     dspCurs->begin.y = o->pageParams->lineAmount-1;
+#endif
                 }
             }
         }
@@ -819,8 +1551,12 @@ PageStatus _moveCursorAtChar(Obj * o, uint32_t dirFlags, DspCurs * dspCurs)
             {
                 if(!_isCurrPageLast(o))
                 {
+#ifdef PAGE_FORMATTER_SCROLL
+                    pageStatus = PAGE_SCROLL_DOWN;
+#else
                     pageStatus = PAGE_NEXT;
                     dspCurs->end.y = 0;
+#endif
                 }
             }
         }
@@ -1043,11 +1779,22 @@ void _swapDspPoints(DspCurs * dspCurs)
 void _changePageByStatus(Obj * o, PageStatus ps)
 {
     if(ps == PAGE_NEXT)
-        _changePageIfNotOnCurrTextPosition(o, _calcNextPageBase(o) +
-                                               o->pageStruct.lineMapTable[o->pageParams->lineAmount-1].fullLen);
+        _changePageIfNotOnCurrTextPosition(o, _calcCurrPageFirstLineBase(o) + _calcCurrPageLen(o));
 
     if(ps == PAGE_PREV)
-        _changePageIfNotOnCurrTextPosition(o, o->pageStruct.base);
+    {
+        size_t pos = o->pageStruct.base;
+        _setPrevPage(o);
+        _changePageIfNotOnCurrTextPosition(o, pos);
+    }
+
+#ifdef PAGE_FORMATTER_SCROLL
+    if(ps == PAGE_SCROLL_DOWN)
+        _scrollDown(o);
+
+    if(ps == PAGE_SCROLL_UP)
+        _scrollUp(o);
+#endif
 }
 
 void _displayCursorToTextCursor(Obj * o, SlcCurs * textCursor)
@@ -1245,9 +1992,16 @@ void _calcDisplayPointXValue(Obj * o, LPM_Point * point, size_t txtPos)
         return;
     }
 
-    unicode_t * pchr = LineBuffer_LoadText(o->modules, lineBase, lm->fullLen);
+    // Позиция может стоять и за выводимой частью строки (на пробеле переноса
+    //  или конце строки). Загружается только текст до нее и еще один символ -
+    //  по нему проверяется диакритика, а дальше в буфере строки лежат остатки
+    //  прошлой загрузки
+    size_t len = txtPos - lineBase;
+    if(len > lm->fullLen)
+        len = lm->fullLen;
+    unicode_t * pchr = LineBuffer_LoadText(o->modules, lineBase, len + 1);
     point->x = TextOperator_calcChrAmount
-            (o->modules->textOperator, pchr, pchr + txtPos-lineBase);
+            (o->modules->textOperator, pchr, pchr + len);
 }
 
 uint32_t _getTypeFlagValue(uint32_t flags)
@@ -1305,7 +2059,7 @@ void _setLineChangedFlagsBySymmetricDifferencePart(Obj * o, const SlcCurs * symD
     for(size_t i = begin; i <= end; i++, currFlag <<= 1)
         flags |= currFlag;
 
-    o->lineChangedFlags |= flags;
+    o->lineCursorChangedFlags |= flags;
 }
 
 void _copyDisplayCursor(DspCurs * dst, const DspCurs * src)
@@ -1398,29 +2152,77 @@ void _normalizeTextCursorAndFillBeginEnd(const SlcCurs * curs, size_t * begin, s
 
 void _displayLine(Obj * o, size_t lineIndex, size_t lineOffset)
 {
-    Unicode_Buf lineBuf;
+    Unicode_ConstBuf lineBuf;
     const LineMap * lineMap = o->pageStruct.lineMapTable + lineIndex;
     SlcCurs lineCursor;
     _readDisplayedLineToBuffer(o, lineMap, lineOffset, &lineBuf);
-    _displayCursorToLineCursor(o, lineIndex, &lineCursor);
+    _displayCursorToLineCursor(o, lineIndex, lineBuf.data, &lineCursor);
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    _writeLineThroughShadowFrame(o, lineIndex, &lineBuf, &lineCursor);
+#else
     LPM_UnicodeDisplay_writeLine( o->display,
                                   lineIndex,
                                   &lineBuf,
                                   &lineCursor);
+#endif
 }
 
-void _readDisplayedLineToBuffer(Obj * o, const LineMap * lineMap, size_t lineOffset, Unicode_Buf * lineBuf)
+// Текст строки не менялся, сменилось только выделение. Дисплею с
+//  setSelection передается один курсор, а текст строки без составных символов
+//  даже не читается
+void _displayLineCursor(Obj * o, size_t lineIndex, size_t lineOffset)
+{
+    if(!LPM_UnicodeDisplay_hasSetSelection(o->display))
+    {
+        _displayLine(o, lineIndex, lineOffset);
+        return;
+    }
+
+    const LineMap * lineMap = o->pageStruct.lineMapTable + lineIndex;
+    const unicode_t * line = NULL;
+    if(lineMap->payloadLen + lineMap->restLen != o->pageParams->charAmount)
+    {
+        Unicode_ConstBuf lineBuf;
+        _readDisplayedLineToBuffer(o, lineMap, lineOffset, &lineBuf);
+        line = lineBuf.data;
+    }
+
+    SlcCurs lineCursor;
+    _displayCursorToLineCursor(o, lineIndex, line, &lineCursor);
+    LPM_UnicodeDisplay_setSelection(o->display, lineIndex, &lineCursor);
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    o->shadowFrame.lineTable[lineIndex].cursor = lineCursor;
+#endif
+}
+
+void _readDisplayedLineToBuffer(Obj * o, const LineMap * lineMap, size_t lineOffset, Unicode_ConstBuf * lineBuf)
 {
-    lineBuf->data = LineBuffer_LoadText(o->modules, lineOffset, lineMap->payloadLen);
     lineBuf->size = lineMap->payloadLen + lineMap->restLen;
 
-    unicode_t * pchr      = lineBuf->data + lineMap->payloadLen;
+    // Строку без дополнения пробелами дисплей может прочитать прямо из
+    //  хранилища (дисплей получает строку только для чтения). Берется на
+    //  символ больше: при пересчете курсора читается и символ за концом строки
+    if(lineMap->restLen == 0)
+    {
+        lineBuf->data = LineBuffer_ViewText(o->modules, lineOffset, lineMap->payloadLen + 1);
+        return;
+    }
+
+    unicode_t * line = LineBuffer_LoadText(o->modules, lineOffset, lineMap->payloadLen);
+    lineBuf->data = line;
+
+    unicode_t * pchr      = line + lineMap->payloadLen;
     unicode_t * const end = pchr + lineMap->restLen;
     for( ; pchr != end; pchr++)
         *pchr = chrSpace;
+
+    // Символ за дополненной строкой - конец текста, а не остаток прошлой
+    //  загрузки буфера строки (его читает пересчет курсора)
+    if(lineBuf->size < o->modules->lineBuffer.size)
+        *pchr = chrEndOfText;
 }
 
-void _displayCursorToLineCursor(Obj * o, size_t lineIndex, SlcCurs * lineCursor)
+void _displayCursorToLineCursor(Obj * o, size_t lineIndex, const unicode_t * line, SlcCurs * lineCursor)
 {
     const LineMap * lineMap = o->pageStruct.lineMapTable + lineIndex;
     const size_t lineSize  = lineMap->payloadLen + lineMap->restLen;
@@ -1437,7 +2239,7 @@ void _displayCursorToLineCursor(Obj * o, size_t lineIndex, SlcCurs * lineCursor)
         else if(lineIndex == lineEnd)
         {
             lineCursor->pos = 0;
-            lineCursor->len = _calcPositionOfDisplayXvalue(o, o->displayCursor.end.x);
+            lineCursor->len = _calcPositionOfDisplayXvalue(o, line, lineSize, o->displayCursor.end.x);
         }
         else
         {
@@ -1447,10 +2249,10 @@ void _displayCursorToLineCursor(Obj * o, size_t lineIndex, SlcCurs * lineCursor)
     }
     else if(lineIndex == lineBegin)
     {
-        size_t beginPos = _calcPositionOfDisplayXvalue(o, o->displayCursor.begin.x);
+        size_t beginPos = _calcPositionOfDisplayXvalue(o, line, lineSize, o->displayCursor.begin.x);
         if(lineIndex == lineEnd)
         {
-            size_t endPos = _calcPositionOfDisplayXvalue(o, o->displayCursor.end.x);
+            size_t endPos = _calcPositionOfDisplayXvalue(o, line, lineSize, o->displayCursor.end.x);
             lineCursor->pos = beginPos;
             lineCursor->len = endPos - beginPos;
         }
@@ -1467,11 +2269,133 @@ void _displayCursorToLineCursor(Obj * o, size_t lineIndex, SlcCurs * lineCursor)
     }
 }
 
-size_t _calcPositionOfDisplayXvalue(Obj * o, size_t x)
+// line == NULL - строка без составных символов (из charAmount символов
+//  буфера): позиция в ней равна столбцу, и текст строки не нужен
+size_t _calcPositionOfDisplayXvalue(Obj * o, const unicode_t * line, size_t lineSize, size_t x)
 {
+    if(line == NULL)
+        return x < lineSize ? x : lineSize;
+
     const unicode_t * pchr = TextOperator_nextNChar
                 ( o->modules->textOperator,
-                  o->modules->lineBuffer.data,
+                  line,
                   x );
-    return pchr - o->modules->lineBuffer.data;
+    return pchr - line;
+}
+
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+
+void _invalidateShadowFrame(Obj * o)
+{
+    ShadowLine * shadowLine = o->shadowFrame.lineTable;
+    ShadowLine * const end  = o->shadowFrame.lineTable + o->pageParams->lineAmount;
+    for( ; shadowLine != end; shadowLine++)
+        shadowLine->size = 0;
+}
+
+void _writeLineThroughShadowFrame(Obj * o, size_t lineIndex, const Unicode_ConstBuf * lineBuf, const SlcCurs * lineCursor)
+{
+    const size_t charAmount = o->pageParams->charAmount;
+    const ShadowLine * shadowLine = o->shadowFrame.lineTable + lineIndex;
+    const unicode_t * shadowText  = o->shadowFrame.text + lineIndex * charAmount;
+
+    if(lineBuf->size != charAmount || shadowLine->size != charAmount)
+    {
+        LPM_UnicodeDisplay_writeLine(o->display, lineIndex, lineBuf, lineCursor);
+        _saveShadowLine(o, lineIndex, lineBuf, lineCursor);
+        return;
+    }
+
+    size_t begin, end;
+    _findChangedSpan(shadowText, lineBuf->data, charAmount, &begin, &end);
+    const bool cursorChanged = shadowLine->cursor.pos != lineCursor->pos ||
+                               shadowLine->cursor.len != lineCursor->len;
+    if(cursorChanged)
+    {
+        _extendSpanBySelection(&shadowLine->cursor, charAmount, &begin, &end);
+        _extendSpanBySelection(lineCursor, charAmount, &begin, &end);
+    }
+
+    if(begin < end)
+    {
+        if(LPM_UnicodeDisplay_hasWriteSpan(o->display))
+        {
+            Unicode_ConstBuf spanBuf = { lineBuf->data + begin, end - begin };
+            LPM_UnicodeDisplay_writeSpan(o->display, lineIndex, begin, &spanBuf, lineCursor);
+        }
+        else
+        {
+            LPM_UnicodeDisplay_writeLine(o->display, lineIndex, lineBuf, lineCursor);
+        }
+    }
+    else if(cursorChanged)
+    {
+        // Курсор сменился, но символов под ним нет (курсор за строкой или
+        //  пустое выделение) - дисплей все равно должен узнать новый курсор,
+        //  иначе на строке останется прежнее выделение
+        if(LPM_UnicodeDisplay_hasSetSelection(o->display))
+            LPM_UnicodeDisplay_setSelection(o->display, lineIndex, lineCursor);
+        else
+            LPM_UnicodeDisplay_writeLine(o->display, lineIndex, lineBuf, lineCursor);
+    }
+    _saveShadowLine(o, lineIndex, lineBuf, lineCursor);
 }
+
+// Участок [begin, end) от первого до последнего отличающегося символа.
+//  Строки одинаковые - участок пустой (begin == end)
+void _findChangedSpan(const unicode_t * before, const unicode_t * after, size_t size, size_t * begin, size_t * end)
+{
+    size_t first = 0;
+    while(first < size && before[first] == after[first])
+        first++;
+
+    size_t last = size;
+    while(last > first && before[last-1] == after[last-1])
+        last--;
+
+    *begin = first;
+    *end   = last;
+}
+
+// Добавить к участку символы, выделенные курсором строки (курсор без
+//  выделения занимает один символ, курсор за строкой - ни одного)
+void _extendSpanBySelection(const SlcCurs * lineCursor, size_t size, size_t * begin, size_t * end)
+{
+    size_t slcBegin, slcEnd;
+    _normalizeTextCursorAndFillBeginEnd(lineCursor, &slcBegin, &slcEnd);
+    if(slcEnd > size)
+        slcEnd = size;
+    if(slcBegin >= slcEnd)
+        return;
+
+    if(*begin == *end)
+    {
+        *begin = slcBegin;
+        *end   = slcEnd;
+        return;
+    }
+
+    if(slcBegin < *begin)
+        *begin = slcBegin;
+    if(slcEnd > *end)
+        *end = slcEnd;
+}
+
+// Строка не из charAmount символов запоминается как неизвестная: следующий
+//  вывод строки будет полным
+void _saveShadowLine(Obj * o, size_t lineIndex, const Unicode_ConstBuf * lineBuf, const SlcCurs * lineCursor)
+{
+    const size_t charAmount = o->pageParams->charAmount;
+    ShadowLine * shadowLine = o->shadowFrame.lineTable + lineIndex;
+    if(lineBuf->size != charAmount)
+    {
+        shadowLine->size = 0;
+        return;
+    }
+
+    memcpy(o->shadowFrame.text + lineIndex * charAmount, lineBuf->data, charAmount * sizeof(unicode_t));
+    shadowLine->cursor = *lineCursor;
+    shadowLine->size   = charAmount;
+}
+
+#endif
@@ -15,13 +15,71 @@ typedef struct LineMap
     bool endsWithEndl;
 } LineMap;
 
+/*
+ * С PAGE_FORMATTER_PAGE_INDEX кроме начал групп страниц запоминаются начала
+ *  всех страниц документа подряд с первой (pageBaseTable, pagesKnown
+ *  страниц). Страница с позицией текста ищется в них двоичным поиском, а
+ *  недостающие начала страниц досчитываются одним проходом по строкам без
+ *  построения карт строк. Правка отбрасывает страницы, начало которых от нее
+ *  зависит. Память под таблицу запрашивается контроллером в куче
+ *  (PageFormatter_calcPageBaseTableSize).
+ */
 typedef struct PageNavigation
 {
     size_t * groupBaseTable;
     size_t currGroupIndex;
     size_t currPageIndex;
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+    size_t * pageBaseTable;
+    size_t pagesKnown;
+    size_t pagesAmount;
+#endif
 } PageNavigation;
 
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+/*
+ * С PAGE_FORMATTER_SHADOW_FRAME запоминается кадр, отправленный на дисплей:
+ *  текст и курсор каждой строки. Строка для вывода сравнивается с прежней:
+ *  неизменная строка не выводится вовсе, а дисплею с writeSpan передается
+ *  только участок от первого до последнего отличия (вместе с символами, где
+ *  сменилось выделение). Участок считается в символах буфера строки, поэтому
+ *  сравниваются только строки ровно из charAmount символов (без составных с
+ *  диакритикой) - остальные выводятся целиком. Память под кадр
+ *  запрашивается контроллером в куче (PageFormatter_calcShadowFrameSize).
+ */
+typedef struct ShadowLine
+{
+    LPM_SelectionCursor cursor;
+    size_t size;                // 0 - что на дисплее в строке, неизвестно
+} ShadowLine;
+
+typedef struct ShadowFrame
+{
+    ShadowLine * lineTable;
+    unicode_t * text;
+} ShadowFrame;
+#endif
+
+#ifdef PAGE_FORMATTER_SCROLL
+/*
+ * С PAGE_FORMATTER_SCROLL курсор, уходящий по символам или строкам за край
+ *  страницы, сдвигает вид на одну строку вместо перелистывания. Вид - это
+ *  страница pageNavi, сдвинутая на lines строк вниз (меньше lineAmount:
+ *  сдвинутая на lineAmount строк страница - уже следующая). PageStruct
+ *  описывает вид, а pageBase - начало самой страницы, от которого считаются
+ *  соседние страницы. Листание страниц начинается с несдвинутой страницы.
+ *  Дисплей с scroll сдвигает выведенные строки сам, и выводится только
+ *  открывшаяся строка (pending - сдвиг дисплея, ждущий вывода: больше нуля -
+ *  строки вверх).
+ */
+typedef struct PageScroll
+{
+    size_t pageBase;
+    size_t lines;
+    int pending;
+} PageScroll;
+#endif
+
 typedef struct PageStruct
 {
     LineMap prevLastLine;
@@ -44,12 +102,41 @@ typedef struct PageFormatter
     PageNavigation pageNavi;
     PageStruct pageStruct;
     uint32_t lineChangedFlags;
+    uint32_t lineCursorChangedFlags;    // Текст строки тот же, сменилось выделение
     LPM_DisplayCursor displayCursor;
     LPM_SelectionCursor textCursor;
     AddChars addChars;
     bool selectBackward;
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+    ShadowFrame shadowFrame;
+#endif
+#ifdef PAGE_FORMATTER_SCROLL
+    PageScroll scroll;
+#endif
 } PageFormatter;
 
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+// Каждая страница, кроме последней, сдвигает начало следующей хотя бы на
+//  lineAmount-1 непустых строк
+static inline size_t PageFormatter_calcMaxPagesAmount(size_t textBufferSize, size_t lineAmount)
+{
+    return textBufferSize / (lineAmount > 1 ? lineAmount-1 : 1) + 2;
+}
+
+static inline size_t PageFormatter_calcPageBaseTableSize(size_t textBufferSize, size_t lineAmount)
+{
+    return PageFormatter_calcMaxPagesAmount(textBufferSize, lineAmount) * sizeof(size_t);
+}
+#endif
+
+#ifdef PAGE_FORMATTER_SHADOW_FRAME
+static inline size_t PageFormatter_calcShadowFrameSize(const LPM_EditorPageParams * pageParams)
+{
+    return pageParams->lineAmount *
+            (sizeof(ShadowLine) + pageParams->charAmount * sizeof(unicode_t));
+}
+#endif
+
 void PageFormatter_init
         ( PageFormatter * o,
           const Modules * modules,
@@ -89,6 +176,12 @@ size_t PageFormatter_fillPageWithEmptyLines
           Unicode_Buf * buf,
           LPM_EndlType endlType );
 
+#ifdef PAGE_FORMATTER_PAGE_INDEX
+// Досчитать не больше pagesAmount начал страниц за последней известной (для
+//  работы в простое). Возвращает false, если досчитывать было нечего
+bool PageFormatter_extendPageIndex(PageFormatter * o, size_t pagesAmount);
+#endif
+
 static inline bool PageFormatter_hasAddChars(PageFormatter * o)
 {
     return o->addChars.lines + o->addChars.spaces > 0;
@@ -0,0 +1,209 @@
+#include "pagination.h"
+#include "text_operator.h"
+#include "text_scan.h"
+
+#ifdef PAGINATION_THREADS
+#include <pthread.h>
+#endif
+
+static const unicode_t chrCr = 0x000D;
+static const unicode_t chrLf = 0x000A;
+
+typedef struct Chunk
+{
+    TextOperator * textOperator;
+    const LPM_EditorPageParams * pageParams;
+    const unicode_t * text;
+    const unicode_t * textEnd;  // За нулем в конце текста
+    const unicode_t * begin;
+    const unicode_t * end;
+    bool last;
+    size_t firstLineIndex;
+    size_t lineAmount;          // Строк в части (первый проход)
+    size_t endOfTextLineIndex;  // Строка, дошедшая до конца текста (второй проход)
+    size_t * pageBaseTable;
+    size_t maxPagesAmount;
+} Chunk;
+
+typedef void (*ChunkFxn)(Chunk * chunk);
+
+#ifdef PAGINATION_THREADS
+typedef struct ChunkJob
+{
+    Chunk * chunk;
+    ChunkFxn fxn;
+} ChunkJob;
+#endif
+
+static const unicode_t * _findChunkBorder(const unicode_t * pchr, const unicode_t * end);
+static void _countLines(Chunk * chunk);
+static void _fillPageBases(Chunk * chunk);
+static void _processChunks(Chunk * chunks, size_t chunkAmount, ChunkFxn fxn);
+
+#ifdef PAGINATION_THREADS
+static void * _threadFxn(void * arg);
+#endif
+
+size_t Pagination_calcPageBases
+        ( struct TextOperator * textOperator,
+          const unicode_t * text,
+          size_t textSize,
+          const LPM_EditorPageParams * pageParams,
+          size_t * pageBaseTable,
+          size_t maxPagesAmount,
+          size_t threadAmount )
+{
+    Chunk chunks[PAGINATION_MAX_THREADS];
+    if(threadAmount > PAGINATION_MAX_THREADS)
+        threadAmount = PAGINATION_MAX_THREADS;
+    if(threadAmount == 0)
+        threadAmount = 1;
+
+    // Части примерно равного размера, каждая начинается за концом строки.
+    //  Конец текста - только в последней части: строка, дошедшая до него,
+    //  разбирается иначе
+    const unicode_t * const end = text + textSize;
+    const unicode_t * begin = text;
+    size_t chunkAmount;
+    for(chunkAmount = 0; chunkAmount < threadAmount; )
+    {
+        Chunk * chunk = &chunks[chunkAmount++];
+        chunk->textOperator   = textOperator;
+        chunk->pageParams     = pageParams;
+        chunk->text           = text;
+        chunk->textEnd        = end + 1;
+        chunk->pageBaseTable  = pageBaseTable;
+        chunk->maxPagesAmount = maxPagesAmount;
+        chunk->begin          = begin;
+        chunk->end = chunkAmount == threadAmount ? end :
+                _findChunkBorder(text + textSize / threadAmount * chunkAmount, end);
+        if(chunk->end < begin)
+            chunk->end = begin;
+        chunk->last = chunk->end == end;
+        if(chunk->last)
+            break;
+        begin = chunk->end;
+    }
+
+    // Номер первой строки части известен, только когда посчитаны строки во
+    //  всех частях перед ней. Строки последней части считать не нужно
+    _processChunks(chunks, chunkAmount-1, _countLines);
+    size_t firstLineIndex = 0;
+    size_t i;
+    for(i = 0; i < chunkAmount; i++)
+    {
+        chunks[i].firstLineIndex = firstLineIndex;
+        if(i < chunkAmount-1)
+            firstLineIndex += chunks[i].lineAmount;
+    }
+
+    if(maxPagesAmount > 0)
+        pageBaseTable[0] = 0;
+    _processChunks(chunks, chunkAmount, _fillPageBases);
+
+    // Страница k (кроме первой) есть, если на странице k-1 ни одна строка не
+    //  дошла до конца текста
+    return 1 + chunks[chunkAmount-1].endOfTextLineIndex / pageParams->lineAmount;
+}
+
+// Граница частей - за первым концом строки с позиции pchr. CR и LF за ним
+//  разбираются как один конец строки, поэтому их не разделить
+const unicode_t * _findChunkBorder(const unicode_t * pchr, const unicode_t * end)
+{
+    pchr = TextScan_findEndOfLine(pchr, end);
+    if(pchr != end && *pchr == chrCr)
+        pchr++;
+    if(pchr != end && *pchr == chrLf)
+        pchr++;
+    return pchr;
+}
+
+void _countLines(Chunk * chunk)
+{
+    LPM_TextLineMap lineMap;
+    const unicode_t * line = chunk->begin;
+    size_t lineAmount = 0;
+    while(line < chunk->end)
+    {
+        TextOperator_analizeLine( chunk->textOperator, line, chunk->textEnd,
+                                  chunk->pageParams->charAmount, &lineMap );
+        line = lineMap.nextLine;
+        lineAmount++;
+    }
+    chunk->lineAmount = lineAmount;
+}
+
+// Страница k начинается с начала строки k*lineAmount-1
+void _fillPageBases(Chunk * chunk)
+{
+    const size_t pageLineAmount = chunk->pageParams->lineAmount;
+    LPM_TextLineMap lineMap;
+    const unicode_t * line = chunk->begin;
+    size_t lineIndex = chunk->firstLineIndex;
+    for( ; chunk->last || line < chunk->end; lineIndex++)
+    {
+        bool endOfTextReached =
+                TextOperator_analizeLine( chunk->textOperator, line, chunk->textEnd,
+                                          chunk->pageParams->charAmount, &lineMap );
+        if(endOfTextReached)
+        {
+            chunk->endOfTextLineIndex = lineIndex;
+            break;
+        }
+
+        if((lineIndex+1) % pageLineAmount == 0)
+        {
+            size_t pageIndex = (lineIndex+1) / pageLineAmount;
+            if(pageIndex < chunk->maxPagesAmount)
+                chunk->pageBaseTable[pageIndex] = (size_t)(line - chunk->text);
+        }
+        line = lineMap.nextLine;
+    }
+}
+
+#ifdef PAGINATION_THREADS
+
+void _processChunks(Chunk * chunks, size_t chunkAmount, ChunkFxn fxn)
+{
+    // Первая часть обрабатывается в вызывающем потоке, и если поток создать
+    //  не удалось - тоже
+    pthread_t threads[PAGINATION_MAX_THREADS];
+    bool started[PAGINATION_MAX_THREADS];
+    ChunkJob jobs[PAGINATION_MAX_THREADS];
+    size_t i;
+    for(i = 1; i < chunkAmount; i++)
+    {
+        jobs[i].chunk = &chunks[i];
+        jobs[i].fxn   = fxn;
+        started[i] = pthread_create(&threads[i], NULL, _threadFxn, &jobs[i]) == 0;
+    }
+
+    if(chunkAmount > 0)
+        fxn(&chunks[0]);
+
+    for(i = 1; i < chunkAmount; i++)
+    {
+        if(started[i])
+            pthread_join(threads[i], NULL);
+        else
+            fxn(&chunks[i]);
+    }
+}
+
+void * _threadFxn(void * arg)
+{
+    ChunkJob * job = arg;
+    job->fxn(job->chunk);
+    return NULL;
+}
+
+#else
+
+void _processChunks(Chunk * chunks, size_t chunkAmount, ChunkFxn fxn)
+{
+    size_t i;
+    for(i = 0; i < chunkAmount; i++)
+        fxn(&chunks[i]);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PAGINATION_H
+#define PAGINATION_H
+
+#include "lpm_unicode.h"
+#include "lpm_editor_api.h"
+
+struct TextOperator;
+
+/*
+ * Разбивка на страницы всего текста сразу - для подготовки к печати и
+ *  подсчета страниц без редактора. Результат совпадает с разбивкой
+ *  PageFormatter при тех же параметрах страницы: страница 0 начинается с
+ *  начала текста, страница k - с начала последней строки страницы k-1.
+ * Перенос строк начинается заново после каждого конца строки, поэтому текст
+ *  делится по концам строк на части, которые разбиваются на строки
+ *  независимо: сначала считаются строки в частях, затем по номеру первой
+ *  строки части находятся начала попавших в нее страниц.
+ * С PAGINATION_THREADS части обрабатываются в отдельных потоках (pthreads),
+ *  иначе - по очереди в вызывающем потоке.
+ */
+
+#ifndef PAGINATION_MAX_THREADS
+#define PAGINATION_MAX_THREADS 16
+#endif
+
+/*
+ * text - текст размером textSize с нулем в конце (других нулей в тексте
+ *  нет). Начала страниц записываются в pageBaseTable, не больше
+ *  maxPagesAmount. Возвращает количество страниц в тексте (может быть
+ *  больше maxPagesAmount). threadAmount - количество частей, на которые
+ *  делится текст (не больше PAGINATION_MAX_THREADS).
+ */
+size_t Pagination_calcPageBases
+        ( struct TextOperator * textOperator,
+          const unicode_t * text,
+          size_t textSize,
+          const LPM_EditorPageParams * pageParams,
+          size_t * pageBaseTable,
+          size_t maxPagesAmount,
+          size_t threadAmount );
+
+#endif // PAGINATION_H
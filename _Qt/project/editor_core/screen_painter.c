@@ -65,10 +65,15 @@ const unicode_t * _editorMessageToTextPointer(Obj * o, EditorMessage msg)
 
 void _drawText(Obj * o, const unicode_t * text)
 {
+    LPM_UnicodeDisplay_beginFrame(o->display);
     LPM_UnicodeDisplay_clearScreen(o->display);
 
     _drawBorderLine(o, true);
 
+    // Сообщение кончается нулем - дальше него разбор строк не читает
+    const unicode_t * textEnd = text;
+    while(*textEnd++ != 0x0000) {}
+
     LPM_TextLineMap lineMap;
     const unicode_t * currLine = text;
     bool lastLine = false;
@@ -79,6 +84,7 @@ void _drawText(Obj * o, const unicode_t * text)
             lastLine = TextOperator_analizeLine
                     ( o->modules->textOperator,
                       currLine,
+                      textEnd,
                       o->pageParams->charAmount-2,
                       &lineMap );
 
@@ -93,6 +99,7 @@ void _drawText(Obj * o, const unicode_t * text)
     }
 
     _drawBorderLine(o, false);
+    LPM_UnicodeDisplay_endFrame(o->display);
 }
 
 void _waitForAnyKeyPressed(Obj * o)
@@ -102,7 +109,7 @@ void _waitForAnyKeyPressed(Obj * o)
 
 void _drawLineBuffer(Obj * o, size_t size, size_t lineIndex)
 {
-    Unicode_Buf buf = { o->modules->lineBuffer.data, size };
+    Unicode_ConstBuf buf = { o->modules->lineBuffer.data, size };
     LPM_SelectionCursor curs = { size, 0 };
     LPM_UnicodeDisplay_writeLine(o->display, lineIndex, &buf, &curs);
 }
@@ -12,7 +12,6 @@ static bool _noEnoughPlaceInBuffer(TextBuffer * o, size_t len);
 static bool _noEnoughPlaceInTextStorage(TextBuffer * o, const LPM_SelectionCursor * removingArea);
 static void _write(TextBuffer * o, size_t pos, size_t len);
 static void _read(TextBuffer * o, size_t pos, size_t len);
-static size_t _calcPartialRemoveLen(size_t enterTextPos, size_t removeEndPos, size_t loadSize);
 
 void TextBuffer_init
     ( TextBuffer * o,
@@ -77,14 +76,17 @@ bool TextBuffer_pop
     if(_noEnoughPlaceInTextStorage(o, textCursor))
         return false;
 
-    const size_t partSize     = o->modules->copyBuffer.size;
-    const size_t removeEndPos = textCursor->pos + textCursor->len;
-    size_t enterTextPos = textCursor->pos;
+    // Текст за областью вставки сдвигается один раз на весь текст буфера,
+    //  по частям текст только переписывается
+    LPM_SelectionCursor removeArea = { textCursor->pos, textCursor->len };
+    if(!TextStorage_beginEdit(o->modules->textStorage, &removeArea, o->usedSize))
+        return false;
+
+    const size_t partSize = o->modules->copyBuffer.size;
     size_t clipboardPos = 0;
     size_t restSize     = o->usedSize;
 
     Unicode_Buf partEnterText;
-    LPM_SelectionCursor partRemoveArea;
 
     for(;;)
     {
@@ -93,31 +95,20 @@ bool TextBuffer_pop
 
         partEnterText.data = o->modules->copyBuffer.data;
         partEnterText.size = loadSize;
-        partRemoveArea.pos = enterTextPos;
-        partRemoveArea.len = _calcPartialRemoveLen(enterTextPos, removeEndPos, loadSize);
 
         _read(o, clipboardPos, loadSize);
-        TextStorage_replace(o->modules->textStorage, &partRemoveArea, &partEnterText);
+        TextStorage_editWrite(o->modules->textStorage, &partEnterText);
 
         if(lastPieceReatched)
-        {
-            enterTextPos += loadSize;
             break;
-        }
 
-        enterTextPos += partSize;
         clipboardPos += partSize;
         restSize -= partSize;
     }
 
-    if(enterTextPos < removeEndPos)
-    {
-        partRemoveArea.pos = enterTextPos;
-        partRemoveArea.len = removeEndPos - enterTextPos;
-        TextStorage_replace(o->modules->textStorage, &partRemoveArea, NULL);
-    }
+    TextStorage_commitEdit(o->modules->textStorage);
 
-    textCursor->pos = enterTextPos;
+    textCursor->pos = removeArea.pos + o->usedSize;
     textCursor->len = 0;
 
     return true;
@@ -149,12 +140,3 @@ void _read(TextBuffer * o, size_t pos, size_t len)
             o->buffer.data + pos,
             len * sizeof(unicode_t) );
 }
-
-size_t _calcPartialRemoveLen(size_t enterTextPos, size_t removeEndPos, size_t loadSize)
-{
-    if(enterTextPos >= removeEndPos)
-        return 0;
-
-    size_t fullRemoveLen = removeEndPos - enterTextPos;
-    return fullRemoveLen >= loadSize ? loadSize : fullRemoveLen;
-}
@@ -26,6 +26,12 @@ bool TextBuffer_pop
     ( TextBuffer * o,
       LPM_SelectionCursor * textCursor );
 
+// Текст был записан в буфер снаружи
+static inline void TextBuffer_setUsedSize(TextBuffer * o, size_t usedSize)
+{
+    o->usedSize = usedSize;
+}
+
 static inline bool TextBuffer_isEmpty(TextBuffer * o)
 {
     return o->usedSize == 0;
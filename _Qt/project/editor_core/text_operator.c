@@ -1,4 +1,5 @@
 #include "text_operator.h"
+#include "text_scan.h"
 #include "lpm_lang_api.h"
 
 static const unicode_t chrEndOfText = 0x0000;
@@ -83,32 +84,38 @@ const unicode_t * TextOperator_prevChar
 bool TextOperator_analizeLine
         ( TextOperator * o,
           const unicode_t  * pchr,
+          const unicode_t  * end,
           size_t maxLenInChrs,
           LPM_TextLineMap * lineMap )
 {
-    bool endOfTextReached = false;
+    const unicode_t * const begin = pchr;
     lineMap->endsWithEndl = false;
 
-    const unicode_t * pWordDiv = pchr + maxLenInChrs;
-    size_t wordDivCnt = maxLenInChrs;
-    size_t chrCnt;
-
-    for(chrCnt = 0; chrCnt < maxLenInChrs; chrCnt++)
+    // Символ не короче кодовой единицы, поэтому конец строки ищется не дальше,
+    //  чем на оставшееся количество символов. Символы считает модуль языка:
+    //  если из-за составных символов их вышло меньше, поиск продолжается
+    size_t chrCnt = 0;
+    while(chrCnt < maxLenInChrs && pchr < end)
     {
-        if(_atEndOfText(*pchr) || _atEndOfLine(*pchr))
+        const size_t restLen = maxLenInChrs - chrCnt;
+        const unicode_t * const limit = (size_t)(end - pchr) > restLen ? pchr + restLen : end;
+        const unicode_t * const endl  = TextScan_findEndOfLine(pchr, limit);
+        for( ; pchr < endl && chrCnt < maxLenInChrs; chrCnt++)
+            pchr = LPM_Lang_nextChar(o->lang, pchr);
+        if(endl != limit)
             break;
+    }
 
-        if(_atSpace(*pchr))
-        {
-            wordDivCnt = chrCnt;
-            pWordDiv   = pchr;
-            if(chrCnt == maxLenInChrs-1)
-                break;
-        }
-
-        pchr = LPM_Lang_nextChar(o->lang, pchr);
+    // Пробел - последний символ строки: строка кончается на нем
+    if(chrCnt == maxLenInChrs && chrCnt > 0 && _atSpace(pchr[-1]))
+    {
+        --pchr;
+        --chrCnt;
     }
 
+    bool endOfTextReached = false;
+    const unicode_t * pWordDiv;
+
     if(_atEndOfText(*pchr))
     {
         _fillLineMapWhenAtEndOfText(pchr, chrCnt, lineMap);
@@ -118,15 +125,27 @@ bool TextOperator_analizeLine
     else if(_atEndOfLine(*pchr) || _atSpace(*pchr))
         _fillLineMapWhenAtEndOfLine(pchr, chrCnt, lineMap);
 
-    else if(wordDivCnt == maxLenInChrs)
+    else if((pWordDiv = TextScan_findLastSpace(begin, pchr)) == pchr)
         _fillLineMapWhenVeryLongWord(pchr, maxLenInChrs, lineMap);
 
     else
-        _fillLineMapWhenWordWrapped(pWordDiv, wordDivCnt, lineMap);
+        _fillLineMapWhenWordWrapped( pWordDiv,
+                                     chrCnt - _calcChrAmountForward(o, pWordDiv, pchr),
+                                     lineMap );
 
     return endOfTextReached;
 }
 
+const unicode_t * TextOperator_findParagraphBegin
+    ( TextOperator * o,
+      const unicode_t * begin,
+      const unicode_t * end )
+{
+    (void)o;
+    const unicode_t * endl = TextScan_findLastEndOfLine(begin, end);
+    return endl != end ? endl + 1 : NULL;
+}
+
 const unicode_t * TextOperator_nextNChar
     ( TextOperator * o,
       const unicode_t * pchr,
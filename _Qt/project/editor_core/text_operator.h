@@ -35,12 +35,33 @@ const unicode_t * TextOperator_prevChar
     ( TextOperator * o,
       const unicode_t * pchr );
 
+/*
+ * Разбор строки с pchr: не больше maxLenInChrs символов, перенос по
+ *  последнему пробелу. Возвращает true, если строка дошла до конца текста.
+ * Конец строки и пробел ищутся функциями TextScan, которые читают кодовые
+ *  единицы подряд, поэтому с pchr до end текст должен быть доступен для
+ *  чтения: до end лежит нулевой символ или вся строка с символом за ней.
+ */
 bool TextOperator_analizeLine(
           TextOperator * o,
           const unicode_t  * pchr,
+          const unicode_t  * end,
           size_t maxLenInChrs,
           LPM_TextLineMap * lineMap );
 
+/*
+ * Разбор строк назад. Перенос строк зависит только от текста абзаца (от
+ *  конца строки до конца строки), поэтому строка перед строкой находится
+ *  повторным разбором абзаца вперед с его начала (см. PageFormatter).
+ * TextOperator_findParagraphBegin возвращает позицию за последним концом
+ *  строки в [begin, end) или NULL, если его там нет (абзац начинается
+ *  раньше begin).
+ */
+const unicode_t * TextOperator_findParagraphBegin
+    ( TextOperator * o,
+      const unicode_t * begin,
+      const unicode_t * end );
+
 const unicode_t * TextOperator_nextNChar
     ( TextOperator * o,
       const unicode_t * pchr,
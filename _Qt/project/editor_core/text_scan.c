@@ -0,0 +1,638 @@
+#include "text_scan.h"
+
+#if !defined(TEXT_SCAN_SCALAR_ONLY) && defined(__GNUC__)
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define TEXT_SCAN_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define TEXT_SCAN_NEON_ENABLED
+#include <arm_neon.h>
+#endif
+#endif
+
+static const unicode_t chrEndOfText = 0x0000;
+static const unicode_t chrCr = 0x000D;
+static const unicode_t chrLf = 0x000A;
+static const unicode_t chrSpace = 0x0020;
+
+typedef struct TextScanFxns
+{
+    const unicode_t * (*findEndOfText)(const unicode_t *, const unicode_t *);
+    const unicode_t * (*findEndOfLine)(const unicode_t *, const unicode_t *);
+    const unicode_t * (*findLastEndOfLine)(const unicode_t *, const unicode_t *);
+    const unicode_t * (*findLastSpace)(const unicode_t *, const unicode_t *);
+    size_t (*countEndsOfLine)(const unicode_t *, const unicode_t *, unicode_t);
+    void (*countEndlTypes)(const unicode_t *, const unicode_t *, unicode_t, TextScan_EndlCount *);
+} TextScanFxns;
+
+static const unicode_t * _scalarFindEndOfText(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _scalarFindEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _scalarFindLastEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _scalarFindLastSpace(const unicode_t * begin, const unicode_t * end);
+static size_t _scalarCountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr);
+static void _scalarCountEndlTypes(const unicode_t * begin, const unicode_t * end, unicode_t nextChr, TextScan_EndlCount * cnt);
+
+static const TextScanFxns scalarFxns =
+{
+    _scalarFindEndOfText,
+    _scalarFindEndOfLine,
+    _scalarFindLastEndOfLine,
+    _scalarFindLastSpace,
+    _scalarCountEndsOfLine,
+    _scalarCountEndlTypes
+};
+
+#ifdef TEXT_SCAN_X86
+
+static const unicode_t * _sse2FindEndOfText(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _sse2FindEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _sse2FindLastEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _sse2FindLastSpace(const unicode_t * begin, const unicode_t * end);
+static size_t _sse2CountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr);
+static void _sse2CountEndlTypes(const unicode_t * begin, const unicode_t * end, unicode_t nextChr, TextScan_EndlCount * cnt);
+
+static const unicode_t * _avx2FindEndOfText(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _avx2FindEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _avx2FindLastEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _avx2FindLastSpace(const unicode_t * begin, const unicode_t * end);
+static size_t _avx2CountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr);
+static void _avx2CountEndlTypes(const unicode_t * begin, const unicode_t * end, unicode_t nextChr, TextScan_EndlCount * cnt);
+
+static const TextScanFxns sse2Fxns =
+{
+    _sse2FindEndOfText,
+    _sse2FindEndOfLine,
+    _sse2FindLastEndOfLine,
+    _sse2FindLastSpace,
+    _sse2CountEndsOfLine,
+    _sse2CountEndlTypes
+};
+
+static const TextScanFxns avx2Fxns =
+{
+    _avx2FindEndOfText,
+    _avx2FindEndOfLine,
+    _avx2FindLastEndOfLine,
+    _avx2FindLastSpace,
+    _avx2CountEndsOfLine,
+    _avx2CountEndlTypes
+};
+
+#endif // TEXT_SCAN_X86
+
+#ifdef TEXT_SCAN_NEON_ENABLED
+
+static const unicode_t * _neonFindEndOfText(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _neonFindEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _neonFindLastEndOfLine(const unicode_t * begin, const unicode_t * end);
+static const unicode_t * _neonFindLastSpace(const unicode_t * begin, const unicode_t * end);
+static size_t _neonCountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr);
+static void _neonCountEndlTypes(const unicode_t * begin, const unicode_t * end, unicode_t nextChr, TextScan_EndlCount * cnt);
+
+static const TextScanFxns neonFxns =
+{
+    _neonFindEndOfText,
+    _neonFindEndOfLine,
+    _neonFindLastEndOfLine,
+    _neonFindLastSpace,
+    _neonCountEndsOfLine,
+    _neonCountEndlTypes
+};
+
+#endif // TEXT_SCAN_NEON_ENABLED
+
+// До TextScan_init работает скалярный вариант
+static const TextScanFxns * fxns = &scalarFxns;
+static TextScan_Variant currVariant = TEXT_SCAN_SCALAR;
+
+static const TextScanFxns * _variantFxns(TextScan_Variant variant);
+static bool _isEndOfLine(const unicode_t * pchr, const unicode_t * end, unicode_t nextChr);
+
+bool TextScan_init(TextScan_Variant variant)
+{
+    const TextScanFxns * variantFxns = _variantFxns(variant);
+    if(variantFxns == NULL)
+        return false;
+
+    fxns        = variantFxns;
+    currVariant = variant;
+    return true;
+}
+
+TextScan_Variant TextScan_bestVariant(void)
+{
+#if defined(TEXT_SCAN_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return TEXT_SCAN_AVX2;
+    return TEXT_SCAN_SSE2;
+#elif defined(TEXT_SCAN_NEON_ENABLED)
+    return TEXT_SCAN_NEON;
+#else
+    return TEXT_SCAN_SCALAR;
+#endif
+}
+
+TextScan_Variant TextScan_variant(void)
+{
+    return currVariant;
+}
+
+const unicode_t * TextScan_findEndOfText(const unicode_t * begin, const unicode_t * end)
+{
+    return (*fxns->findEndOfText)(begin, end);
+}
+
+const unicode_t * TextScan_findEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    return (*fxns->findEndOfLine)(begin, end);
+}
+
+const unicode_t * TextScan_findLastEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    return (*fxns->findLastEndOfLine)(begin, end);
+}
+
+const unicode_t * TextScan_findLastSpace(const unicode_t * begin, const unicode_t * end)
+{
+    return (*fxns->findLastSpace)(begin, end);
+}
+
+size_t TextScan_countEndsOfLine
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr )
+{
+    return (*fxns->countEndsOfLine)(begin, end, nextChr);
+}
+
+void TextScan_countEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt )
+{
+    // Варианты считают все CR, все LF и CR, за которыми следует LF, а пары
+    //  вычитаются здесь. LF последней пары может быть за диапазоном (nextChr) -
+    //  тогда среди LF его нет
+    cnt->cr = cnt->lf = cnt->crLf = 0;
+    (*fxns->countEndlTypes)(begin, end, nextChr, cnt);
+
+    size_t lfInPairs = cnt->crLf;
+    if(begin != end && end[-1] == chrCr && nextChr == chrLf)
+        lfInPairs--;
+    cnt->cr -= cnt->crLf;
+    cnt->lf -= lfInPairs;
+}
+
+const TextScanFxns * _variantFxns(TextScan_Variant variant)
+{
+    switch(variant)
+    {
+    case TEXT_SCAN_SCALAR:
+        return &scalarFxns;
+#ifdef TEXT_SCAN_X86
+    case TEXT_SCAN_SSE2:
+        return &sse2Fxns;
+    case TEXT_SCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &avx2Fxns : NULL;
+#endif
+#ifdef TEXT_SCAN_NEON_ENABLED
+    case TEXT_SCAN_NEON:
+        return &neonFxns;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+bool _isEndOfLine(const unicode_t * pchr, const unicode_t * end, unicode_t nextChr)
+{
+    if(*pchr == chrLf)
+        return true;
+    if(*pchr != chrCr)
+        return false;
+    return (pchr + 1 < end ? pchr[1] : nextChr) != chrLf;
+}
+
+
+/*
+ * Скалярный вариант - он же дочитывает хвосты диапазонов, не кратные длине
+ *  вектора, в векторных вариантах
+ */
+
+const unicode_t * _scalarFindEndOfText(const unicode_t * begin, const unicode_t * end)
+{
+    for( ; begin != end; begin++)
+        if(*begin == chrEndOfText)
+            break;
+    return begin;
+}
+
+const unicode_t * _scalarFindEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    for( ; begin != end; begin++)
+        if(*begin == chrEndOfText || *begin == chrCr || *begin == chrLf)
+            break;
+    return begin;
+}
+
+const unicode_t * _scalarFindLastEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const unicode_t * pchr;
+    for(pchr = end; pchr != begin; )
+    {
+        --pchr;
+        if(*pchr == chrCr || *pchr == chrLf)
+            return pchr;
+    }
+    return end;
+}
+
+const unicode_t * _scalarFindLastSpace(const unicode_t * begin, const unicode_t * end)
+{
+    const unicode_t * pchr;
+    for(pchr = end; pchr != begin; )
+        if(*--pchr == chrSpace)
+            return pchr;
+    return end;
+}
+
+size_t _scalarCountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr)
+{
+    size_t cnt = 0;
+    for( ; begin != end; begin++)
+        if(_isEndOfLine(begin, end, nextChr))
+            cnt++;
+    return cnt;
+}
+
+void _scalarCountEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt )
+{
+    for( ; begin != end; begin++)
+    {
+        if(*begin == chrLf)
+            cnt->lf++;
+        else if(*begin == chrCr)
+        {
+            cnt->cr++;
+            if((begin + 1 < end ? begin[1] : nextChr) == chrLf)
+                cnt->crLf++;
+        }
+    }
+}
+
+
+#ifdef TEXT_SCAN_X86
+
+/*
+ * В масках сравнения на каждую кодовую единицу приходится по два бита,
+ *  поэтому номер бита делится на два
+ */
+
+#define SSE2_UNITS 8
+#define AVX2_UNITS 16
+
+/*
+ * Хвосты AVX2 дочитываются вариантом SSE2. Перед ним старшие половины
+ *  регистров обнуляются (_mm256_zeroupper), иначе смена AVX на SSE стоит
+ *  процессору лишних тактов, заметных на коротких строках
+ */
+
+const unicode_t * _sse2FindEndOfText(const unicode_t * begin, const unicode_t * end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for( ; end - begin >= SSE2_UNITS; begin += SSE2_UNITS)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)begin);
+        int mask  = _mm_movemask_epi8(_mm_cmpeq_epi16(v, zero));
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / 2;
+    }
+    return _scalarFindEndOfText(begin, end);
+}
+
+const unicode_t * _sse2FindEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cr   = _mm_set1_epi16((short)chrCr);
+    const __m128i lf   = _mm_set1_epi16((short)chrLf);
+    for( ; end - begin >= SSE2_UNITS; begin += SSE2_UNITS)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)begin);
+        __m128i m = _mm_or_si128( _mm_cmpeq_epi16(v, zero),
+                                  _mm_or_si128( _mm_cmpeq_epi16(v, cr),
+                                                _mm_cmpeq_epi16(v, lf) ) );
+        int mask = _mm_movemask_epi8(m);
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / 2;
+    }
+    return _scalarFindEndOfLine(begin, end);
+}
+
+// Векторы берутся с конца диапазона, совпадение в векторе - старший бит маски
+const unicode_t * _sse2FindLastEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const __m128i cr = _mm_set1_epi16((short)chrCr);
+    const __m128i lf = _mm_set1_epi16((short)chrLf);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= SSE2_UNITS; pchr -= SSE2_UNITS)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pchr - SSE2_UNITS));
+        int mask  = _mm_movemask_epi8(_mm_or_si128( _mm_cmpeq_epi16(v, cr),
+                                                    _mm_cmpeq_epi16(v, lf) ));
+        if(mask != 0)
+            return pchr - SSE2_UNITS + (31 - __builtin_clz(mask)) / 2;
+    }
+    const unicode_t * lastEndl = _scalarFindLastEndOfLine(begin, pchr);
+    return lastEndl != pchr ? lastEndl : end;
+}
+
+const unicode_t * _sse2FindLastSpace(const unicode_t * begin, const unicode_t * end)
+{
+    const __m128i space = _mm_set1_epi16((short)chrSpace);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= SSE2_UNITS; pchr -= SSE2_UNITS)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pchr - SSE2_UNITS));
+        int mask  = _mm_movemask_epi8(_mm_cmpeq_epi16(v, space));
+        if(mask != 0)
+            return pchr - SSE2_UNITS + (31 - __builtin_clz(mask)) / 2;
+    }
+    const unicode_t * lastSpace = _scalarFindLastSpace(begin, pchr);
+    return lastSpace != pchr ? lastSpace : end;
+}
+
+size_t _sse2CountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr)
+{
+    const __m128i cr = _mm_set1_epi16((short)chrCr);
+    const __m128i lf = _mm_set1_epi16((short)chrLf);
+    size_t cnt = 0;
+
+    // Следующий символ читается из памяти, поэтому последний вектор - в хвост
+    for( ; end - begin > SSE2_UNITS; begin += SSE2_UNITS)
+    {
+        __m128i v    = _mm_loadu_si128((const __m128i*)begin);
+        __m128i next = _mm_loadu_si128((const __m128i*)(begin + 1));
+        __m128i isCr = _mm_cmpeq_epi16(v, cr);
+        __m128i crLf = _mm_and_si128(isCr, _mm_cmpeq_epi16(next, lf));
+        __m128i ends = _mm_or_si128( _mm_cmpeq_epi16(v, lf),
+                                     _mm_andnot_si128(crLf, isCr) );
+        cnt += __builtin_popcount(_mm_movemask_epi8(ends)) / 2;
+    }
+    return cnt + _scalarCountEndsOfLine(begin, end, nextChr);
+}
+
+void _sse2CountEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt )
+{
+    const __m128i cr = _mm_set1_epi16((short)chrCr);
+    const __m128i lf = _mm_set1_epi16((short)chrLf);
+
+    for( ; end - begin > SSE2_UNITS; begin += SSE2_UNITS)
+    {
+        __m128i v    = _mm_loadu_si128((const __m128i*)begin);
+        __m128i next = _mm_loadu_si128((const __m128i*)(begin + 1));
+        __m128i isCr = _mm_cmpeq_epi16(v, cr);
+        __m128i crLf = _mm_and_si128(isCr, _mm_cmpeq_epi16(next, lf));
+        cnt->cr   += __builtin_popcount(_mm_movemask_epi8(isCr)) / 2;
+        cnt->lf   += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi16(v, lf))) / 2;
+        cnt->crLf += __builtin_popcount(_mm_movemask_epi8(crLf)) / 2;
+    }
+    _scalarCountEndlTypes(begin, end, nextChr, cnt);
+}
+
+__attribute__((target("avx2")))
+const unicode_t * _avx2FindEndOfText(const unicode_t * begin, const unicode_t * end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    for( ; end - begin >= AVX2_UNITS; begin += AVX2_UNITS)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)begin);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, zero));
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / 2;
+    }
+    _mm256_zeroupper();
+    return _sse2FindEndOfText(begin, end);
+}
+
+__attribute__((target("avx2")))
+const unicode_t * _avx2FindEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cr   = _mm256_set1_epi16((short)chrCr);
+    const __m256i lf   = _mm256_set1_epi16((short)chrLf);
+    for( ; end - begin >= AVX2_UNITS; begin += AVX2_UNITS)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)begin);
+        __m256i m = _mm256_or_si256( _mm256_cmpeq_epi16(v, zero),
+                                     _mm256_or_si256( _mm256_cmpeq_epi16(v, cr),
+                                                      _mm256_cmpeq_epi16(v, lf) ) );
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / 2;
+    }
+    _mm256_zeroupper();
+    return _sse2FindEndOfLine(begin, end);
+}
+
+__attribute__((target("avx2")))
+const unicode_t * _avx2FindLastEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const __m256i cr = _mm256_set1_epi16((short)chrCr);
+    const __m256i lf = _mm256_set1_epi16((short)chrLf);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= AVX2_UNITS; pchr -= AVX2_UNITS)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pchr - AVX2_UNITS));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi16(v, cr), _mm256_cmpeq_epi16(v, lf)) );
+        if(mask != 0)
+            return pchr - AVX2_UNITS + (31 - __builtin_clz(mask)) / 2;
+    }
+    _mm256_zeroupper();
+    const unicode_t * lastEndl = _sse2FindLastEndOfLine(begin, pchr);
+    return lastEndl != pchr ? lastEndl : end;
+}
+
+__attribute__((target("avx2")))
+const unicode_t * _avx2FindLastSpace(const unicode_t * begin, const unicode_t * end)
+{
+    const __m256i space = _mm256_set1_epi16((short)chrSpace);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= AVX2_UNITS; pchr -= AVX2_UNITS)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pchr - AVX2_UNITS));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, space));
+        if(mask != 0)
+            return pchr - AVX2_UNITS + (31 - __builtin_clz(mask)) / 2;
+    }
+    _mm256_zeroupper();
+    const unicode_t * lastSpace = _sse2FindLastSpace(begin, pchr);
+    return lastSpace != pchr ? lastSpace : end;
+}
+
+__attribute__((target("avx2")))
+size_t _avx2CountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr)
+{
+    const __m256i cr = _mm256_set1_epi16((short)chrCr);
+    const __m256i lf = _mm256_set1_epi16((short)chrLf);
+    size_t cnt = 0;
+
+    for( ; end - begin > AVX2_UNITS; begin += AVX2_UNITS)
+    {
+        __m256i v    = _mm256_loadu_si256((const __m256i*)begin);
+        __m256i next = _mm256_loadu_si256((const __m256i*)(begin + 1));
+        __m256i isCr = _mm256_cmpeq_epi16(v, cr);
+        __m256i crLf = _mm256_and_si256(isCr, _mm256_cmpeq_epi16(next, lf));
+        __m256i ends = _mm256_or_si256( _mm256_cmpeq_epi16(v, lf),
+                                        _mm256_andnot_si256(crLf, isCr) );
+        cnt += __builtin_popcount((unsigned)_mm256_movemask_epi8(ends)) / 2;
+    }
+    _mm256_zeroupper();
+    return cnt + _sse2CountEndsOfLine(begin, end, nextChr);
+}
+
+__attribute__((target("avx2")))
+void _avx2CountEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt )
+{
+    const __m256i cr = _mm256_set1_epi16((short)chrCr);
+    const __m256i lf = _mm256_set1_epi16((short)chrLf);
+
+    for( ; end - begin > AVX2_UNITS; begin += AVX2_UNITS)
+    {
+        __m256i v    = _mm256_loadu_si256((const __m256i*)begin);
+        __m256i next = _mm256_loadu_si256((const __m256i*)(begin + 1));
+        __m256i isCr = _mm256_cmpeq_epi16(v, cr);
+        __m256i crLf = _mm256_and_si256(isCr, _mm256_cmpeq_epi16(next, lf));
+        cnt->cr   += __builtin_popcount((unsigned)_mm256_movemask_epi8(isCr)) / 2;
+        cnt->lf   += __builtin_popcount((unsigned)_mm256_movemask_epi8(
+                                            _mm256_cmpeq_epi16(v, lf))) / 2;
+        cnt->crLf += __builtin_popcount((unsigned)_mm256_movemask_epi8(crLf)) / 2;
+    }
+    _mm256_zeroupper();
+    _sse2CountEndlTypes(begin, end, nextChr, cnt);
+}
+
+#endif // TEXT_SCAN_X86
+
+
+#ifdef TEXT_SCAN_NEON_ENABLED
+
+/*
+ * В NEON нет сборки маски из старших битов, поэтому вектор только проверяется
+ *  на совпадение, а место совпадения ищется скалярным вариантом в пределах
+ *  вектора
+ */
+
+#define NEON_UNITS 8
+
+const unicode_t * _neonFindEndOfText(const unicode_t * begin, const unicode_t * end)
+{
+    for( ; end - begin >= NEON_UNITS; begin += NEON_UNITS)
+    {
+        uint16x8_t v = vld1q_u16(begin);
+        if(vmaxvq_u16(vceqzq_u16(v)) != 0)
+            return _scalarFindEndOfText(begin, begin + NEON_UNITS);
+    }
+    return _scalarFindEndOfText(begin, end);
+}
+
+const unicode_t * _neonFindEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const uint16x8_t cr = vdupq_n_u16(chrCr);
+    const uint16x8_t lf = vdupq_n_u16(chrLf);
+    for( ; end - begin >= NEON_UNITS; begin += NEON_UNITS)
+    {
+        uint16x8_t v = vld1q_u16(begin);
+        uint16x8_t m = vorrq_u16( vceqzq_u16(v),
+                                  vorrq_u16(vceqq_u16(v, cr), vceqq_u16(v, lf)) );
+        if(vmaxvq_u16(m) != 0)
+            return _scalarFindEndOfLine(begin, begin + NEON_UNITS);
+    }
+    return _scalarFindEndOfLine(begin, end);
+}
+
+const unicode_t * _neonFindLastEndOfLine(const unicode_t * begin, const unicode_t * end)
+{
+    const uint16x8_t cr = vdupq_n_u16(chrCr);
+    const uint16x8_t lf = vdupq_n_u16(chrLf);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= NEON_UNITS; pchr -= NEON_UNITS)
+    {
+        uint16x8_t v = vld1q_u16(pchr - NEON_UNITS);
+        if(vmaxvq_u16(vorrq_u16(vceqq_u16(v, cr), vceqq_u16(v, lf))) != 0)
+            return _scalarFindLastEndOfLine(pchr - NEON_UNITS, pchr);
+    }
+    const unicode_t * lastEndl = _scalarFindLastEndOfLine(begin, pchr);
+    return lastEndl != pchr ? lastEndl : end;
+}
+
+const unicode_t * _neonFindLastSpace(const unicode_t * begin, const unicode_t * end)
+{
+    const uint16x8_t space = vdupq_n_u16(chrSpace);
+    const unicode_t * pchr;
+    for(pchr = end; pchr - begin >= NEON_UNITS; pchr -= NEON_UNITS)
+    {
+        uint16x8_t v = vld1q_u16(pchr - NEON_UNITS);
+        if(vmaxvq_u16(vceqq_u16(v, space)) != 0)
+            return _scalarFindLastSpace(pchr - NEON_UNITS, pchr);
+    }
+    const unicode_t * lastSpace = _scalarFindLastSpace(begin, pchr);
+    return lastSpace != pchr ? lastSpace : end;
+}
+
+size_t _neonCountEndsOfLine(const unicode_t * begin, const unicode_t * end, unicode_t nextChr)
+{
+    const uint16x8_t cr = vdupq_n_u16(chrCr);
+    const uint16x8_t lf = vdupq_n_u16(chrLf);
+    size_t cnt = 0;
+
+    for( ; end - begin > NEON_UNITS; begin += NEON_UNITS)
+    {
+        uint16x8_t v    = vld1q_u16(begin);
+        uint16x8_t next = vld1q_u16(begin + 1);
+        uint16x8_t isCr = vceqq_u16(v, cr);
+        uint16x8_t crLf = vandq_u16(isCr, vceqq_u16(next, lf));
+        uint16x8_t ends = vorrq_u16(vceqq_u16(v, lf), vbicq_u16(isCr, crLf));
+        cnt += vaddvq_u16(vshrq_n_u16(ends, 15));
+    }
+    return cnt + _scalarCountEndsOfLine(begin, end, nextChr);
+}
+
+void _neonCountEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt )
+{
+    const uint16x8_t cr = vdupq_n_u16(chrCr);
+    const uint16x8_t lf = vdupq_n_u16(chrLf);
+
+    for( ; end - begin > NEON_UNITS; begin += NEON_UNITS)
+    {
+        uint16x8_t v    = vld1q_u16(begin);
+        uint16x8_t next = vld1q_u16(begin + 1);
+        uint16x8_t isCr = vceqq_u16(v, cr);
+        uint16x8_t crLf = vandq_u16(isCr, vceqq_u16(next, lf));
+        cnt->cr   += vaddvq_u16(vshrq_n_u16(isCr, 15));
+        cnt->lf   += vaddvq_u16(vshrq_n_u16(vceqq_u16(v, lf), 15));
+        cnt->crLf += vaddvq_u16(vshrq_n_u16(crLf, 15));
+    }
+    _scalarCountEndlTypes(begin, end, nextChr, cnt);
+}
+
+#endif // TEXT_SCAN_NEON_ENABLED
@@ -0,0 +1,68 @@
+#ifndef TEXT_SCAN_H
+#define TEXT_SCAN_H
+
+#include "lpm_unicode.h"
+#include "lpm_structs.h"
+
+/*
+ * Просмотр текста по кодовым единицам: поиск конца текста, конца строки,
+ *  последнего конца строки и последнего пробела, подсчет концов строк (всех и
+ *  по видам). Каждая функция есть в нескольких вариантах - скалярном
+ *  (собирается везде) и векторных (SSE2, AVX2 - для x86 при сборке GCC/Clang,
+ *  NEON - для AArch64), все варианты дают одинаковый результат. Вариант
+ *  выбирается явно (TextScan_init) - Controller делает это при запуске
+ *  редактора, до первого просмотра и до запуска потоков разбивки на
+ *  страницы. До этого работает скалярный вариант.
+ * Макрос TEXT_SCAN_SCALAR_ONLY оставляет только скалярный вариант.
+ * Диапазон [begin, end) просматривается целиком, нулевой символ внутри
+ *  диапазона - обычный символ (кроме поиска конца текста и конца строки).
+ */
+
+// Концы строк по видам (тот же подсчет дает проверка текста при загрузке,
+//  см. lpm_encoding_api.h)
+typedef LPM_EndlCount TextScan_EndlCount;
+
+typedef enum TextScan_Variant
+{
+    TEXT_SCAN_SCALAR = 0,
+    TEXT_SCAN_SSE2,
+    TEXT_SCAN_AVX2,
+    TEXT_SCAN_NEON
+} TextScan_Variant;
+
+// Первый нулевой символ или end
+const unicode_t * TextScan_findEndOfText(const unicode_t * begin, const unicode_t * end);
+
+// Первый символ CR, LF или нулевой, или end
+const unicode_t * TextScan_findEndOfLine(const unicode_t * begin, const unicode_t * end);
+
+// Последний символ CR или LF, или end, если их нет
+const unicode_t * TextScan_findLastEndOfLine(const unicode_t * begin, const unicode_t * end);
+
+// Последний пробел или end, если пробела нет
+const unicode_t * TextScan_findLastSpace(const unicode_t * begin, const unicode_t * end);
+
+// Количество концов строк (LF или CR, за которым не следует LF). nextChr -
+//  символ сразу за диапазоном (нулевой, если за ним ничего нет)
+size_t TextScan_countEndsOfLine
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr );
+
+// Количество концов строк каждого вида. nextChr - как в countEndsOfLine; LF
+//  в начале диапазона считается одиночным
+void TextScan_countEndlTypes
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          unicode_t nextChr,
+          TextScan_EndlCount * cnt );
+
+// Выбор варианта. Неподдерживаемый процессором или сборкой вариант не
+//  выбирается - тогда возвращается false
+bool TextScan_init(TextScan_Variant variant);
+
+// Лучший вариант для этого процессора и выбранный сейчас
+TextScan_Variant TextScan_bestVariant(void);
+TextScan_Variant TextScan_variant(void);
+
+#endif // TEXT_SCAN_H
@@ -37,6 +37,11 @@ static void _replace( TextStorageImpl * textStorage,
 static bool _removingAreaAbutsFreeSpace( const TextStorageImpl * textStorage,
                                          const LPM_SelectionCursor * removingArea );
 
+static void _registerChange( TextStorage * o,
+                             size_t pos,
+                             size_t removeLen,
+                             size_t writeLen );
+
 static void _modifyRecvCursor
         ( TextStorage * o,
           const LPM_SelectionCursor * removeArea,
@@ -71,12 +76,101 @@ bool TextStorage_replace
 
     _decomposeToSimpleFxns(
                 o->m->textStorageImpl, removingArea, &textBuffer);
+    _registerChange(o, removingArea->pos, removingArea->len, textBuffer.size);
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex_update( &o->lineIndex, o->m->textStorageImpl,
+                      removingArea->pos, removingArea->len, textBuffer.size );
+#endif
 
     _modifyRecvCursor(o, removingArea, &textBuffer);
 
     return true;
 }
 
+bool TextStorage_beginEdit
+        ( TextStorage * o,
+          LPM_SelectionCursor * removingArea,
+          size_t writeTextSize )
+{
+    TextStorageImpl * impl = o->m->textStorageImpl;
+
+    _normalizeRemovingArea(impl, removingArea);
+
+    if(_notEnoughSpaceToRemoveAndWrite(impl, removingArea, writeTextSize))
+        return false;
+
+    size_t removingLen = (size_t)removingArea->len;
+
+    o->editArea.pos = removingArea->pos;
+    o->editArea.len = removingArea->len;
+    o->editSize     = writeTextSize;
+    o->editPos      = removingArea->pos;
+
+    if(writeTextSize > removingLen)
+    {
+        TextStorageImpl_expand( impl, removingArea->pos + removingLen,
+                                writeTextSize - removingLen );
+    }
+    else if(writeTextSize < removingLen)
+    {
+        LPM_SelectionCursor restArea = { removingArea->pos + writeTextSize,
+                                         removingLen - writeTextSize };
+        _remove(impl, &restArea);
+    }
+
+    return true;
+}
+
+void TextStorage_editWrite
+        ( TextStorage * o,
+          const Unicode_Buf * textToWrite )
+{
+    size_t restSize = o->editArea.pos + o->editSize - o->editPos;
+    Unicode_Buf buf = { textToWrite->data,
+                        textToWrite->size < restSize ? textToWrite->size : restSize };
+
+    if(buf.size > 0)
+        TextStorageImpl_replace(o->m->textStorageImpl, &buf, o->editPos);
+
+    // Курсор восстановления меняется так же, как при замене каждой части
+    //  отдельным TextStorage_replace: часть заменяет столько же удаляемого
+    //  текста, сколько его осталось за ней
+    LPM_SelectionCursor partArea = { o->editPos, 0 };
+    size_t removeEnd = o->editArea.pos + o->editArea.len;
+    if(o->editPos < removeEnd)
+        partArea.len = removeEnd - o->editPos < buf.size ?
+                    removeEnd - o->editPos : buf.size;
+    _modifyRecvCursor(o, &partArea, &buf);
+
+    o->editPos += buf.size;
+}
+
+void TextStorage_commitEdit(TextStorage * o)
+{
+    LPM_SelectionCursor restArea = { o->editPos,
+                                     o->editArea.pos + o->editSize - o->editPos };
+    if(restArea.len > 0)
+        _remove(o->m->textStorageImpl, &restArea);
+
+    Unicode_Buf writtenText = { NULL, o->editPos - o->editArea.pos };
+    _registerChange(o, o->editArea.pos, o->editArea.len, writtenText.size);
+
+    // Удаляемый текст, не замененный частями, удаляется целиком
+    size_t removeEnd = o->editArea.pos + o->editArea.len;
+    if(o->editPos < removeEnd)
+    {
+        LPM_SelectionCursor restRemoveArea = { o->editPos, removeEnd - o->editPos };
+        Unicode_Buf noText = { NULL, 0 };
+        _modifyRecvCursor(o, &restRemoveArea, &noText);
+    }
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex_update( &o->lineIndex, o->m->textStorageImpl,
+                      o->editArea.pos, o->editArea.len, writtenText.size );
+#endif
+}
+
 void TextStorage_read
         ( TextStorage * o,
           size_t readPosition,
@@ -97,6 +191,24 @@ void TextStorage_read
     TextStorageImpl_read(o->m->textStorageImpl, readPosition, readTextBuffer);
 }
 
+size_t TextStorage_readSpans
+        ( TextStorage * o,
+          size_t readPosition,
+          size_t readSize,
+          TextStorageImpl_Span * spans )
+{
+    size_t endOfText = TextStorageImpl_endOfText(o->m->textStorageImpl);
+    if(readPosition >= endOfText)
+        return 0;
+
+    size_t distToEndOfText = endOfText - readPosition;
+    if(readSize > distToEndOfText)
+        readSize = distToEndOfText;
+
+    return TextStorageImpl_readSpans( o->m->textStorageImpl,
+                                      readPosition, readSize, spans );
+}
+
 bool TextStorage_enoughPlace
         ( TextStorage * o,
           const LPM_SelectionCursor * removingArea,
@@ -117,11 +229,50 @@ void TextStorage_sync(TextStorage * o, size_t pos)
 
     LPM_SelectionCursor writeCursor;
     _normalizeRecvCursor(o, &writeCursor);
+
+#ifdef TEXT_STORAGE_IMPL_SNAPSHOTS
+    // Точка восстановления - снимок всего текста. Страница копируется в буфер
+    //  восстановления, только если хранилище бросит снимок
+    TextBuffer_clear(o->m->recoveryBuffer);
+    o->recvSnapshot.page.data = o->m->recoveryBuffer->buffer.data;
+    o->recvSnapshot.page.size = writeCursor.len;
+    o->recvSnapshot.pagePos   = writeCursor.pos;
+    TextStorageImpl_saveSnapshot(o->m->textStorageImpl, &o->recvSnapshot);
+#else
     TextBuffer_push(o->m->recoveryBuffer, &writeCursor);
+#endif
 }
 
 void TextStorage_recv(TextStorage * o, LPM_SelectionCursor * cursor)
 {
+#ifdef TEXT_STORAGE_IMPL_SNAPSHOTS
+    TextStorageImpl * impl = o->m->textStorageImpl;
+    if(TextStorageImpl_snapshotIsValid(impl, &o->recvSnapshot))
+    {
+        TextStorageImpl_restoreSnapshot(impl, &o->recvSnapshot);
+        o->changes.known = false;
+#ifdef TEXT_STORAGE_LINE_INDEX
+        LineIndex_invalidate(&o->lineIndex);
+#endif
+        // Текст снова такой же, как при сохранении - копию страницы тоже
+        //  нужно взять заново
+        TextStorage_sync(o, o->recvCursor.pos);
+        cursor->pos = o->recvCursor.pos;
+        cursor->len = 0;
+        return;
+    }
+
+    // Снимок пропал - остается копия страницы, снятая с него, если после
+    //  сохранения правки не выходили за страницу. Иначе вернуть нечего
+    if(o->needToSync || !o->recvSnapshot.pageSaved)
+    {
+        size_t endOfText = TextStorageImpl_endOfText(impl);
+        cursor->pos = o->recvCursor.pos < endOfText ? o->recvCursor.pos : endOfText;
+        cursor->len = 0;
+        return;
+    }
+    TextBuffer_setUsedSize(o->m->recoveryBuffer, o->recvSnapshot.page.size);
+#endif
     o->needToSync = true;
 
     LPM_SelectionCursor tmp = { o->recvCursor.pos, o->recvCursor.len };
@@ -285,6 +436,35 @@ bool _removingAreaAbutsFreeSpace( const TextStorageImpl * textStorage,
             TextStorageImpl_endOfText(textStorage);
 }
 
+void _registerChange( TextStorage * o,
+                      size_t pos,
+                      size_t removeLen,
+                      size_t writeLen )
+{
+    TextStorage_Changes * ch = &o->changes;
+    size_t writeEnd = pos + writeLen;
+
+    if(!ch->changed)
+    {
+        ch->changed = true;
+        ch->begin   = pos;
+        ch->end     = writeEnd;
+        return;
+    }
+
+    // Конец прежнего участка сдвигается правкой, если лежит за ней, и
+    //  поглощается ею, если лежит внутри удаленного
+    if(ch->end >= pos + removeLen)
+        ch->end = ch->end - removeLen + writeLen;
+    else if(ch->end > pos)
+        ch->end = writeEnd;
+
+    if(ch->end < writeEnd)
+        ch->end = writeEnd;
+    if(ch->begin > pos)
+        ch->begin = pos;
+}
+
 void _modifyRecvCursor
         ( TextStorage * o,
           const LPM_SelectionCursor * removeArea,
@@ -4,12 +4,40 @@
 #include "lpm_structs.h"
 #include "text_storage_impl.h"
 #include "modules.h"
+#ifdef TEXT_STORAGE_LINE_INDEX
+#include "line_index.h"
+#endif
+
+/*
+ * Участок, измененный после TextStorage_resetChanges: с позиции begin до end
+ *  в текущем тексте (несколько правок объединяются в один участок), до правок
+ *  текст кончался на oldEndOfText. Если known == false, изменения неизвестны
+ *  (текст заменялся целиком).
+ */
+typedef struct TextStorage_Changes
+{
+    size_t begin;
+    size_t end;
+    size_t oldEndOfText;
+    bool changed;
+    bool known;
+} TextStorage_Changes;
 
 typedef struct TextStorage
 {
     const Modules * m;
     LPM_SelectionCursor recvCursor;
     bool needToSync;
+#ifdef TEXT_STORAGE_IMPL_SNAPSHOTS
+    TextStorageImpl_Snapshot recvSnapshot;
+#endif
+    LPM_SelectionCursor editArea;
+    size_t editSize;
+    size_t editPos;
+    TextStorage_Changes changes;
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex lineIndex;
+#endif
 } TextStorage;
 
 bool TextStorage_replace
@@ -17,11 +45,37 @@ bool TextStorage_replace
           LPM_SelectionCursor * removingArea,
           const Unicode_Buf * textToWrite );
 
+/*
+ * Правка по частям: текст, который заменяет removingArea, пишется несколькими
+ *  вызовами TextStorage_editWrite подряд. TextStorage_beginEdit сразу
+ *  сдвигает текст за областью на нужное место (один раз на всю правку),
+ *  части только переписывают освободившийся участок. Если записано меньше,
+ *  чем writeTextSize, остаток участка удаляется в TextStorage_commitEdit.
+ *  Курсор восстановления меняется по частям, как при замене каждой части
+ *  отдельным TextStorage_replace.
+ */
+bool TextStorage_beginEdit
+        ( TextStorage * o,
+          LPM_SelectionCursor * removingArea,
+          size_t writeTextSize );
+
+void TextStorage_editWrite
+        ( TextStorage * o,
+          const Unicode_Buf * textToWrite );
+
+void TextStorage_commitEdit(TextStorage * o);
+
 void TextStorage_read
         ( TextStorage * o,
           size_t readPosition,
           Unicode_Buf * readTextBuffer );
 
+size_t TextStorage_readSpans
+        ( TextStorage * o,
+          size_t readPosition,
+          size_t readSize,
+          TextStorageImpl_Span * spans );
+
 //bool TextStorage_enoughPlace
 //        ( TextStorage * o,
 //          const LPM_SelectionCursor * removingArea,
@@ -41,11 +95,32 @@ static inline void TextStorage_init
 {
     o->m = m;
     o->needToSync = false;
+    o->changes.changed = false;
+    o->changes.known   = false;
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex_init( &o->lineIndex, m->lineIndexHeap,
+                    TextStorageImpl_freeSize(m->textStorageImpl) +
+                    TextStorageImpl_endOfText(m->textStorageImpl) );
+#endif
 }
 
 static inline void TextStorage_clear(TextStorage * o, bool deep)
 {
     TextStorageImpl_clear(o->m->textStorageImpl, deep);
+    o->changes.known = false;
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex_invalidate(&o->lineIndex);
+#endif
+}
+
+// Текст был записан в буфер текста снаружи
+static inline void TextStorage_recalcEndOfText(TextStorage * o)
+{
+    TextStorageImpl_recalcEndOfText(o->m->textStorageImpl);
+    o->changes.known = false;
+#ifdef TEXT_STORAGE_LINE_INDEX
+    LineIndex_invalidate(&o->lineIndex);
+#endif
 }
 
 static inline size_t TextStorage_freeSize(TextStorage * o)
@@ -58,9 +133,65 @@ static inline size_t TextStorage_endOfText(TextStorage * o)
     return TextStorageImpl_endOfText(o->m->textStorageImpl);
 }
 
+/*
+ * Правка вышла за страницу, сохраненную для восстановления, и точку
+ *  восстановления нужно перенести (TextStorage_sync). В сборке со снимками
+ *  (TEXT_STORAGE_IMPL_SNAPSHOTS) всегда false: точка восстановления - снимок
+ *  всего текста, и сама по себе она не переносится, а только явным вызовом
+ *  TextStorage_sync.
+ */
 static inline bool TextStorage_needToSync(TextStorage * o)
 {
+#ifdef TEXT_STORAGE_IMPL_SNAPSHOTS
+    // needToSync здесь значит лишь то, что копия страницы больше не годится
+    //  (см. TextStorage_recv)
+    (void)o;
+    return false;
+#else
     return o->needToSync;
+#endif
+}
+
+static inline const TextStorage_Changes * TextStorage_changes(TextStorage * o)
+{
+    return &o->changes;
+}
+
+static inline void TextStorage_resetChanges(TextStorage * o)
+{
+    o->changes.changed      = false;
+    o->changes.known        = true;
+    o->changes.oldEndOfText = TextStorageImpl_endOfText(o->m->textStorageImpl);
+}
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+// Строки - жесткие (по символам конца строки), см. line_index.h
+static inline size_t TextStorage_linesAmount(TextStorage * o)
+{
+    return LineIndex_linesAmount(&o->lineIndex, o->m->textStorageImpl);
+}
+
+static inline size_t TextStorage_lineBeginPosition(TextStorage * o, size_t lineIndex)
+{
+    return LineIndex_lineBeginPosition(&o->lineIndex, o->m->textStorageImpl, lineIndex);
+}
+
+static inline size_t TextStorage_lineIndexOf(TextStorage * o, size_t pos)
+{
+    return LineIndex_lineIndexOf(&o->lineIndex, o->m->textStorageImpl, pos);
+}
+
+// Индекс, который нужно построить заново, строится при следующем запросе
+static inline bool TextStorage_lineIndexValid(TextStorage * o)
+{
+    return LineIndex_valid(&o->lineIndex);
+}
+
+// Индекс можно строить и заранее, по blocksAmount блоков за вызов
+static inline bool TextStorage_rebuildLineIndexStep(TextStorage * o, size_t blocksAmount)
+{
+    return LineIndex_rebuildStep(&o->lineIndex, o->m->textStorageImpl, blocksAmount);
 }
+#endif
 
 #endif // TEXT_STORAGE_H
@@ -1,4 +1,8 @@
 #include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_FLAT
+
 #include <string.h>
 
 static size_t _calcEndOfTextPosition(TextStorageImpl * o);
@@ -47,6 +51,14 @@ void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_
     _markEndOfText(o);
 }
 
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    memmove( o->textBuffer.data + pos + len,
+             o->textBuffer.data + pos, (o->endOfText - pos) * sizeof(unicode_t) );
+    o->endOfText += len;
+    _markEndOfText(o);
+}
+
 void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
 {
     memcpy(o->textBuffer.data + pos, text->data, text->size * sizeof(unicode_t));
@@ -56,7 +68,7 @@ void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
 {
     memmove( o->textBuffer.data + pos,
              o->textBuffer.data + pos + len,
-             (o->endOfText - pos + len) * sizeof(unicode_t));
+             (o->endOfText - pos - len) * sizeof(unicode_t));
     o->endOfText -= len;
     _markEndOfText(o);
 }
@@ -74,6 +86,19 @@ void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf
             readTextBuffer->size * sizeof(unicode_t) );
 }
 
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    if(readSize == 0)
+        return 0;
+
+    spans[0].data = o->textBuffer.data + readPosition;
+    spans[0].size = readSize;
+    return 1;
+}
+
 void TextStorageImpl_sync(TextStorageImpl * o)
 {
     (void)o;
@@ -84,11 +109,7 @@ size_t _calcEndOfTextPosition(TextStorageImpl * o)
 {
     const unicode_t * begin = o->textBuffer.data;
     const unicode_t * end   = o->textBuffer.data + o->textBuffer.size;
-    const unicode_t * ptr;
-    for(ptr = begin; ptr != end; ptr++)
-        if(*ptr == 0x0000)
-            break;
-    return ptr - begin;
+    return TextScan_findEndOfText(begin, end) - begin;
 }
 
 void _markEndOfText(TextStorageImpl * o)
@@ -96,3 +117,5 @@ void _markEndOfText(TextStorageImpl * o)
     if(o->endOfText < o->textBuffer.size)
         o->textBuffer.data[o->endOfText] = 0x0000;
 }
+
+#endif // TEXT_STORAGE_IMPL_FLAT
@@ -3,6 +3,45 @@
 
 #include "lpm_unicode.h"
 
+/*
+ * Реализация хранилища текста выбирается при сборке:
+ *  TEXT_STORAGE_IMPL_GAP_BUFFER - буфер с разрывом (text_storage_impl_gap.c);
+ *  TEXT_STORAGE_IMPL_PIECE_TABLE - таблица кусков (text_storage_impl_piece.c);
+ *  TEXT_STORAGE_IMPL_ROPE - канат из кусков в куче (text_storage_impl_rope.c);
+ *  TEXT_STORAGE_IMPL_PAGED - текст во внешней памяти за кэшем страниц
+ *   (text_storage_impl_paged.c);
+ *  TEXT_STORAGE_IMPL_MMAP - сплошной буфер, который может лежать в
+ *   отображенном в память файле (text_storage_impl_mmap.c, только Linux);
+ *  если ни один макрос не задан - сплошной буфер (text_storage_impl.c).
+ * Все реализации работают в буфере текста из настроек редактора. После вызова
+ *  TextStorageImpl_sync текст в этом буфере лежит сплошняком и завершается
+ *  нулевым символом (если под него хватило места).
+ */
+
+#if defined(TEXT_STORAGE_IMPL_GAP_BUFFER)
+
+#include "text_storage_impl_gap.h"
+
+#elif defined(TEXT_STORAGE_IMPL_PIECE_TABLE)
+
+#include "text_storage_impl_piece.h"
+
+#elif defined(TEXT_STORAGE_IMPL_ROPE)
+
+#include "text_storage_impl_rope.h"
+
+#elif defined(TEXT_STORAGE_IMPL_PAGED)
+
+#include "text_storage_impl_paged.h"
+
+#elif defined(TEXT_STORAGE_IMPL_MMAP)
+
+#include "text_storage_impl_mmap.h"
+
+#else
+
+#define TEXT_STORAGE_IMPL_FLAT
+
 typedef struct TextStorageImpl
 {
     //Unicode_Buf * textBuffer;
@@ -10,16 +49,39 @@ typedef struct TextStorageImpl
     size_t endOfText;
 } TextStorageImpl;
 
+#endif
+
+/*
+ * Участок текста прямо в памяти хранилища. Указатель действителен до
+ *  следующего обращения к хранилищу. Текст, лежащий в хранилище не
+ *  сплошняком, отдается не более чем TEXT_STORAGE_IMPL_SPANS_AMOUNT
+ *  участками - остальное придется дочитать отдельно
+ */
+#define TEXT_STORAGE_IMPL_SPANS_AMOUNT 2
+
+typedef struct TextStorageImpl_Span
+{
+    const unicode_t * data;
+    size_t size;
+} TextStorageImpl_Span;
+
 void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer);
 void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize);
 void TextStorageImpl_recalcEndOfText(TextStorageImpl * o);
 void TextStorageImpl_clear(TextStorageImpl * o, bool deep);
 void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text );
 void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos);
+// Раздвигает текст на len символов с позиции pos. Содержимое раздвинутого
+//  участка не определено - его нужно переписать TextStorageImpl_replace
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len);
 void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos );
 void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len);
 void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos);
 void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer);
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans );
 void TextStorageImpl_sync(TextStorageImpl * o);
 
 static inline size_t TextStorageImpl_endOfText(const TextStorageImpl * o)
@@ -0,0 +1,225 @@
+#include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_GAP_BUFFER
+
+#include <string.h>
+
+/*
+ * Разрыв переносится к месту правки, поэтому вставка и удаление символа рядом
+ *  с предыдущей правкой сдвигают только текст между этими позициями, а не
+ *  весь хвост текста.
+ * Когда разрыв стоит в конце текста, буфер имеет тот же вид, что и сплошной:
+ *  текст от начала буфера, за ним нулевой символ. К такому виду буфер
+ *  приводит TextStorageImpl_sync.
+ */
+
+static size_t _calcEndOfTextPosition(TextStorageImpl * o);
+static void _markEndOfText(TextStorageImpl * o);
+static void _resetGap(TextStorageImpl * o);
+static void _moveGap(TextStorageImpl * o, size_t pos);
+static size_t _gapSize(const TextStorageImpl * o);
+
+void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer)
+{
+    o->textBuffer.data = textBuffer->data;
+    o->textBuffer.size = textBuffer->size;
+    o->endOfText       = _calcEndOfTextPosition(o);
+    _resetGap(o);
+}
+
+void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize)
+{
+    _moveGap(o, o->endOfText);
+    o->textBuffer.size = maxSize;
+    o->gapEnd = maxSize;
+}
+
+void TextStorageImpl_recalcEndOfText(TextStorageImpl * o)
+{
+    // Вызывается, когда текст в буфере был записан снаружи, т.е. лежит
+    //  сплошняком
+    o->endOfText = _calcEndOfTextPosition(o);
+    _resetGap(o);
+}
+
+void TextStorageImpl_clear(TextStorageImpl * o, bool deep)
+{
+    o->endOfText = 0;
+    _resetGap(o);
+    if(deep)
+        memset(o->textBuffer.data, 0, o->textBuffer.size * sizeof(unicode_t));
+    else
+        _markEndOfText(o);
+}
+
+void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text)
+{
+    TextStorageImpl_insert(o, text, o->endOfText);
+}
+
+void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    _moveGap(o, pos);
+    memcpy(o->textBuffer.data + o->gapBegin, text->data, text->size * sizeof(unicode_t));
+    o->gapBegin  += text->size;
+    o->endOfText += text->size;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    _moveGap(o, pos);
+    o->gapBegin  += len;
+    o->endOfText += len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    const unicode_t * src = text->data;
+    size_t restSize = text->size;
+
+    if(pos < o->gapBegin)
+    {
+        size_t headSize = o->gapBegin - pos;
+        if(headSize > restSize)
+            headSize = restSize;
+        memcpy(o->textBuffer.data + pos, src, headSize * sizeof(unicode_t));
+        src      += headSize;
+        pos      += headSize;
+        restSize -= headSize;
+    }
+
+    memcpy( o->textBuffer.data + pos + _gapSize(o),
+            src, restSize * sizeof(unicode_t) );
+}
+
+void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
+{
+    _moveGap(o, pos);
+    o->gapEnd    += len;
+    o->endOfText -= len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos)
+{
+    // Хвост за позицией pos отбрасывается, переносить его незачем
+    if(pos > o->gapBegin)
+        _moveGap(o, pos);
+    else
+        o->gapBegin = pos;
+
+    o->gapEnd    = o->textBuffer.size;
+    o->endOfText = pos;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer)
+{
+    unicode_t * dst = readTextBuffer->data;
+    size_t restSize = readTextBuffer->size;
+
+    if(readPosition < o->gapBegin)
+    {
+        size_t headSize = o->gapBegin - readPosition;
+        if(headSize > restSize)
+            headSize = restSize;
+        memcpy(dst, o->textBuffer.data + readPosition, headSize * sizeof(unicode_t));
+        dst          += headSize;
+        readPosition += headSize;
+        restSize     -= headSize;
+    }
+
+    memcpy( dst, o->textBuffer.data + readPosition + _gapSize(o),
+            restSize * sizeof(unicode_t) );
+}
+
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    // Не больше двух участков: до разрыва и после него
+    size_t spansAmount = 0;
+
+    if(readSize > 0 && readPosition < o->gapBegin)
+    {
+        size_t headSize = o->gapBegin - readPosition;
+        if(headSize > readSize)
+            headSize = readSize;
+        spans[spansAmount].data = o->textBuffer.data + readPosition;
+        spans[spansAmount].size = headSize;
+        spansAmount++;
+        readPosition += headSize;
+        readSize     -= headSize;
+    }
+
+    if(readSize > 0)
+    {
+        spans[spansAmount].data = o->textBuffer.data + readPosition + _gapSize(o);
+        spans[spansAmount].size = readSize;
+        spansAmount++;
+    }
+
+    return spansAmount;
+}
+
+void TextStorageImpl_sync(TextStorageImpl * o)
+{
+    _moveGap(o, o->endOfText);
+    _markEndOfText(o);
+}
+
+
+size_t _calcEndOfTextPosition(TextStorageImpl * o)
+{
+    const unicode_t * begin = o->textBuffer.data;
+    const unicode_t * end   = o->textBuffer.data + o->textBuffer.size;
+    return TextScan_findEndOfText(begin, end) - begin;
+}
+
+void _markEndOfText(TextStorageImpl * o)
+{
+    // Нулевой символ имеет смысл только когда хвоста нет и текст лежит
+    //  сплошняком
+    if(o->gapEnd == o->textBuffer.size)
+        if(o->endOfText < o->textBuffer.size)
+            o->textBuffer.data[o->endOfText] = 0x0000;
+}
+
+void _resetGap(TextStorageImpl * o)
+{
+    o->gapBegin = o->endOfText;
+    o->gapEnd   = o->textBuffer.size;
+}
+
+void _moveGap(TextStorageImpl * o, size_t pos)
+{
+    if(pos < o->gapBegin)
+    {
+        size_t len = o->gapBegin - pos;
+        memmove( o->textBuffer.data + o->gapEnd - len,
+                 o->textBuffer.data + pos,
+                 len * sizeof(unicode_t) );
+        o->gapBegin -= len;
+        o->gapEnd   -= len;
+    }
+    else if(pos > o->gapBegin)
+    {
+        size_t len = pos - o->gapBegin;
+        memmove( o->textBuffer.data + o->gapBegin,
+                 o->textBuffer.data + o->gapEnd,
+                 len * sizeof(unicode_t) );
+        o->gapBegin += len;
+        o->gapEnd   += len;
+    }
+}
+
+size_t _gapSize(const TextStorageImpl * o)
+{
+    return o->gapEnd - o->gapBegin;
+}
+
+#endif // TEXT_STORAGE_IMPL_GAP_BUFFER
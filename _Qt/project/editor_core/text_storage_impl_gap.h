@@ -0,0 +1,21 @@
+#ifndef TEXT_STORAGE_IMPL_GAP_H
+#define TEXT_STORAGE_IMPL_GAP_H
+
+// Не включать напрямую - только через text_storage_impl.h
+
+#include "lpm_unicode.h"
+
+/*
+ * Буфер с разрывом. Текст хранится двумя частями: голова - [0, gapBegin) в
+ *  начале буфера, хвост - [gapEnd, textBuffer.size) в конце буфера. Между ними
+ *  лежит разрыв - все свободное место буфера.
+ */
+typedef struct TextStorageImpl
+{
+    Unicode_Buf textBuffer;
+    size_t endOfText;
+    size_t gapBegin;
+    size_t gapEnd;
+} TextStorageImpl;
+
+#endif // TEXT_STORAGE_IMPL_GAP_H
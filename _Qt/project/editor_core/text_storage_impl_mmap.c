@@ -0,0 +1,252 @@
+#include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_MMAP
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Правка работает так же, как в сплошном буфере (text_storage_impl.c), но в
+ *  отображенном файле. Для правки сначала резервируется анонимная память под
+ *  весь буфер текста, поверх ее начала отображается файл - поэтому текст может
+ *  расти за конец файла.
+ * В отображенном файле нулевой символ за концом текста не ставится (иначе
+ *  каждая правка трогала бы страницу в конце текста) - он ставится в буфер
+ *  текста при выгрузке.
+ */
+
+static size_t _calcEndOfTextPosition(TextStorageImpl * o);
+static void _markEndOfText(TextStorageImpl * o);
+static bool _mapForReading(TextStorageImpl * o, int fd, size_t fileSize);
+static bool _mapForWriting(TextStorageImpl * o, int fd, size_t fileSize);
+
+void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer)
+{
+    o->textBuffer.data = textBuffer->data;
+    o->textBuffer.size = textBuffer->size;
+    o->outBuffer.data  = textBuffer->data;
+    o->outBuffer.size  = textBuffer->size;
+    o->map             = NULL;
+    o->mapSize         = 0;
+    o->readOnly        = false;
+    o->endOfText       = _calcEndOfTextPosition(o);
+}
+
+bool TextStorageImpl_mapFile(TextStorageImpl * o, const char * fileName, bool writable)
+{
+    TextStorageImpl_unmapFile(o);
+
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat fileStat;
+    bool result = fstat(fd, &fileStat) == 0;
+    if(result)
+    {
+        size_t fileSize = (size_t)fileStat.st_size & ~(size_t)1;
+        result = writable ? _mapForWriting(o, fd, fileSize) :
+                            _mapForReading(o, fd, fileSize);
+    }
+
+    // Отображение остается и после закрытия файла
+    close(fd);
+    return result;
+}
+
+void TextStorageImpl_unmapFile(TextStorageImpl * o)
+{
+    if(o->map == NULL)
+        return;
+
+    munmap(o->map, o->mapSize);
+    o->map        = NULL;
+    o->mapSize    = 0;
+    o->readOnly   = false;
+    o->textBuffer = o->outBuffer;
+    o->endOfText  = _calcEndOfTextPosition(o);
+}
+
+void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize)
+{
+    o->textBuffer.size = maxSize;
+    if(o->map == NULL)
+        o->outBuffer.size = maxSize;
+}
+
+void TextStorageImpl_recalcEndOfText(TextStorageImpl * o)
+{
+    // Размер текста в файле известен при отображении, а поиск нуля прочитал
+    //  бы весь файл
+    if(o->map == NULL)
+        o->endOfText = _calcEndOfTextPosition(o);
+}
+
+void TextStorageImpl_clear(TextStorageImpl * o, bool deep)
+{
+    TextStorageImpl_unmapFile(o);
+
+    o->endOfText = 0;
+    if(deep)
+        memset(o->textBuffer.data, 0, o->textBuffer.size * sizeof(unicode_t));
+    else
+        _markEndOfText(o);
+}
+
+void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text)
+{
+    memcpy( o->textBuffer.data + o->endOfText,
+            text->data, text->size * sizeof(unicode_t) );
+    o->endOfText += text->size;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    memmove( o->textBuffer.data + pos + text->size,
+             o->textBuffer.data + pos, (o->endOfText - pos) * sizeof(unicode_t) );
+    memcpy(o->textBuffer.data + pos, text->data, text->size * sizeof(unicode_t) );
+    o->endOfText += text->size;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    memmove( o->textBuffer.data + pos + len,
+             o->textBuffer.data + pos, (o->endOfText - pos) * sizeof(unicode_t) );
+    o->endOfText += len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    memcpy(o->textBuffer.data + pos, text->data, text->size * sizeof(unicode_t));
+}
+
+void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
+{
+    memmove( o->textBuffer.data + pos,
+             o->textBuffer.data + pos + len,
+             (o->endOfText - pos - len) * sizeof(unicode_t));
+    o->endOfText -= len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos)
+{
+    o->endOfText = pos;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer)
+{
+    memcpy( readTextBuffer->data,
+            o->textBuffer.data + readPosition,
+            readTextBuffer->size * sizeof(unicode_t) );
+}
+
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    if(readSize == 0)
+        return 0;
+
+    spans[0].data = o->textBuffer.data + readPosition;
+    spans[0].size = readSize;
+    return 1;
+}
+
+void TextStorageImpl_sync(TextStorageImpl * o)
+{
+    if(o->map == NULL || o->readOnly)
+        return;
+
+    // Место под текст при отображении для правки - не больше буфера текста
+    memcpy( o->outBuffer.data, o->textBuffer.data,
+            o->endOfText * sizeof(unicode_t) );
+    if(o->endOfText < o->outBuffer.size)
+        o->outBuffer.data[o->endOfText] = 0x0000;
+}
+
+
+size_t _calcEndOfTextPosition(TextStorageImpl * o)
+{
+    const unicode_t * begin = o->textBuffer.data;
+    const unicode_t * end   = o->textBuffer.data + o->textBuffer.size;
+    return TextScan_findEndOfText(begin, end) - begin;
+}
+
+void _markEndOfText(TextStorageImpl * o)
+{
+    if(o->map != NULL)
+        return;
+
+    if(o->endOfText < o->textBuffer.size)
+        o->textBuffer.data[o->endOfText] = 0x0000;
+}
+
+bool _mapForReading(TextStorageImpl * o, int fd, size_t fileSize)
+{
+    // Пустой файл отобразить нельзя - это просто пустой текст
+    if(fileSize == 0)
+    {
+        TextStorageImpl_clear(o, false);
+        return true;
+    }
+
+#ifdef TEXT_STORAGE_LINE_INDEX
+    // Индекс строк рассчитан на текст не больше буфера текста
+    if(fileSize / sizeof(unicode_t) > o->outBuffer.size)
+        return false;
+#endif
+
+    // При просмотре текст не меняется (ядро не восстанавливает текст в режиме
+    //  только для чтения), поэтому отображение - только для чтения
+    void * map = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if(map == MAP_FAILED)
+        return false;
+
+    o->map             = map;
+    o->mapSize         = fileSize;
+    o->readOnly        = true;
+    o->textBuffer.data = (unicode_t*)map;
+    o->textBuffer.size = fileSize / sizeof(unicode_t);
+    o->endOfText       = o->textBuffer.size;
+    return true;
+}
+
+bool _mapForWriting(TextStorageImpl * o, int fd, size_t fileSize)
+{
+    size_t mapSize = o->outBuffer.size * sizeof(unicode_t);
+    if(fileSize > mapSize)
+        return false;
+
+    void * map = mmap( NULL, mapSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if(map == MAP_FAILED)
+        return false;
+
+    if( fileSize > 0 &&
+        mmap( map, fileSize, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+    {
+        munmap(map, mapSize);
+        return false;
+    }
+
+    o->map             = map;
+    o->mapSize         = mapSize;
+    o->readOnly        = false;
+    o->textBuffer.data = (unicode_t*)map;
+    o->textBuffer.size = o->outBuffer.size;
+    o->endOfText       = fileSize / sizeof(unicode_t);
+    return true;
+}
+
+#endif // TEXT_STORAGE_IMPL_MMAP
@@ -0,0 +1,41 @@
+#ifndef TEXT_STORAGE_IMPL_MMAP_H
+#define TEXT_STORAGE_IMPL_MMAP_H
+
+// Не включать напрямую - только через text_storage_impl.h
+
+#include "lpm_unicode.h"
+
+/*
+ * Сплошной буфер, который может лежать в файле, отображенном в память (только
+ *  для сборки под Linux). Текст в файле - в UCS-2LE, без завершающего нуля.
+ *  Пока файл не отображен, хранилище работает в буфере текста из настроек, как
+ *  сплошной буфер.
+ * TextStorageImpl_mapFile отображает файл вместо буфера текста закрыто
+ *  (копирование при записи, файл не меняется): для просмотра - ровно файл,
+ *  без места под рост текста и только для чтения, для правки - с местом под
+ *  текст размером в буфер текста. Страницы файла читаются системой только при первом
+ *  обращении к ним, поэтому текст не копируется и не просматривается целиком
+ *  ни при загрузке, ни при выводе первой страницы.
+ * TextStorageImpl_sync выгружает правленый текст в буфер текста, текст,
+ *  отображенный для просмотра, не выгружается.
+ */
+
+typedef struct TextStorageImpl
+{
+    Unicode_Buf textBuffer;     // Отображение файла или буфер текста
+    size_t endOfText;
+    Unicode_Buf outBuffer;      // Буфер текста из настроек
+    void * map;
+    size_t mapSize;
+    bool readOnly;
+} TextStorageImpl;
+
+bool TextStorageImpl_mapFile(TextStorageImpl * o, const char * fileName, bool writable);
+void TextStorageImpl_unmapFile(TextStorageImpl * o);
+
+static inline bool TextStorageImpl_fileMapped(const TextStorageImpl * o)
+{
+    return o->map != NULL;
+}
+
+#endif // TEXT_STORAGE_IMPL_MMAP_H
@@ -0,0 +1,405 @@
+#include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_PAGED
+
+#include <string.h>
+
+/*
+ * Все правки - те же, что у сплошного буфера (сдвиг хвоста текста), но
+ *  выполняются постранично через кэш. Сдвиг идет в ту сторону, при которой
+ *  не затирается еще не сдвинутый текст; на каждом шаге копируется участок,
+ *  не пересекающий границ страниц ни источника, ни приемника. Страница
+ *  источника на этом шаге использована последней, поэтому загрузка страницы
+ *  приемника ее не вытеснит (страниц в кэше не меньше двух).
+ */
+
+#if TEXT_STORAGE_IMPL_PAGES_AMOUNT < 2
+#error "TEXT_STORAGE_IMPL_PAGES_AMOUNT must be at least 2"
+#endif
+
+#define PAGE_SIZE    TEXT_STORAGE_IMPL_PAGE_SIZE
+#define PAGES_AMOUNT TEXT_STORAGE_IMPL_PAGES_AMOUNT
+
+typedef TextStorageImpl_Page Page;
+
+static void _ramFileWrite(LPM_File * f, const LPM_Buf * buf, size_t offset);
+static void _ramFileRead(LPM_File * f, LPM_Buf * buf, size_t offset);
+static void _ramFileClear(LPM_File * f);
+static void _ramFileWaitAccess(void);
+
+static const LPM_FileFxns ramFileFxns =
+{
+    &_ramFileWrite,
+    &_ramFileRead,
+    &_ramFileClear
+};
+
+static size_t _calcEndOfTextPosition(TextStorageImpl * o);
+static void _markEndOfText(TextStorageImpl * o);
+static void _dropPages(TextStorageImpl * o);
+static void _flushPage(TextStorageImpl * o, size_t slot);
+static unicode_t * _page(TextStorageImpl * o, size_t index, bool modify);
+static void _readText(TextStorageImpl * o, size_t pos, unicode_t * dst, size_t len);
+static void _writeText(TextStorageImpl * o, size_t pos, const unicode_t * src, size_t len);
+static void _moveText(TextStorageImpl * o, size_t dstPos, size_t srcPos, size_t len);
+static size_t _restInPage(size_t pos);
+
+void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer)
+{
+    o->textBuffer.data = textBuffer->data;
+    o->textBuffer.size = textBuffer->size;
+
+    o->ramFile.base.fxns    = &ramFileFxns;
+    o->ramFile.base.maxSize = textBuffer->size * sizeof(unicode_t);
+    o->ramFile.base.error   = LPM_NO_ERROR;
+    o->ramFile.data         = (uint8_t*)textBuffer->data;
+    o->file                 = &o->ramFile.base;
+
+    o->useCounter = 0;
+    TextStorageImpl_resetCacheStats(o);
+    _dropPages(o);
+
+    o->endOfText = _calcEndOfTextPosition(o);
+}
+
+void TextStorageImpl_setFile(TextStorageImpl * o, LPM_File * file)
+{
+    // Текст берется из нового хранилища, страницы старого выбрасываются
+    o->file = file;
+    o->textBuffer.size = LPM_File_maxSize(file) / sizeof(unicode_t);
+    _dropPages(o);
+    o->endOfText = _calcEndOfTextPosition(o);
+}
+
+void TextStorageImpl_resetCacheStats(TextStorageImpl * o)
+{
+    memset(&o->stats, 0, sizeof(o->stats));
+}
+
+void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize)
+{
+    o->textBuffer.size = maxSize;
+}
+
+void TextStorageImpl_recalcEndOfText(TextStorageImpl * o)
+{
+    // Вызывается, когда текст в хранилище был записан снаружи - страницы в
+    //  кэше устарели
+    _dropPages(o);
+    o->endOfText = _calcEndOfTextPosition(o);
+}
+
+void TextStorageImpl_clear(TextStorageImpl * o, bool deep)
+{
+    o->endOfText = 0;
+    _dropPages(o);
+
+    if(deep)
+    {
+        size_t pos;
+        for(pos = 0; pos < o->textBuffer.size; pos += PAGE_SIZE)
+        {
+            size_t len = o->textBuffer.size - pos;
+            if(len > PAGE_SIZE)
+                len = PAGE_SIZE;
+            memset(_page(o, pos / PAGE_SIZE, true), 0, len * sizeof(unicode_t));
+        }
+    }
+    else
+    {
+        _markEndOfText(o);
+    }
+}
+
+void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text)
+{
+    _writeText(o, o->endOfText, text->data, text->size);
+    o->endOfText += text->size;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    _moveText(o, pos + text->size, pos, o->endOfText - pos);
+    _writeText(o, pos, text->data, text->size);
+    o->endOfText += text->size;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    _moveText(o, pos + len, pos, o->endOfText - pos);
+    o->endOfText += len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    _writeText(o, pos, text->data, text->size);
+}
+
+void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
+{
+    _moveText(o, pos, pos + len, o->endOfText - pos - len);
+    o->endOfText -= len;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos)
+{
+    o->endOfText = pos;
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer)
+{
+    _readText(o, readPosition, readTextBuffer->data, readTextBuffer->size);
+}
+
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    // Участки лежат в страницах кэша. Первая страница при загрузке второй не
+    //  вытесняется, т.к. использована последней
+    size_t spansAmount = 0;
+
+    while((readSize > 0) && (spansAmount < TEXT_STORAGE_IMPL_SPANS_AMOUNT))
+    {
+        size_t len = _restInPage(readPosition);
+        if(len > readSize)
+            len = readSize;
+
+        const unicode_t * page = _page(o, readPosition / PAGE_SIZE, false);
+        spans[spansAmount].data = page + readPosition % PAGE_SIZE;
+        spans[spansAmount].size = len;
+        spansAmount++;
+
+        readPosition += len;
+        readSize     -= len;
+    }
+
+    return spansAmount;
+}
+
+void TextStorageImpl_sync(TextStorageImpl * o)
+{
+    size_t slot;
+    for(slot = 0; slot < PAGES_AMOUNT; slot++)
+        _flushPage(o, slot);
+}
+
+
+void _ramFileWrite(LPM_File * f, const LPM_Buf * buf, size_t offset)
+{
+    _ramFileWaitAccess();
+    memcpy(((TextStorageImpl_RamFile*)f)->data + offset, buf->data, buf->size);
+}
+
+void _ramFileRead(LPM_File * f, LPM_Buf * buf, size_t offset)
+{
+    _ramFileWaitAccess();
+    memcpy(buf->data, ((TextStorageImpl_RamFile*)f)->data + offset, buf->size);
+}
+
+void _ramFileClear(LPM_File * f)
+{
+    (void)f;
+}
+
+void _ramFileWaitAccess(void)
+{
+#if TEXT_STORAGE_IMPL_RAM_FILE_ACCESS_COST > 0
+    volatile uint32_t i;
+    for(i = 0; i < TEXT_STORAGE_IMPL_RAM_FILE_ACCESS_COST; i++)
+        ;
+#endif
+}
+
+size_t _calcEndOfTextPosition(TextStorageImpl * o)
+{
+    size_t pos;
+    for(pos = 0; pos < o->textBuffer.size; pos += PAGE_SIZE)
+    {
+        const unicode_t * page = _page(o, pos / PAGE_SIZE, false);
+        size_t len = o->textBuffer.size - pos;
+        if(len > PAGE_SIZE)
+            len = PAGE_SIZE;
+        const unicode_t * pchr = TextScan_findEndOfText(page, page + len);
+        if(pchr != page + len)
+            return pos + (pchr - page);
+    }
+    return o->textBuffer.size;
+}
+
+void _markEndOfText(TextStorageImpl * o)
+{
+    unicode_t chr = 0x0000;
+    if(o->endOfText < o->textBuffer.size)
+        _writeText(o, o->endOfText, &chr, 1);
+}
+
+void _dropPages(TextStorageImpl * o)
+{
+    size_t slot;
+    for(slot = 0; slot < PAGES_AMOUNT; slot++)
+    {
+        o->pages[slot].valid = false;
+        o->pages[slot].dirty = false;
+    }
+}
+
+void _flushPage(TextStorageImpl * o, size_t slot)
+{
+    Page * page = &o->pages[slot];
+    if(!page->valid || !page->dirty)
+        return;
+
+    size_t pos = page->index * PAGE_SIZE;
+    size_t len = o->file->maxSize / sizeof(unicode_t) - pos;
+    if(len > PAGE_SIZE)
+        len = PAGE_SIZE;
+
+    LPM_Buf buf = { (uint8_t*)o->pageData[slot], len * sizeof(unicode_t) };
+    LPM_File_write(o->file, &buf, pos * sizeof(unicode_t));
+    page->dirty = false;
+    o->stats.pageWrites++;
+}
+
+unicode_t * _page(TextStorageImpl * o, size_t index, bool modify)
+{
+    size_t slot;
+    size_t victim = 0;
+
+    for(slot = 0; slot < PAGES_AMOUNT; slot++)
+    {
+        Page * page = &o->pages[slot];
+        if(page->valid && page->index == index)
+        {
+            page->lastUse = ++o->useCounter;
+            page->dirty  |= modify;
+            o->stats.hits++;
+            return o->pageData[slot];
+        }
+
+        // Свободная страница лучше любой занятой
+        if(!page->valid)
+            victim = slot;
+        else if( o->pages[victim].valid &&
+                 page->lastUse < o->pages[victim].lastUse )
+            victim = slot;
+    }
+
+    o->stats.misses++;
+    _flushPage(o, victim);
+
+    Page * page = &o->pages[victim];
+    size_t pos = index * PAGE_SIZE;
+    size_t len = o->file->maxSize / sizeof(unicode_t) - pos;
+    if(len > PAGE_SIZE)
+        len = PAGE_SIZE;
+
+    LPM_Buf buf = { (uint8_t*)o->pageData[victim], len * sizeof(unicode_t) };
+    LPM_File_read(o->file, &buf, pos * sizeof(unicode_t));
+    o->stats.pageReads++;
+
+    page->index   = index;
+    page->lastUse = ++o->useCounter;
+    page->valid   = true;
+    page->dirty   = modify;
+    return o->pageData[victim];
+}
+
+void _readText(TextStorageImpl * o, size_t pos, unicode_t * dst, size_t len)
+{
+    while(len > 0)
+    {
+        size_t partLen = _restInPage(pos);
+        if(partLen > len)
+            partLen = len;
+
+        const unicode_t * page = _page(o, pos / PAGE_SIZE, false);
+        memcpy(dst, page + pos % PAGE_SIZE, partLen * sizeof(unicode_t));
+
+        pos += partLen;
+        dst += partLen;
+        len -= partLen;
+    }
+}
+
+void _writeText(TextStorageImpl * o, size_t pos, const unicode_t * src, size_t len)
+{
+    while(len > 0)
+    {
+        size_t partLen = _restInPage(pos);
+        if(partLen > len)
+            partLen = len;
+
+        unicode_t * page = _page(o, pos / PAGE_SIZE, true);
+        memcpy(page + pos % PAGE_SIZE, src, partLen * sizeof(unicode_t));
+
+        pos += partLen;
+        src += partLen;
+        len -= partLen;
+    }
+}
+
+void _moveText(TextStorageImpl * o, size_t dstPos, size_t srcPos, size_t len)
+{
+    if(dstPos == srcPos)
+        return;
+
+    if(dstPos < srcPos)
+    {
+        while(len > 0)
+        {
+            size_t partLen = _restInPage(srcPos);
+            if(partLen > _restInPage(dstPos))
+                partLen = _restInPage(dstPos);
+            if(partLen > len)
+                partLen = len;
+
+            const unicode_t * src = _page(o, srcPos / PAGE_SIZE, false);
+            unicode_t * dst       = _page(o, dstPos / PAGE_SIZE, true);
+            memmove( dst + dstPos % PAGE_SIZE, src + srcPos % PAGE_SIZE,
+                     partLen * sizeof(unicode_t) );
+
+            srcPos += partLen;
+            dstPos += partLen;
+            len    -= partLen;
+        }
+    }
+    else
+    {
+        // Сдвиг вправо - с конца, участками до начала страниц
+        size_t srcEnd = srcPos + len;
+        size_t dstEnd = dstPos + len;
+        while(len > 0)
+        {
+            size_t partLen = (srcEnd - 1) % PAGE_SIZE + 1;
+            if(partLen > (dstEnd - 1) % PAGE_SIZE + 1)
+                partLen = (dstEnd - 1) % PAGE_SIZE + 1;
+            if(partLen > len)
+                partLen = len;
+
+            srcEnd -= partLen;
+            dstEnd -= partLen;
+
+            const unicode_t * src = _page(o, srcEnd / PAGE_SIZE, false);
+            unicode_t * dst       = _page(o, dstEnd / PAGE_SIZE, true);
+            memmove( dst + dstEnd % PAGE_SIZE, src + srcEnd % PAGE_SIZE,
+                     partLen * sizeof(unicode_t) );
+
+            len -= partLen;
+        }
+    }
+}
+
+size_t _restInPage(size_t pos)
+{
+    return PAGE_SIZE - pos % PAGE_SIZE;
+}
+
+#endif // TEXT_STORAGE_IMPL_PAGED
@@ -0,0 +1,80 @@
+#ifndef TEXT_STORAGE_IMPL_PAGED_H
+#define TEXT_STORAGE_IMPL_PAGED_H
+
+// Не включать напрямую - только через text_storage_impl.h
+
+#include "lpm_unicode.h"
+#include "lpm_file.h"
+
+/*
+ * Текст во внешней (медленной) памяти. Текст лежит в хранилище сплошняком, с
+ *  тем же размещением, что и в буфере текста, доступ к хранилищу - через
+ *  функции LPM_File (смещения в байтах). Перед хранилищем стоит кэш из
+ *  TEXT_STORAGE_IMPL_PAGES_AMOUNT страниц по TEXT_STORAGE_IMPL_PAGE_SIZE
+ *  символов: измененные страницы записываются в хранилище только при
+ *  вытеснении (вытесняется давнее всех использованная страница) и в
+ *  TextStorageImpl_sync.
+ * По умолчанию хранилище - сам буфер текста (см. TextStorageImpl_RamFile).
+ *  Задержку доступа к нему для отладки можно задать при сборке макросом
+ *  TEXT_STORAGE_IMPL_RAM_FILE_ACCESS_COST (пустых циклов на одно обращение).
+ *  Другое хранилище подключается функцией TextStorageImpl_setFile после
+ *  инициализации.
+ * Ошибки хранилища не отслеживаются - их можно проверить в самом LPM_File.
+ */
+
+#ifndef TEXT_STORAGE_IMPL_PAGE_SIZE
+#define TEXT_STORAGE_IMPL_PAGE_SIZE 128
+#endif
+
+#ifndef TEXT_STORAGE_IMPL_PAGES_AMOUNT
+#define TEXT_STORAGE_IMPL_PAGES_AMOUNT 8
+#endif
+
+#ifndef TEXT_STORAGE_IMPL_RAM_FILE_ACCESS_COST
+#define TEXT_STORAGE_IMPL_RAM_FILE_ACCESS_COST 0
+#endif
+
+typedef struct TextStorageImpl_Page
+{
+    size_t   index;
+    uint32_t lastUse;
+    bool     valid;
+    bool     dirty;
+} TextStorageImpl_Page;
+
+typedef struct TextStorageImpl_CacheStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t pageReads;
+    uint32_t pageWrites;
+} TextStorageImpl_CacheStats;
+
+typedef struct TextStorageImpl_RamFile
+{
+    LPM_File base;
+    uint8_t * data;
+} TextStorageImpl_RamFile;
+
+typedef struct TextStorageImpl
+{
+    Unicode_Buf textBuffer;
+    size_t endOfText;
+    LPM_File * file;
+    TextStorageImpl_RamFile ramFile;
+    uint32_t useCounter;
+    TextStorageImpl_CacheStats stats;
+    TextStorageImpl_Page pages[TEXT_STORAGE_IMPL_PAGES_AMOUNT];
+    unicode_t pageData[TEXT_STORAGE_IMPL_PAGES_AMOUNT][TEXT_STORAGE_IMPL_PAGE_SIZE];
+} TextStorageImpl;
+
+void TextStorageImpl_setFile(TextStorageImpl * o, LPM_File * file);
+void TextStorageImpl_resetCacheStats(TextStorageImpl * o);
+
+static inline const TextStorageImpl_CacheStats *
+    TextStorageImpl_cacheStats(const TextStorageImpl * o)
+{
+    return &o->stats;
+}
+
+#endif // TEXT_STORAGE_IMPL_PAGED_H
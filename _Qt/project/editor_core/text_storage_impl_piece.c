@@ -0,0 +1,704 @@
+#include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_PIECE_TABLE
+
+#include <string.h>
+
+/*
+ * Вставка дописывает текст в буфер добавлений и добавляет не более двух
+ *  кусков, удаление только вырезает куски из списка, поэтому ни то, ни другое
+ *  не сдвигает текст в буфере. Время правки зависит от количества кусков, а не
+ *  от размера текста.
+ * Ввод символов подряд продлевает последний кусок из буфера добавлений, а не
+ *  порождает новый.
+ * Исходный текст в буфере до сборки не меняется, даже нулевой символ в конце
+ *  текста ставится только при сборке.
+ * Текст снимка (TEXT_STORAGE_IMPL_SOURCE_KEPT) лежит в последних keptSize
+ *  символах буфера текста, на него ссылаются только куски снимка.
+ */
+
+#define SOURCE_TEXT  TEXT_STORAGE_IMPL_SOURCE_TEXT
+#define SOURCE_ADDED TEXT_STORAGE_IMPL_SOURCE_ADDED
+#define SOURCE_KEPT  TEXT_STORAGE_IMPL_SOURCE_KEPT
+
+static size_t _calcEndOfTextPosition(TextStorageImpl * o);
+static void _markEndOfText(TextStorageImpl * o);
+static const unicode_t * _sourceData( const TextStorageImpl * o,
+                                      TextStorageImpl_Source source );
+static void _setTextPiece(TextStorageImpl * o);
+static void _resetPieces(TextStorageImpl * o);
+static void _collectPieces(TextStorageImpl * o);
+static void _collectText( TextStorageImpl * o,
+                          const TextStorageImpl_Piece * pieces,
+                          size_t piecesAmount,
+                          size_t endOfText );
+static void _reservePieces(TextStorageImpl * o, size_t amount);
+static bool _reserveAddBuffer(TextStorageImpl * o, size_t size);
+static void _reserveTextBuffer(TextStorageImpl * o, size_t pos, size_t size);
+static size_t _splitPieces(TextStorageImpl * o, size_t pos);
+static void _insertPiece( TextStorageImpl * o,
+                          size_t index,
+                          const TextStorageImpl_Piece * piece );
+static void _insertToTextBuffer( TextStorageImpl * o,
+                                 const Unicode_Buf * text,
+                                 size_t pos );
+static void _readPieces( const TextStorageImpl * o,
+                         const TextStorageImpl_Piece * pieces,
+                         size_t piecesAmount,
+                         size_t readPosition,
+                         Unicode_Buf * readTextBuffer );
+static void _dropSnapshot(TextStorageImpl * o);
+static bool _rebaseSnapshot(TextStorageImpl * o, size_t * keptSize);
+static bool _findSnapshotRun( const TextStorageImpl * o,
+                              TextStorageImpl_Source source,
+                              size_t begin,
+                              size_t end,
+                              TextStorageImpl_Piece * run );
+static void _mergeSnapshotPieces(TextStorageImpl_Snapshot * snapshot);
+static bool _snapshotCanShift(const TextStorageImpl * o, size_t pos);
+static void _shiftSnapshot(TextStorageImpl * o, size_t pos, size_t len);
+
+void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer)
+{
+    o->textBuffer.data = textBuffer->data;
+    o->textBuffer.size = textBuffer->size;
+    o->endOfText       = _calcEndOfTextPosition(o);
+    o->generation      = 0;
+    o->keptSize        = 0;
+    o->snapshot        = NULL;
+    _resetPieces(o);
+}
+
+void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize)
+{
+    // Текст снимка лежит в конце буфера, который сейчас изменится
+    _dropSnapshot(o);
+    _collectPieces(o);
+    o->textBuffer.size = maxSize;
+}
+
+void TextStorageImpl_recalcEndOfText(TextStorageImpl * o)
+{
+    // Вызывается, когда текст в буфере был записан снаружи, т.е. лежит
+    //  сплошняком
+    o->endOfText = _calcEndOfTextPosition(o);
+    if(o->snapshot != NULL)
+        o->snapshot->page.size = 0;
+    _dropSnapshot(o);
+    _resetPieces(o);
+}
+
+void TextStorageImpl_clear(TextStorageImpl * o, bool deep)
+{
+    o->endOfText = 0;
+    _dropSnapshot(o);
+    _resetPieces(o);
+    if(deep)
+        memset(o->textBuffer.data, 0, o->textBuffer.size * sizeof(unicode_t));
+    else
+        _markEndOfText(o);
+}
+
+void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text)
+{
+    TextStorageImpl_insert(o, text, o->endOfText);
+}
+
+void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    if(text->size == 0)
+        return;
+
+    if(!_reserveAddBuffer(o, text->size))
+    {
+        // Текст больше всего буфера добавлений - вставляем его прямо в
+        //  собранный буфер текста
+        _insertToTextBuffer(o, text, pos);
+        return;
+    }
+    _reservePieces(o, 2);
+
+    size_t index = _splitPieces(o, pos);
+    TextStorageImpl_Piece * prev = index > 0 ? &o->pieces[index-1] : NULL;
+
+    memcpy( o->addBuffer + o->addBufferUsedSize,
+            text->data, text->size * sizeof(unicode_t) );
+
+    if( prev != NULL && prev->source == SOURCE_ADDED &&
+        prev->begin + prev->size == o->addBufferUsedSize )
+    {
+        prev->size += text->size;
+    }
+    else
+    {
+        TextStorageImpl_Piece piece = { o->addBufferUsedSize, text->size, SOURCE_ADDED };
+        _insertPiece(o, index, &piece);
+    }
+
+    o->addBufferUsedSize += text->size;
+    o->endOfText         += text->size;
+}
+
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    // Кусок с неопределенным содержимым не на что ссылать - раздвигаем
+    //  собранный буфер текста
+    _collectPieces(o);
+    _reserveTextBuffer(o, pos, len);
+    memmove( o->textBuffer.data + pos + len,
+             o->textBuffer.data + pos, (o->endOfText - pos) * sizeof(unicode_t) );
+    o->endOfText += len;
+    _setTextPiece(o);
+    _shiftSnapshot(o, pos, len);
+    _markEndOfText(o);
+}
+
+void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    TextStorageImpl_remove(o, pos, text->size);
+    TextStorageImpl_insert(o, text, pos);
+}
+
+void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
+{
+    if(len == 0)
+        return;
+
+    _reservePieces(o, 2);
+
+    size_t first = _splitPieces(o, pos);
+    size_t last  = _splitPieces(o, pos + len);
+
+    memmove( o->pieces + first, o->pieces + last,
+             (o->piecesAmount - last) * sizeof(TextStorageImpl_Piece) );
+    o->piecesAmount -= last - first;
+    o->endOfText    -= len;
+}
+
+void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos)
+{
+    _reservePieces(o, 1);
+    o->piecesAmount = _splitPieces(o, pos);
+    o->endOfText    = pos;
+}
+
+void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer)
+{
+    _readPieces(o, o->pieces, o->piecesAmount, readPosition, readTextBuffer);
+}
+
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    size_t spansAmount = 0;
+    size_t pieceBegin = 0;
+    size_t i;
+
+    for( i = 0;
+         (i < o->piecesAmount) && (readSize > 0) &&
+         (spansAmount < TEXT_STORAGE_IMPL_SPANS_AMOUNT);
+         i++ )
+    {
+        const TextStorageImpl_Piece * piece = &o->pieces[i];
+        if(readPosition < pieceBegin + piece->size)
+        {
+            size_t offset = readPosition - pieceBegin;
+            size_t len    = piece->size - offset;
+            if(len > readSize)
+                len = readSize;
+
+            spans[spansAmount].data = _sourceData(o, piece->source) + piece->begin + offset;
+            spans[spansAmount].size = len;
+            spansAmount++;
+
+            readPosition += len;
+            readSize     -= len;
+        }
+        pieceBegin += piece->size;
+    }
+
+    return spansAmount;
+}
+
+void TextStorageImpl_sync(TextStorageImpl * o)
+{
+    _collectPieces(o);
+}
+
+void TextStorageImpl_saveSnapshot( TextStorageImpl * o,
+                                   TextStorageImpl_Snapshot * snapshot )
+{
+    // Прежний снимок хранилище больше не ведет - он становится
+    //  недействительным, а его текст больше не нужен
+    o->generation++;
+    o->keptSize = 0;
+    o->snapshot = snapshot;
+
+    snapshot->generation   = o->generation;
+    snapshot->pageSaved    = false;
+    snapshot->endOfText    = o->endOfText;
+    snapshot->piecesAmount = o->piecesAmount;
+    memcpy( snapshot->pieces, o->pieces,
+            o->piecesAmount * sizeof(TextStorageImpl_Piece) );
+}
+
+bool TextStorageImpl_snapshotIsValid( const TextStorageImpl * o,
+                                      const TextStorageImpl_Snapshot * snapshot )
+{
+    return snapshot->generation == o->generation;
+}
+
+void TextStorageImpl_readSnapshot( const TextStorageImpl * o,
+                                   const TextStorageImpl_Snapshot * snapshot,
+                                   size_t readPosition,
+                                   Unicode_Buf * readTextBuffer )
+{
+    _readPieces( o, snapshot->pieces, snapshot->piecesAmount,
+                 readPosition, readTextBuffer );
+}
+
+void TextStorageImpl_restoreSnapshot( TextStorageImpl * o,
+                                      TextStorageImpl_Snapshot * snapshot )
+{
+    // Текст снимка собирается в буфер текста так же, как текущий текст при
+    //  сборке: куски снимка из буфера текста идут в том же порядке, что и в
+    //  буфере, а текст снимка в конце буфера лежит дальше, чем весь текст
+    //  снимка. После этого снимок описывает собранный текст одним куском
+    _collectText(o, snapshot->pieces, snapshot->piecesAmount, snapshot->endOfText);
+    o->endOfText = snapshot->endOfText;
+    _resetPieces(o);
+    _markEndOfText(o);
+    TextStorageImpl_saveSnapshot(o, snapshot);
+}
+
+
+size_t _calcEndOfTextPosition(TextStorageImpl * o)
+{
+    const unicode_t * begin = o->textBuffer.data;
+    const unicode_t * end   = o->textBuffer.data + o->textBuffer.size;
+    return TextScan_findEndOfText(begin, end) - begin;
+}
+
+void _markEndOfText(TextStorageImpl * o)
+{
+    if(o->endOfText < o->textBuffer.size)
+        o->textBuffer.data[o->endOfText] = 0x0000;
+}
+
+const unicode_t * _sourceData( const TextStorageImpl * o,
+                               TextStorageImpl_Source source )
+{
+    if(source == SOURCE_ADDED)
+        return o->addBuffer;
+    if(source == SOURCE_KEPT)
+        return o->textBuffer.data + o->textBuffer.size - o->keptSize;
+    return o->textBuffer.data;
+}
+
+void _setTextPiece(TextStorageImpl * o)
+{
+    // Текст лежит в буфере сплошняком - он описывается одним куском
+    o->pieces[0].begin  = 0;
+    o->pieces[0].size   = o->endOfText;
+    o->pieces[0].source = SOURCE_TEXT;
+    o->piecesAmount     = o->endOfText > 0 ? 1 : 0;
+}
+
+void _resetPieces(TextStorageImpl * o)
+{
+    _setTextPiece(o);
+    o->addBufferUsedSize = 0;
+    o->generation++;
+}
+
+void _collectPieces(TextStorageImpl * o)
+{
+    size_t keptSize = 0;
+
+    if(o->snapshot != NULL && !_rebaseSnapshot(o, &keptSize))
+        _dropSnapshot(o);
+
+    _collectText(o, o->pieces, o->piecesAmount, o->endOfText);
+    _resetPieces(o);
+
+    if(o->snapshot != NULL)
+    {
+        // Новый текст снимка собран под прежним - переносим его в самый
+        //  конец буфера
+        unicode_t * end = o->textBuffer.data + o->textBuffer.size;
+        memmove( end - keptSize, end - o->keptSize - keptSize,
+                 keptSize * sizeof(unicode_t) );
+        o->keptSize = keptSize;
+        o->snapshot->generation = o->generation;
+    }
+
+    _markEndOfText(o);
+}
+
+void _collectText( TextStorageImpl * o,
+                   const TextStorageImpl_Piece * pieces,
+                   size_t piecesAmount,
+                   size_t endOfText )
+{
+    const TextStorageImpl_Piece * piece;
+    size_t pos;
+    size_t i;
+
+    // Куски исходного текста идут в списке в том же порядке, что и в буфере,
+    //  поэтому их можно собрать на месте: сначала в прямом порядке сдвигаем
+    //  влево те, что должны сдвинуться влево, затем в обратном - вправо. Ни
+    //  один сдвиг не затирает еще не сдвинутый кусок.
+    pos = 0;
+    for(i = 0; i < piecesAmount; i++)
+    {
+        piece = &pieces[i];
+        if(piece->source == SOURCE_TEXT && pos < piece->begin)
+            memmove( o->textBuffer.data + pos,
+                     o->textBuffer.data + piece->begin,
+                     piece->size * sizeof(unicode_t) );
+        pos += piece->size;
+    }
+
+    pos = endOfText;
+    for(i = piecesAmount; i > 0; i--)
+    {
+        piece = &pieces[i-1];
+        pos -= piece->size;
+        if(piece->source == SOURCE_TEXT && pos > piece->begin)
+            memmove( o->textBuffer.data + pos,
+                     o->textBuffer.data + piece->begin,
+                     piece->size * sizeof(unicode_t) );
+    }
+
+    // Остальной текст лежит отдельно - копируем в оставшиеся места
+    pos = 0;
+    for(i = 0; i < piecesAmount; i++)
+    {
+        piece = &pieces[i];
+        if(piece->source != SOURCE_TEXT)
+            memcpy( o->textBuffer.data + pos,
+                    _sourceData(o, piece->source) + piece->begin,
+                    piece->size * sizeof(unicode_t) );
+        pos += piece->size;
+    }
+}
+
+void _reservePieces(TextStorageImpl * o, size_t amount)
+{
+    if(o->piecesAmount + amount > TEXT_STORAGE_IMPL_PIECES_AMOUNT)
+        _collectPieces(o);
+}
+
+bool _reserveAddBuffer(TextStorageImpl * o, size_t size)
+{
+    if(o->addBufferUsedSize + size > TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE)
+        _collectPieces(o);
+    return size <= TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE;
+}
+
+void _reserveTextBuffer(TextStorageImpl * o, size_t pos, size_t size)
+{
+    // Собранный текст раздвинется с позиции pos на size символов - если он
+    //  дойдет до текста снимка, место отдается тексту. Снимок, который не
+    //  сможет сдвинуться вместе с текстом, бросается сейчас, пока текст цел
+    if( o->endOfText + size + o->keptSize >= o->textBuffer.size ||
+        !_snapshotCanShift(o, pos) )
+        _dropSnapshot(o);
+}
+
+size_t _splitPieces(TextStorageImpl * o, size_t pos)
+{
+    // Возвращает номер куска, который начинается с позиции pos. Если такого
+    //  нет, кусок, содержащий pos, разрезается на два
+    size_t pieceBegin = 0;
+    size_t i;
+    for(i = 0; i < o->piecesAmount; i++)
+    {
+        TextStorageImpl_Piece * piece = &o->pieces[i];
+        if(pos == pieceBegin)
+            return i;
+
+        if(pos < pieceBegin + piece->size)
+        {
+            size_t headSize = pos - pieceBegin;
+            TextStorageImpl_Piece tail =
+                { piece->begin + headSize, piece->size - headSize, piece->source };
+            piece->size = headSize;
+            _insertPiece(o, i+1, &tail);
+            return i+1;
+        }
+
+        pieceBegin += piece->size;
+    }
+    return o->piecesAmount;
+}
+
+void _insertPiece( TextStorageImpl * o,
+                   size_t index,
+                   const TextStorageImpl_Piece * piece )
+{
+    memmove( o->pieces + index + 1, o->pieces + index,
+             (o->piecesAmount - index) * sizeof(TextStorageImpl_Piece) );
+    o->pieces[index] = *piece;
+    o->piecesAmount++;
+}
+
+void _insertToTextBuffer( TextStorageImpl * o,
+                          const Unicode_Buf * text,
+                          size_t pos )
+{
+    _collectPieces(o);
+    _reserveTextBuffer(o, pos, text->size);
+    memmove( o->textBuffer.data + pos + text->size,
+             o->textBuffer.data + pos, (o->endOfText - pos) * sizeof(unicode_t) );
+    memcpy(o->textBuffer.data + pos, text->data, text->size * sizeof(unicode_t) );
+    o->endOfText += text->size;
+    _setTextPiece(o);
+    _shiftSnapshot(o, pos, text->size);
+    _markEndOfText(o);
+}
+
+void _readPieces( const TextStorageImpl * o,
+                  const TextStorageImpl_Piece * pieces,
+                  size_t piecesAmount,
+                  size_t readPosition,
+                  Unicode_Buf * readTextBuffer )
+{
+    unicode_t * dst = readTextBuffer->data;
+    size_t restSize = readTextBuffer->size;
+    size_t pieceBegin = 0;
+    size_t i;
+
+    for(i = 0; (i < piecesAmount) && (restSize > 0); i++)
+    {
+        const TextStorageImpl_Piece * piece = &pieces[i];
+        if(readPosition < pieceBegin + piece->size)
+        {
+            size_t offset = readPosition - pieceBegin;
+            size_t len    = piece->size - offset;
+            if(len > restSize)
+                len = restSize;
+
+            const unicode_t * src = _sourceData(o, piece->source);
+            memcpy(dst, src + piece->begin + offset, len * sizeof(unicode_t));
+
+            dst          += len;
+            readPosition += len;
+            restSize     -= len;
+        }
+        pieceBegin += piece->size;
+    }
+}
+
+void _dropSnapshot(TextStorageImpl * o)
+{
+    // Текущие куски на текст снимка не ссылаются, поэтому его место просто
+    //  освобождается. Текст снимка еще не тронут - до этого из него
+    //  копируется страница
+    TextStorageImpl_Snapshot * snapshot = o->snapshot;
+    if(snapshot != NULL && snapshot->page.size > 0)
+    {
+        _readPieces( o, snapshot->pieces, snapshot->piecesAmount,
+                     snapshot->pagePos, &snapshot->page );
+        snapshot->pageSaved = true;
+    }
+
+    o->snapshot = NULL;
+    o->keptSize = 0;
+    o->generation++;
+}
+
+bool _rebaseSnapshot(TextStorageImpl * o, size_t * keptSize)
+{
+    // Перед сборкой каждый кусок снимка делится на участки: те, что остаются
+    //  в тексте, после сборки окажутся в буфере текста на известном месте, а
+    //  остальные (удаленные после снимка и прежний текст снимка) копируются
+    //  под прежний текст снимка в конце буфера. Все это должно лежать за
+    //  собранным текстом и за всем, на что ссылаются куски из буфера текста
+    TextStorageImpl_Snapshot * snapshot = o->snapshot;
+    TextStorageImpl_Piece run;
+    size_t runsAmount = 0;
+    size_t textEnd = o->endOfText;
+    size_t i;
+
+    *keptSize = 0;
+    for(i = 0; i < o->piecesAmount; i++)
+    {
+        const TextStorageImpl_Piece * piece = &o->pieces[i];
+        if(piece->source == SOURCE_TEXT && piece->begin + piece->size > textEnd)
+            textEnd = piece->begin + piece->size;
+    }
+
+    for(i = 0; i < snapshot->piecesAmount; i++)
+    {
+        const TextStorageImpl_Piece * piece = &snapshot->pieces[i];
+        size_t begin = piece->begin;
+        size_t end   = piece->begin + piece->size;
+        if(piece->source == SOURCE_TEXT && end > textEnd)
+            textEnd = end;
+        for( ; begin < end; begin += run.size, runsAmount++)
+            if(!_findSnapshotRun(o, piece->source, begin, end, &run))
+                *keptSize += run.size;
+    }
+
+    // Текст снимка при восстановлении тоже собирается перед своим концом
+    if( runsAmount > TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT ||
+        textEnd + o->keptSize + *keptSize >= o->textBuffer.size ||
+        snapshot->endOfText + *keptSize >= o->textBuffer.size )
+        return false;
+
+    // Участков не меньше, чем кусков, поэтому список переписывается с конца:
+    //  участки куска ложатся на места, которые уже прочитаны
+    unicode_t * kept = o->textBuffer.data + o->textBuffer.size - o->keptSize - *keptSize;
+    size_t keptPos = *keptSize;
+    size_t runIndex = runsAmount;
+    for(i = snapshot->piecesAmount; i > 0; i--)
+    {
+        TextStorageImpl_Piece piece = snapshot->pieces[i-1];
+        size_t end = piece.begin + piece.size;
+        size_t pieceRuns = 0;
+        size_t pieceKept = 0;
+        size_t begin;
+
+        for(begin = piece.begin; begin < end; begin += run.size, pieceRuns++)
+            if(!_findSnapshotRun(o, piece.source, begin, end, &run))
+                pieceKept += run.size;
+
+        runIndex -= pieceRuns;
+        keptPos  -= pieceKept;
+
+        TextStorageImpl_Piece * dst = &snapshot->pieces[runIndex];
+        const unicode_t * src = _sourceData(o, piece.source);
+        size_t runKeptPos = keptPos;
+        for(begin = piece.begin; begin < end; begin += run.size, dst++)
+        {
+            if(!_findSnapshotRun(o, piece.source, begin, end, &run))
+            {
+                memcpy(kept + runKeptPos, src + begin, run.size * sizeof(unicode_t));
+                run.begin   = runKeptPos;
+                runKeptPos += run.size;
+            }
+            *dst = run;
+        }
+    }
+
+    snapshot->piecesAmount = runsAmount;
+    _mergeSnapshotPieces(snapshot);
+    return true;
+}
+
+bool _findSnapshotRun( const TextStorageImpl * o,
+                       TextStorageImpl_Source source,
+                       size_t begin,
+                       size_t end,
+                       TextStorageImpl_Piece * run )
+{
+    // Участок с начала begin, который целиком либо лежит в одном куске
+    //  текста (тогда run - его место в собранном тексте), либо удален из
+    //  текста (тогда run->begin задает вызывающий)
+    size_t textPos = 0;
+    size_t i;
+
+    for(i = 0; i < o->piecesAmount; i++)
+    {
+        const TextStorageImpl_Piece * piece = &o->pieces[i];
+        if(piece->source == source)
+        {
+            if(piece->begin <= begin && begin < piece->begin + piece->size)
+            {
+                size_t pieceEnd = piece->begin + piece->size;
+                run->begin  = textPos + begin - piece->begin;
+                run->size   = (end < pieceEnd ? end : pieceEnd) - begin;
+                run->source = SOURCE_TEXT;
+                return true;
+            }
+            if(piece->begin > begin && piece->begin < end)
+                end = piece->begin;
+        }
+        textPos += piece->size;
+    }
+
+    run->begin  = 0;
+    run->size   = end - begin;
+    run->source = SOURCE_KEPT;
+    return false;
+}
+
+void _mergeSnapshotPieces(TextStorageImpl_Snapshot * snapshot)
+{
+    size_t amount = 0;
+    size_t i;
+
+    // Участки, которые после сборки снова лежат подряд, сливаются в один кусок
+    for(i = 0; i < snapshot->piecesAmount; i++)
+    {
+        const TextStorageImpl_Piece * piece = &snapshot->pieces[i];
+        TextStorageImpl_Piece * prev = amount > 0 ? &snapshot->pieces[amount-1] : NULL;
+        if( prev != NULL && prev->source == piece->source &&
+            prev->begin + prev->size == piece->begin )
+            prev->size += piece->size;
+        else
+            snapshot->pieces[amount++] = *piece;
+    }
+    snapshot->piecesAmount = amount;
+}
+
+bool _snapshotCanShift(const TextStorageImpl * o, size_t pos)
+{
+    // Каждый кусок снимка, внутрь которого попадает pos, при сдвиге
+    //  разрезается на два
+    const TextStorageImpl_Snapshot * snapshot = o->snapshot;
+    size_t piecesAmount;
+    size_t i;
+
+    if(snapshot == NULL)
+        return true;
+
+    piecesAmount = snapshot->piecesAmount;
+    for(i = 0; i < snapshot->piecesAmount; i++)
+    {
+        const TextStorageImpl_Piece * piece = &snapshot->pieces[i];
+        if( piece->source == SOURCE_TEXT &&
+            piece->begin < pos && pos < piece->begin + piece->size )
+            piecesAmount++;
+    }
+    return piecesAmount <= TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT;
+}
+
+void _shiftSnapshot(TextStorageImpl * o, size_t pos, size_t len)
+{
+    // Собранный текст раздвинут с позиции pos на len символов - ссылки снимка
+    //  на него сдвигаются вместе с текстом
+    TextStorageImpl_Snapshot * snapshot = o->snapshot;
+    size_t i;
+
+    if(snapshot == NULL)
+        return;
+
+    for(i = 0; i < snapshot->piecesAmount; i++)
+    {
+        TextStorageImpl_Piece * piece = &snapshot->pieces[i];
+        if(piece->source != SOURCE_TEXT || piece->begin + piece->size <= pos)
+            continue;
+
+        if(piece->begin >= pos)
+        {
+            piece->begin += len;
+            continue;
+        }
+
+        TextStorageImpl_Piece tail =
+            { pos + len, piece->begin + piece->size - pos, SOURCE_TEXT };
+        piece->size = pos - piece->begin;
+        memmove( snapshot->pieces + i + 2, snapshot->pieces + i + 1,
+                 (snapshot->piecesAmount - i - 1) * sizeof(TextStorageImpl_Piece) );
+        snapshot->pieces[i+1] = tail;
+        snapshot->piecesAmount++;
+        i++;
+    }
+}
+
+#endif // TEXT_STORAGE_IMPL_PIECE_TABLE
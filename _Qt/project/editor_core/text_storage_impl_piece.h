@@ -0,0 +1,99 @@
+#ifndef TEXT_STORAGE_IMPL_PIECE_H
+#define TEXT_STORAGE_IMPL_PIECE_H
+
+// Не включать напрямую - только через text_storage_impl.h
+
+#include "lpm_unicode.h"
+
+/*
+ * Таблица кусков. Исходный текст лежит в буфере текста и при правке не
+ *  сдвигается. Вставляемый текст дописывается в буфер добавлений, а сам текст
+ *  описывается списком кусков - ссылок на участки одного из двух буферов.
+ * Размеры таблицы и буфера добавлений задаются при сборке. Когда место в них
+ *  заканчивается, куски собираются обратно в буфер текста, и все начинается
+ *  заново.
+ */
+
+#ifndef TEXT_STORAGE_IMPL_PIECES_AMOUNT
+#define TEXT_STORAGE_IMPL_PIECES_AMOUNT 64
+#endif
+
+#ifndef TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE
+#define TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE 1024
+#endif
+
+// Кусков в снимке: после сборок снимок ссылается на текст мельче, чем
+//  текущий список кусков
+#ifndef TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT
+#define TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT (TEXT_STORAGE_IMPL_PIECES_AMOUNT*4)
+#endif
+
+typedef enum TextStorageImpl_Source
+{
+    TEXT_STORAGE_IMPL_SOURCE_TEXT,      // буфер текста
+    TEXT_STORAGE_IMPL_SOURCE_ADDED,     // буфер добавлений
+    TEXT_STORAGE_IMPL_SOURCE_KEPT       // текст снимка в конце буфера текста
+} TextStorageImpl_Source;
+
+typedef struct TextStorageImpl_Piece
+{
+    size_t begin;
+    size_t size;
+    TextStorageImpl_Source source;
+} TextStorageImpl_Piece;
+
+typedef struct TextStorageImpl
+{
+    Unicode_Buf textBuffer;
+    size_t endOfText;
+    size_t piecesAmount;
+    size_t addBufferUsedSize;
+    uint32_t generation;
+    size_t keptSize;
+    struct TextStorageImpl_Snapshot * snapshot;
+    TextStorageImpl_Piece pieces[TEXT_STORAGE_IMPL_PIECES_AMOUNT];
+    unicode_t addBuffer[TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE];
+} TextStorageImpl;
+
+/*
+ * Снимок - копия списка кусков. Пока куски не собраны в буфер текста, оба
+ *  буфера только дописываются, поэтому снимок остается читаемым и после
+ *  правок, а текст можно вернуть к снимку целиком.
+ * Хранилище ведет один снимок - сохраненный последним - и не теряет его при
+ *  сборке: куски снимка переводятся на собранный текст, а текст, удаленный
+ *  после снимка, переносится в конец буфера текста, за свободное место.
+ *  Снимок пропадает (TextStorageImpl_snapshotIsValid возвращает false),
+ *  только если это место понадобилось самому тексту или кусков снимка
+ *  становится больше TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT. Новый текст
+ *  (TextStorageImpl_init, TextStorageImpl_clear и т.п.) тоже делает снимок
+ *  недействительным.
+ * Перед тем как бросить снимок, пока его текст еще цел, хранилище копирует
+ *  участок снимка с позиции pagePos в page (если page.size > 0) и ставит
+ *  pageSaved. После TextStorageImpl_recalcEndOfText текст снимка уже затерт,
+ *  и копия не делается.
+ */
+#define TEXT_STORAGE_IMPL_SNAPSHOTS
+
+typedef struct TextStorageImpl_Snapshot
+{
+    uint32_t generation;
+    size_t endOfText;
+    size_t piecesAmount;
+    TextStorageImpl_Piece pieces[TEXT_STORAGE_IMPL_SNAPSHOT_PIECES_AMOUNT];
+    Unicode_Buf page;
+    size_t pagePos;
+    bool pageSaved;
+} TextStorageImpl_Snapshot;
+
+void TextStorageImpl_saveSnapshot( TextStorageImpl * o,
+                                   TextStorageImpl_Snapshot * snapshot );
+bool TextStorageImpl_snapshotIsValid( const TextStorageImpl * o,
+                                      const TextStorageImpl_Snapshot * snapshot );
+void TextStorageImpl_readSnapshot( const TextStorageImpl * o,
+                                   const TextStorageImpl_Snapshot * snapshot,
+                                   size_t readPosition,
+                                   Unicode_Buf * readTextBuffer );
+void TextStorageImpl_restoreSnapshot( TextStorageImpl * o,
+                                      TextStorageImpl_Snapshot * snapshot );
+
+#endif // TEXT_STORAGE_IMPL_PIECE_H
@@ -0,0 +1,801 @@
+#include "text_storage_impl.h"
+#include "text_scan.h"
+
+#ifdef TEXT_STORAGE_IMPL_ROPE
+
+#include <string.h>
+
+/*
+ * Вставка разбивается на части не больше куска. Часть, которая помещается в
+ *  кусок, просто вставляется в него, иначе кусок делится на два. Удаление
+ *  укорачивает куски, пустые куски убираются из дерева, а соседние куски, уже
+ *  помещающиеся в один, сливаются.
+ * Когда свободные куски кончаются (куски заполнены не полностью),
+ *  текст выгружается в буфер текста и разбивается на полные куски заново.
+ *  Кусков в куче на один больше, чем нужно под весь буфер текста, поэтому
+ *  после этого места всегда хватает.
+ * Количество концов строк куска зависит от первого символа следующего куска
+ *  (CR в конце куска), поэтому после правки пересчитываются и кусок перед
+ *  местом правки.
+ */
+
+#define CHUNK_SIZE TEXT_STORAGE_IMPL_CHUNK_SIZE
+#define NO_CHUNK   0xFFFF
+
+typedef TextStorageImpl_Chunk Chunk;
+
+static const unicode_t chrCr = 0x000D;
+static const unicode_t chrLf = 0x000A;
+
+static size_t _calcEndOfTextPosition(TextStorageImpl * o);
+static void _markEndOfText(TextStorageImpl * o);
+static void _loadText(TextStorageImpl * o);
+static void _unloadText(TextStorageImpl * o);
+static uint16_t _buildTree(TextStorageImpl * o, size_t first, size_t last);
+static void _unloadTree(TextStorageImpl * o, uint16_t t, size_t * pos);
+
+static unicode_t * _data(const TextStorageImpl * o, uint16_t id);
+static uint16_t _allocChunk(TextStorageImpl * o);
+static void _freeChunk(TextStorageImpl * o, uint16_t id);
+
+static size_t _treeSize(const TextStorageImpl * o, uint16_t t);
+static size_t _treeLines(const TextStorageImpl * o, uint16_t t);
+static uint8_t _height(const TextStorageImpl * o, uint16_t t);
+static void _fix(TextStorageImpl * o, uint16_t t);
+static uint16_t _rotateLeft(TextStorageImpl * o, uint16_t t);
+static uint16_t _rotateRight(TextStorageImpl * o, uint16_t t);
+static uint16_t _balance(TextStorageImpl * o, uint16_t t);
+static uint16_t _insertChunk(TextStorageImpl * o, uint16_t t, size_t begin, uint16_t id);
+static uint16_t _removeChunk(TextStorageImpl * o, uint16_t t, size_t begin);
+static uint16_t _removeFirstChunk(TextStorageImpl * o, uint16_t t, uint16_t * first);
+static void _updatePath(TextStorageImpl * o, uint16_t t, size_t begin);
+static uint16_t _findChunk(const TextStorageImpl * o, size_t pos, size_t * begin);
+
+static unicode_t _symbolAt(const TextStorageImpl * o, size_t pos);
+static bool _isEndOfLine(const unicode_t * data, size_t i, size_t size, unicode_t nextChr);
+static void _recountLines(TextStorageImpl * o, size_t begin);
+static void _recountLinesAround(TextStorageImpl * o, size_t pos);
+
+static void _insertPart( TextStorageImpl * o,
+                         const unicode_t * text,
+                         size_t len,
+                         size_t pos );
+static void _copyJoined( unicode_t * dst,
+                         const unicode_t * chunk, size_t chunkSize, size_t off,
+                         const unicode_t * text, size_t len,
+                         size_t from, size_t count );
+static void _mergeChunksAt(TextStorageImpl * o, size_t pos);
+
+size_t TextStorageImpl_calcHeapSize(size_t textBufferSize)
+{
+    size_t chunksAmount = (textBufferSize + CHUNK_SIZE - 1) / CHUNK_SIZE + 1;
+    return chunksAmount * (sizeof(Chunk) + CHUNK_SIZE * sizeof(unicode_t));
+}
+
+void TextStorageImpl_setHeap(TextStorageImpl * o, void * heap, size_t textBufferSize)
+{
+    o->chunksAmount = (textBufferSize + CHUNK_SIZE - 1) / CHUNK_SIZE + 1;
+    o->chunks       = (Chunk*)heap;
+    o->chunkData    = (unicode_t*)(o->chunks + o->chunksAmount);
+}
+
+void TextStorageImpl_init(TextStorageImpl * o, const Unicode_Buf * textBuffer)
+{
+    o->textBuffer.data = textBuffer->data;
+    o->textBuffer.size = textBuffer->size;
+    o->endOfText       = _calcEndOfTextPosition(o);
+    _loadText(o);
+}
+
+void TextStorageImpl_setMaxSize(TextStorageImpl * o, size_t maxSize)
+{
+    // Кусков в куче хватает на весь буфер текста, а размер шаблона меньше
+    o->textBuffer.size = maxSize;
+}
+
+void TextStorageImpl_recalcEndOfText(TextStorageImpl * o)
+{
+    // Вызывается, когда текст в буфере был записан снаружи
+    o->endOfText = _calcEndOfTextPosition(o);
+    _loadText(o);
+}
+
+void TextStorageImpl_clear(TextStorageImpl * o, bool deep)
+{
+    o->endOfText = 0;
+    _loadText(o);
+    if(deep)
+        memset(o->textBuffer.data, 0, o->textBuffer.size * sizeof(unicode_t));
+    else
+        _markEndOfText(o);
+}
+
+void TextStorageImpl_append(TextStorageImpl * o, const Unicode_Buf * text)
+{
+    TextStorageImpl_insert(o, text, o->endOfText);
+}
+
+void TextStorageImpl_insert(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    const unicode_t * src = text->data;
+    size_t restSize = text->size;
+
+    while(restSize > 0)
+    {
+        size_t len = restSize < CHUNK_SIZE ? restSize : CHUNK_SIZE;
+        _insertPart(o, src, len, pos);
+        src      += len;
+        pos      += len;
+        restSize -= len;
+    }
+}
+
+void TextStorageImpl_expand(TextStorageImpl * o, size_t pos, size_t len)
+{
+    // Раздвинутый участок заполняется нулями - в них нет концов строк
+    static const unicode_t blank[CHUNK_SIZE] = { 0 };
+
+    while(len > 0)
+    {
+        size_t partLen = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+        _insertPart(o, blank, partLen, pos);
+        pos += partLen;
+        len -= partLen;
+    }
+}
+
+void TextStorageImpl_replace(TextStorageImpl * o, const Unicode_Buf * text, size_t pos)
+{
+    const unicode_t * src = text->data;
+    size_t restSize = text->size;
+    size_t replacePos = pos;
+
+    while(restSize > 0)
+    {
+        size_t begin;
+        uint16_t id = _findChunk(o, pos, &begin);
+        size_t off = pos - begin;
+        size_t len = o->chunks[id].size - off;
+        if(len > restSize)
+            len = restSize;
+
+        memcpy(_data(o, id) + off, src, len * sizeof(unicode_t));
+
+        src      += len;
+        pos      += len;
+        restSize -= len;
+    }
+
+    // Строки пересчитываем после замены: пересчет куска смотрит на первый
+    //  символ следующего
+    pos = replacePos > 0 ? replacePos - 1 : 0;
+    while(pos < replacePos + text->size)
+    {
+        size_t begin;
+        uint16_t id = _findChunk(o, pos, &begin);
+        _recountLines(o, begin);
+        pos = begin + o->chunks[id].size;
+    }
+}
+
+void TextStorageImpl_remove(TextStorageImpl * o, size_t pos, size_t len)
+{
+    if(len == 0)
+        return;
+
+    while(len > 0)
+    {
+        size_t begin;
+        uint16_t id = _findChunk(o, pos, &begin);
+        Chunk * chunk = &o->chunks[id];
+        size_t off = pos - begin;
+        size_t removeLen = chunk->size - off;
+        if(removeLen > len)
+            removeLen = len;
+
+        unicode_t * data = _data(o, id);
+        memmove( data + off, data + off + removeLen,
+                 (chunk->size - off - removeLen) * sizeof(unicode_t) );
+        chunk->size  -= removeLen;
+        o->endOfText -= removeLen;
+        len          -= removeLen;
+
+        if(chunk->size == 0)
+        {
+            o->root = _removeChunk(o, o->root, begin);
+            _freeChunk(o, id);
+        }
+        else
+        {
+            _updatePath(o, o->root, begin);
+        }
+    }
+
+    _mergeChunksAt(o, pos);
+    _recountLinesAround(o, pos);
+}
+
+void TextStorageImpl_truncate(TextStorageImpl * o, size_t pos)
+{
+    TextStorageImpl_remove(o, pos, o->endOfText - pos);
+}
+
+void TextStorageImpl_read(TextStorageImpl * o, size_t readPosition, Unicode_Buf * readTextBuffer)
+{
+    unicode_t * dst = readTextBuffer->data;
+    size_t restSize = readTextBuffer->size;
+
+    while(restSize > 0)
+    {
+        size_t begin;
+        uint16_t id = _findChunk(o, readPosition, &begin);
+        size_t off = readPosition - begin;
+        size_t len = o->chunks[id].size - off;
+        if(len > restSize)
+            len = restSize;
+
+        memcpy(dst, _data(o, id) + off, len * sizeof(unicode_t));
+
+        dst          += len;
+        readPosition += len;
+        restSize     -= len;
+    }
+}
+
+size_t TextStorageImpl_readSpans( TextStorageImpl * o,
+                                  size_t readPosition,
+                                  size_t readSize,
+                                  TextStorageImpl_Span * spans )
+{
+    size_t spansAmount = 0;
+
+    while((readSize > 0) && (spansAmount < TEXT_STORAGE_IMPL_SPANS_AMOUNT))
+    {
+        size_t begin;
+        uint16_t id = _findChunk(o, readPosition, &begin);
+        size_t off = readPosition - begin;
+        size_t len = o->chunks[id].size - off;
+        if(len > readSize)
+            len = readSize;
+
+        spans[spansAmount].data = _data(o, id) + off;
+        spans[spansAmount].size = len;
+        spansAmount++;
+
+        readPosition += len;
+        readSize     -= len;
+    }
+
+    return spansAmount;
+}
+
+void TextStorageImpl_sync(TextStorageImpl * o)
+{
+    _unloadText(o);
+}
+
+size_t TextStorageImpl_linesAmount(const TextStorageImpl * o)
+{
+    return _treeLines(o, o->root) + 1;
+}
+
+size_t TextStorageImpl_lineBeginPosition(const TextStorageImpl * o, size_t lineIndex)
+{
+    if(lineIndex == 0)
+        return 0;
+    if(lineIndex > _treeLines(o, o->root))
+        return o->endOfText;
+
+    // Ищем кусок с концом строки номер lineIndex (считая с единицы)
+    uint16_t t = o->root;
+    size_t begin = 0;
+    for(;;)
+    {
+        const Chunk * chunk = &o->chunks[t];
+        size_t leftLines = _treeLines(o, chunk->left);
+        if(lineIndex <= leftLines)
+        {
+            t = chunk->left;
+            continue;
+        }
+
+        lineIndex -= leftLines;
+        begin     += _treeSize(o, chunk->left);
+
+        if(lineIndex <= chunk->lines)
+            break;
+
+        lineIndex -= chunk->lines;
+        begin     += chunk->size;
+        t = chunk->right;
+    }
+
+    const unicode_t * data = _data(o, t);
+    size_t size = o->chunks[t].size;
+    unicode_t nextChr = _symbolAt(o, begin + size);
+    size_t i;
+    for(i = 0; i < size; i++)
+        if(_isEndOfLine(data, i, size, nextChr))
+            if(--lineIndex == 0)
+                break;
+    return begin + i + 1;
+}
+
+size_t TextStorageImpl_lineIndexOf(const TextStorageImpl * o, size_t pos)
+{
+    if(pos >= o->endOfText)
+        return _treeLines(o, o->root);
+
+    uint16_t t = o->root;
+    size_t lines = 0;
+    for(;;)
+    {
+        const Chunk * chunk = &o->chunks[t];
+        size_t leftSize = _treeSize(o, chunk->left);
+        if(pos < leftSize)
+        {
+            t = chunk->left;
+            continue;
+        }
+
+        pos -= leftSize;
+        lines += _treeLines(o, chunk->left);
+
+        if(pos < chunk->size)
+            break;
+
+        pos   -= chunk->size;
+        lines += chunk->lines;
+        t = chunk->right;
+    }
+
+    // Символ за pos лежит в том же куске, заглядывать в следующий не нужно
+    const unicode_t * data = _data(o, t);
+    return lines + TextScan_countEndsOfLine(data, data + pos, data[pos]);
+}
+
+
+size_t _calcEndOfTextPosition(TextStorageImpl * o)
+{
+    const unicode_t * begin = o->textBuffer.data;
+    const unicode_t * end   = o->textBuffer.data + o->textBuffer.size;
+    return TextScan_findEndOfText(begin, end) - begin;
+}
+
+void _markEndOfText(TextStorageImpl * o)
+{
+    if(o->endOfText < o->textBuffer.size)
+        o->textBuffer.data[o->endOfText] = 0x0000;
+}
+
+void _loadText(TextStorageImpl * o)
+{
+    // Разбиваем текст из буфера на полные куски, последний - неполный
+    size_t chunksUsed = (o->endOfText + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t i;
+
+    for(i = 0; i < chunksUsed; i++)
+    {
+        Chunk * chunk = &o->chunks[i];
+        size_t begin = i * CHUNK_SIZE;
+        size_t size  = o->endOfText - begin;
+        if(size > CHUNK_SIZE)
+            size = CHUNK_SIZE;
+
+        const unicode_t * src = o->textBuffer.data + begin;
+        unicode_t nextChr = begin + size < o->endOfText ? src[size] : 0x0000;
+
+        memcpy(_data(o, i), src, size * sizeof(unicode_t));
+        chunk->size  = size;
+        chunk->lines = (uint16_t)TextScan_countEndsOfLine(src, src + size, nextChr);
+    }
+
+    o->root = _buildTree(o, 0, chunksUsed);
+
+    o->freeChunk = NO_CHUNK;
+    for(i = o->chunksAmount; i > chunksUsed; i--)
+        _freeChunk(o, i-1);
+}
+
+void _unloadText(TextStorageImpl * o)
+{
+    size_t pos = 0;
+    _unloadTree(o, o->root, &pos);
+    _markEndOfText(o);
+}
+
+uint16_t _buildTree(TextStorageImpl * o, size_t first, size_t last)
+{
+    if(first == last)
+        return NO_CHUNK;
+
+    size_t middle = first + (last - first) / 2;
+    Chunk * chunk = &o->chunks[middle];
+    chunk->left  = _buildTree(o, first, middle);
+    chunk->right = _buildTree(o, middle + 1, last);
+    _fix(o, middle);
+    return middle;
+}
+
+void _unloadTree(TextStorageImpl * o, uint16_t t, size_t * pos)
+{
+    if(t == NO_CHUNK)
+        return;
+
+    const Chunk * chunk = &o->chunks[t];
+    _unloadTree(o, chunk->left, pos);
+    memcpy( o->textBuffer.data + *pos, _data(o, t),
+            chunk->size * sizeof(unicode_t) );
+    *pos += chunk->size;
+    _unloadTree(o, chunk->right, pos);
+}
+
+unicode_t * _data(const TextStorageImpl * o, uint16_t id)
+{
+    return o->chunkData + (size_t)id * CHUNK_SIZE;
+}
+
+uint16_t _allocChunk(TextStorageImpl * o)
+{
+    uint16_t id = o->freeChunk;
+    if(id != NO_CHUNK)
+        o->freeChunk = o->chunks[id].next;
+    return id;
+}
+
+void _freeChunk(TextStorageImpl * o, uint16_t id)
+{
+    o->chunks[id].next = o->freeChunk;
+    o->freeChunk = id;
+}
+
+size_t _treeSize(const TextStorageImpl * o, uint16_t t)
+{
+    return t == NO_CHUNK ? 0 : o->chunks[t].treeSize;
+}
+
+size_t _treeLines(const TextStorageImpl * o, uint16_t t)
+{
+    return t == NO_CHUNK ? 0 : o->chunks[t].treeLines;
+}
+
+uint8_t _height(const TextStorageImpl * o, uint16_t t)
+{
+    return t == NO_CHUNK ? 0 : o->chunks[t].height;
+}
+
+void _fix(TextStorageImpl * o, uint16_t t)
+{
+    Chunk * chunk = &o->chunks[t];
+    uint8_t leftHeight  = _height(o, chunk->left);
+    uint8_t rightHeight = _height(o, chunk->right);
+    chunk->height = 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+    chunk->treeSize  = _treeSize(o, chunk->left) + chunk->size +
+                       _treeSize(o, chunk->right);
+    chunk->treeLines = _treeLines(o, chunk->left) + chunk->lines +
+                       _treeLines(o, chunk->right);
+}
+
+uint16_t _rotateLeft(TextStorageImpl * o, uint16_t t)
+{
+    uint16_t r = o->chunks[t].right;
+    o->chunks[t].right = o->chunks[r].left;
+    o->chunks[r].left  = t;
+    _fix(o, t);
+    _fix(o, r);
+    return r;
+}
+
+uint16_t _rotateRight(TextStorageImpl * o, uint16_t t)
+{
+    uint16_t l = o->chunks[t].left;
+    o->chunks[t].left  = o->chunks[l].right;
+    o->chunks[l].right = t;
+    _fix(o, t);
+    _fix(o, l);
+    return l;
+}
+
+uint16_t _balance(TextStorageImpl * o, uint16_t t)
+{
+    Chunk * chunk = &o->chunks[t];
+    int diff = (int)_height(o, chunk->left) - (int)_height(o, chunk->right);
+
+    if(diff > 1)
+    {
+        const Chunk * left = &o->chunks[chunk->left];
+        if(_height(o, left->left) < _height(o, left->right))
+            chunk->left = _rotateLeft(o, chunk->left);
+        return _rotateRight(o, t);
+    }
+
+    if(diff < -1)
+    {
+        const Chunk * right = &o->chunks[chunk->right];
+        if(_height(o, right->right) < _height(o, right->left))
+            chunk->right = _rotateRight(o, chunk->right);
+        return _rotateLeft(o, t);
+    }
+
+    _fix(o, t);
+    return t;
+}
+
+uint16_t _insertChunk(TextStorageImpl * o, uint16_t t, size_t begin, uint16_t id)
+{
+    // Вставляет кусок id так, чтобы он начинался с позиции begin
+    if(t == NO_CHUNK)
+    {
+        o->chunks[id].left  = NO_CHUNK;
+        o->chunks[id].right = NO_CHUNK;
+        _fix(o, id);
+        return id;
+    }
+
+    Chunk * chunk = &o->chunks[t];
+    size_t leftSize = _treeSize(o, chunk->left);
+    if(begin <= leftSize)
+        chunk->left = _insertChunk(o, chunk->left, begin, id);
+    else
+        chunk->right = _insertChunk(o, chunk->right, begin - leftSize - chunk->size, id);
+    return _balance(o, t);
+}
+
+uint16_t _removeChunk(TextStorageImpl * o, uint16_t t, size_t begin)
+{
+    // Убирает из дерева кусок, начинающийся с позиции begin
+    Chunk * chunk = &o->chunks[t];
+    size_t leftSize = _treeSize(o, chunk->left);
+
+    if(begin < leftSize)
+    {
+        chunk->left = _removeChunk(o, chunk->left, begin);
+        return _balance(o, t);
+    }
+
+    if(begin > leftSize)
+    {
+        chunk->right = _removeChunk(o, chunk->right, begin - leftSize - chunk->size);
+        return _balance(o, t);
+    }
+
+    if(chunk->left == NO_CHUNK)
+        return chunk->right;
+    if(chunk->right == NO_CHUNK)
+        return chunk->left;
+
+    uint16_t first;
+    uint16_t right = _removeFirstChunk(o, chunk->right, &first);
+    o->chunks[first].left  = chunk->left;
+    o->chunks[first].right = right;
+    return _balance(o, first);
+}
+
+uint16_t _removeFirstChunk(TextStorageImpl * o, uint16_t t, uint16_t * first)
+{
+    Chunk * chunk = &o->chunks[t];
+    if(chunk->left == NO_CHUNK)
+    {
+        *first = t;
+        return chunk->right;
+    }
+
+    chunk->left = _removeFirstChunk(o, chunk->left, first);
+    return _balance(o, t);
+}
+
+void _updatePath(TextStorageImpl * o, uint16_t t, size_t begin)
+{
+    // Пересчитывает поддеревья на пути к куску, начинающемуся с позиции begin,
+    //  после того, как у него изменились размер или количество строк
+    Chunk * chunk = &o->chunks[t];
+    size_t leftSize = _treeSize(o, chunk->left);
+
+    if(begin < leftSize)
+        _updatePath(o, chunk->left, begin);
+    else if(begin > leftSize)
+        _updatePath(o, chunk->right, begin - leftSize - chunk->size);
+
+    _fix(o, t);
+}
+
+uint16_t _findChunk(const TextStorageImpl * o, size_t pos, size_t * begin)
+{
+    uint16_t t = o->root;
+    *begin = 0;
+    for(;;)
+    {
+        const Chunk * chunk = &o->chunks[t];
+        size_t leftSize = _treeSize(o, chunk->left);
+
+        if(pos < leftSize)
+        {
+            t = chunk->left;
+            continue;
+        }
+
+        pos    -= leftSize;
+        *begin += leftSize;
+        if(pos < chunk->size)
+            return t;
+
+        pos    -= chunk->size;
+        *begin += chunk->size;
+        t = chunk->right;
+    }
+}
+
+unicode_t _symbolAt(const TextStorageImpl * o, size_t pos)
+{
+    if(pos >= o->endOfText)
+        return 0x0000;
+
+    size_t begin;
+    uint16_t id = _findChunk(o, pos, &begin);
+    return _data(o, id)[pos - begin];
+}
+
+bool _isEndOfLine(const unicode_t * data, size_t i, size_t size, unicode_t nextChr)
+{
+    if(data[i] == chrLf)
+        return true;
+    if(data[i] != chrCr)
+        return false;
+    return (i + 1 < size ? data[i+1] : nextChr) != chrLf;
+}
+
+void _recountLines(TextStorageImpl * o, size_t begin)
+{
+    size_t chunkBegin;
+    uint16_t id = _findChunk(o, begin, &chunkBegin);
+    Chunk * chunk = &o->chunks[id];
+    const unicode_t * data = _data(o, id);
+    unicode_t nextChr = _symbolAt(o, chunkBegin + chunk->size);
+
+    chunk->lines = (uint16_t)TextScan_countEndsOfLine(data, data + chunk->size, nextChr);
+
+    _updatePath(o, o->root, chunkBegin);
+}
+
+void _recountLinesAround(TextStorageImpl * o, size_t pos)
+{
+    // Пересчитывает куски с символами pos-1 и pos
+    if(pos > 0)
+        _recountLines(o, pos-1);
+    if(pos < o->endOfText)
+        _recountLines(o, pos);
+}
+
+void _insertPart( TextStorageImpl * o,
+                  const unicode_t * text,
+                  size_t len,
+                  size_t pos )
+{
+    if(o->root == NO_CHUNK)
+    {
+        uint16_t id = _allocChunk(o);
+        memcpy(_data(o, id), text, len * sizeof(unicode_t));
+        o->chunks[id].size  = len;
+        o->chunks[id].lines = 0;
+        o->root = _insertChunk(o, o->root, 0, id);
+        o->endOfText += len;
+        _recountLines(o, 0);
+        return;
+    }
+
+    // Вставку на границе кусков дописываем в конец предыдущего куска
+    size_t begin;
+    uint16_t id = _findChunk(o, pos > 0 ? pos-1 : 0, &begin);
+    size_t off  = pos - begin;
+    size_t size = o->chunks[id].size;
+    unicode_t * data = _data(o, id);
+
+    if(size + len <= CHUNK_SIZE)
+    {
+        memmove( data + off + len, data + off, (size - off) * sizeof(unicode_t) );
+        memcpy(data + off, text, len * sizeof(unicode_t));
+        o->chunks[id].size += len;
+        o->endOfText       += len;
+        _updatePath(o, o->root, begin);
+        _recountLines(o, begin);
+        return;
+    }
+
+    uint16_t newId = _allocChunk(o);
+    if(newId == NO_CHUNK)
+    {
+        // Куски заполнены не полностью - перекладываем текст в полные куски
+        _unloadText(o);
+        _loadText(o);
+        _insertPart(o, text, len, pos);
+        return;
+    }
+
+    // Кусок делится на два: в нем остается голова объединенного текста
+    //  (кусок + вставка), в новый кусок уходит хвост. При дописывании в конец
+    //  куска кусок не трогаем
+    size_t total    = size + len;
+    size_t headSize = off == size ? size : total / 2;
+    unicode_t * newData = _data(o, newId);
+
+    _copyJoined(newData, data, size, off, text, len, headSize, total - headSize);
+    if(headSize > off)
+    {
+        if(headSize > off + len)
+            memmove( data + off + len, data + off,
+                     (headSize - off - len) * sizeof(unicode_t) );
+        size_t textLen = headSize - off < len ? headSize - off : len;
+        memcpy(data + off, text, textLen * sizeof(unicode_t));
+    }
+
+    o->chunks[id].size = headSize;
+    _updatePath(o, o->root, begin);
+
+    o->chunks[newId].size  = total - headSize;
+    o->chunks[newId].lines = 0;
+    o->root = _insertChunk(o, o->root, begin + headSize, newId);
+    o->endOfText += len;
+
+    _recountLines(o, begin);
+    _recountLines(o, begin + headSize);
+}
+
+void _copyJoined( unicode_t * dst,
+                  const unicode_t * chunk, size_t chunkSize, size_t off,
+                  const unicode_t * text, size_t len,
+                  size_t from, size_t count )
+{
+    // Копирует участок [from, from+count) последовательности
+    //  chunk[0, off) + text[0, len) + chunk[off, chunkSize)
+    size_t to = from + count;
+    size_t b, e;
+
+    b = from;
+    e = to < off ? to : off;
+    if(b < e)
+    {
+        memcpy(dst, chunk + b, (e - b) * sizeof(unicode_t));
+        dst += e - b;
+    }
+
+    b = from > off ? from : off;
+    e = to < off + len ? to : off + len;
+    if(b < e)
+    {
+        memcpy(dst, text + b - off, (e - b) * sizeof(unicode_t));
+        dst += e - b;
+    }
+
+    b = from > off + len ? from : off + len;
+    e = to < chunkSize + len ? to : chunkSize + len;
+    if(b < e)
+        memcpy(dst, chunk + b - len, (e - b) * sizeof(unicode_t));
+}
+
+void _mergeChunksAt(TextStorageImpl * o, size_t pos)
+{
+    // Сливает куски по обе стороны от места удаления, если они помещаются в
+    //  один кусок
+    if(pos == 0 || pos >= o->endOfText)
+        return;
+
+    size_t begin, nextBegin;
+    uint16_t id     = _findChunk(o, pos-1, &begin);
+    uint16_t nextId = _findChunk(o, pos, &nextBegin);
+    if(id == nextId)
+        return;
+
+    Chunk * chunk     = &o->chunks[id];
+    Chunk * nextChunk = &o->chunks[nextId];
+    if(chunk->size + nextChunk->size > CHUNK_SIZE)
+        return;
+
+    memcpy( _data(o, id) + chunk->size, _data(o, nextId),
+            nextChunk->size * sizeof(unicode_t) );
+    o->root = _removeChunk(o, o->root, nextBegin);
+    _freeChunk(o, nextId);
+    chunk->size += nextChunk->size;
+    _updatePath(o, o->root, begin);
+}
+
+#endif // TEXT_STORAGE_IMPL_ROPE
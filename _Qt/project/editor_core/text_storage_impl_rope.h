@@ -0,0 +1,62 @@
+#ifndef TEXT_STORAGE_IMPL_ROPE_H
+#define TEXT_STORAGE_IMPL_ROPE_H
+
+// Не включать напрямую - только через text_storage_impl.h
+
+#include "lpm_unicode.h"
+
+/*
+ * Канат. Текст хранится кусками фиксированного размера (не более
+ *  TEXT_STORAGE_IMPL_CHUNK_SIZE символов в каждом), куски - узлы
+ *  сбалансированного (AVL) дерева в порядке следования в тексте. Каждый узел
+ *  помнит количество символов и концов строк в своем поддереве, поэтому
+ *  вставка, удаление и чтение в любом месте текста стоят O(log n).
+ * Куски лежат в куче редактора, а не в буфере текста: буфер текста
+ *  используется только для загрузки текста при инициализации и выгрузки при
+ *  TextStorageImpl_sync. Память в куче запрашивается контроллером
+ *  (TextStorageImpl_calcHeapSize) и передается до инициализации
+ *  (TextStorageImpl_setHeap).
+ * Номер куска - 16 бит, т.е. буфер текста не больше
+ *  0xFFFE * TEXT_STORAGE_IMPL_CHUNK_SIZE символов.
+ */
+
+#ifndef TEXT_STORAGE_IMPL_CHUNK_SIZE
+#define TEXT_STORAGE_IMPL_CHUNK_SIZE 64
+#endif
+
+typedef struct TextStorageImpl_Chunk
+{
+    uint16_t left;
+    uint16_t right;
+    uint16_t size;          // Символов в куске
+    uint16_t lines;         // Концов строк в куске
+    uint16_t next;          // Следующий свободный кусок
+    uint8_t  height;
+    size_t   treeSize;      // Символов в поддереве
+    size_t   treeLines;     // Концов строк в поддереве
+} TextStorageImpl_Chunk;
+
+typedef struct TextStorageImpl
+{
+    Unicode_Buf textBuffer;
+    size_t endOfText;
+    TextStorageImpl_Chunk * chunks;
+    unicode_t * chunkData;
+    size_t chunksAmount;
+    uint16_t root;
+    uint16_t freeChunk;
+} TextStorageImpl;
+
+size_t TextStorageImpl_calcHeapSize(size_t textBufferSize);
+void TextStorageImpl_setHeap(TextStorageImpl * o, void * heap, size_t textBufferSize);
+
+/*
+ * Конец строки - символ LF или CR, за которым не следует LF. Строки
+ *  нумеруются с нуля, строка lineIndex начинается сразу за концом строки
+ *  lineIndex-1
+ */
+size_t TextStorageImpl_linesAmount(const TextStorageImpl * o);
+size_t TextStorageImpl_lineBeginPosition(const TextStorageImpl * o, size_t lineIndex);
+size_t TextStorageImpl_lineIndexOf(const TextStorageImpl * o, size_t pos);
+
+#endif // TEXT_STORAGE_IMPL_ROPE_H
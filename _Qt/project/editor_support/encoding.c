@@ -0,0 +1,1126 @@
+#include "encoding.h"
+#include "encoding_tables.h"
+
+#include <string.h>
+
+#if !defined(ENCODING_SCALAR_ONLY) && defined(__GNUC__)
+#if defined(__SSE2__)
+#define ENCODING_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define ENCODING_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+static const unicode_t chrEndOfText = 0x0000;
+static const unicode_t chrCr        = 0x000D;
+static const unicode_t chrLf        = 0x000A;
+static const unicode_t chrSpace     = 0x0020;
+static const unicode_t chrTilde     = 0x007E;
+static const unicode_t chrDel       = 0x007F;
+static const unicode_t chrQuestion  = 0x003F;
+
+// Участок, который перекодируется векторно, если весь состоит из печатных
+//  символов ASCII с тем же кодом в кодировке
+#define BLOCK_SIZE 16
+
+// Символы из трех байтов UTF-8, которые переносит упакованная запись
+#define PACKED_LONG_CHR_BEGIN 0x0800
+#define PACKED_LONG_CHR_END   0x4800
+
+typedef struct EncodingTable
+{
+    const unicode_t * decodeTable;
+    const EncodingPair * encodeTable;
+    size_t encodePairAmount;
+    unicode_t identityEnd;
+} EncodingTable;
+
+typedef struct DiacriticLetter
+{
+    unicode_t base;
+    unicode_t mark;
+    unicode_t letter;
+} DiacriticLetter;
+
+static const EncodingTable asciiTable =
+{ asciiDecodeTable, asciiEncodeTable,
+  sizeof(asciiEncodeTable)/sizeof(EncodingPair), 0x0080 };
+
+static const EncodingTable koi7h0Table =
+{ koi7h0DecodeTable, NULL, 0, 0x0080 };
+
+static const EncodingTable koi7h1Table =
+{ koi7h1DecodeTable, koi7h1EncodeTable,
+  sizeof(koi7h1EncodeTable)/sizeof(EncodingPair), 0x0040 };
+
+static const EncodingTable koi8Table =
+{ koi8DecodeTable, koi8EncodeTable,
+  sizeof(koi8EncodeTable)/sizeof(EncodingPair), 0x0080 };
+
+// Й, й, Ё, ё из букв И, и, Е, е с краткой и умлаутом
+static const DiacriticLetter diacriticLetterTable[] =
+{
+    { 0x0418, 0x0306, 0x0419 },
+    { 0x0438, 0x0306, 0x0439 },
+    { 0x0415, 0x0308, 0x0401 },
+    { 0x0435, 0x0308, 0x0451 }
+};
+
+static const EncodingTable * _encodingTable(LPM_Encoding encoding);
+static size_t _calcTextLen(const LPM_Buf * text);
+static size_t _calcUnicodeTextLen(const LPM_Buf * text);
+static size_t _calcMaxTextLen(const LPM_Buf * text, size_t maxSize);
+static size_t _findBadPos
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount );
+static bool _isPrintable(unicode_t chr);
+static bool _isText(unicode_t chr, bool ignoreSpecChars);
+static void _countEndl(LPM_EndlCount * endlCount, unicode_t chr, bool afterCr);
+static void _finishEndlCount(LPM_EndlCount * endlCount);
+static const uint8_t * _findBadChr
+        ( const EncodingTable * table,
+          const uint8_t * begin,
+          const uint8_t * end,
+          bool ignoreSpecChars );
+static const unicode_t * _findUnicodeBadChr
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount );
+static void _restoreText
+        ( const EncodingTable * table,
+          const LPM_Buf * text,
+          size_t pos,
+          size_t len );
+static size_t _expandText
+        ( const EncodingTable * table,
+          uint8_t * text,
+          size_t len,
+          bool check,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount );
+static uint8_t * _compactText
+        ( const EncodingTable * table,
+          const unicode_t * src,
+          const unicode_t * end,
+          uint8_t * dst );
+static const unicode_t * _compactChr
+        ( const EncodingTable * table,
+          const unicode_t * src,
+          const unicode_t * end,
+          uint8_t ** dst );
+static unicode_t _calcPrintableEnd(const EncodingTable * table);
+static const uint8_t * _skipPrintable(const uint8_t * begin, const uint8_t * end);
+static const unicode_t * _skipUnicodePrintable(const unicode_t * begin, const unicode_t * end);
+static bool _isPrintableBlock(const uint8_t * block, unicode_t printableEnd);
+static bool _isUnicodePrintableBlock(const unicode_t * block, unicode_t printableEnd);
+static void _expandBlock(const uint8_t * src, unicode_t * dst);
+static void _compactBlock(const unicode_t * src, uint8_t * dst);
+static unicode_t _encodeChr(const EncodingTable * table, unicode_t chr);
+static unicode_t _findDiacriticLetter(unicode_t base, unicode_t mark);
+
+static size_t _findUtf8BadPos
+        ( const LPM_Buf * text,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount,
+          size_t * chrAmount,
+          bool * packed );
+static void _utf8ToUnicode(const LPM_Buf * text);
+static void _unicodeToUtf8(const LPM_Buf * text);
+static const uint8_t * _decodeUtf8Chr
+        ( const uint8_t * src,
+          const uint8_t * end,
+          unicode_t * chr );
+static size_t _packUtf8Text
+        ( uint8_t * text,
+          size_t len,
+          size_t maxLen,
+          size_t * chrAmount );
+static void _unpackToUnicode(uint8_t * text, size_t size, size_t chrAmount);
+static size_t _packUnicodeText(uint8_t * text, size_t len, size_t * longChrAmount);
+static void _unpackToUtf8
+        ( uint8_t * text,
+          size_t size,
+          size_t longChrAmount,
+          size_t bufSize );
+static uint8_t * _packChr(unicode_t chr, uint8_t * dst);
+static const uint8_t * _unpackChr(const uint8_t * pos, unicode_t * chr);
+
+bool Encoding_checkText
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars )
+{
+    return _findBadPos(text, encoding, maxSize, ignoreSpecChars, NULL) == LPM_ENCODING_TEXT_OK;
+}
+
+size_t Encoding_checkTextAndToUnicode
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount )
+{
+    if(endlCount != NULL)
+        endlCount->cr = endlCount->lf = endlCount->crLf = 0;
+
+    if(encoding == LPM_ENCODING_UTF8)
+    {
+        // Длина текста в UCS-2 известна только после проверки
+        size_t chrAmount;
+        bool packed;
+        size_t badPos = _findUtf8BadPos( text, maxSize, ignoreSpecChars,
+                                         endlCount, &chrAmount, &packed );
+        if(badPos != LPM_ENCODING_TEXT_OK)
+            return badPos;
+
+        // Проверенный текст без символов из трех байтов уже упакован
+        if(packed)
+        {
+            _unpackToUnicode(text->data, _calcTextLen(text), chrAmount);
+            ((unicode_t*)text->data)[chrAmount] = chrEndOfText;
+        }
+        else
+        {
+            _utf8ToUnicode(text);
+        }
+        return LPM_ENCODING_TEXT_OK;
+    }
+
+    const EncodingTable * table = _encodingTable(encoding);
+    if(table == NULL)
+        return _findBadPos(text, encoding, maxSize, ignoreSpecChars, endlCount);
+
+    size_t len = _calcTextLen(text);
+    size_t maxLen = _calcMaxTextLen(text, maxSize);
+    if(len > maxLen)
+        return maxLen;
+
+    // Перекодирование с конца, как в Encoding_toUnicode, с проверкой каждого
+    //  символа. Ошибка находится последней из всех, поэтому при ней уже
+    //  перекодированный конец текста возвращается в кодировку, а первая ошибка
+    //  ищется от начала текста до найденной
+    size_t badEnd = _expandText(table, text->data, len, true, ignoreSpecChars, endlCount);
+    if(badEnd != 0)
+    {
+        _restoreText(table, text, badEnd, len);
+        const uint8_t * src = text->data;
+        return (size_t)(_findBadChr(table, src, src + badEnd, ignoreSpecChars) - src);
+    }
+
+    ((unicode_t*)text->data)[len] = chrEndOfText;
+    return LPM_ENCODING_TEXT_OK;
+}
+
+void Encoding_toUnicode(const LPM_Buf * text, LPM_Encoding encoding)
+{
+    if(encoding == LPM_ENCODING_UTF8)
+    {
+        _utf8ToUnicode(text);
+        return;
+    }
+
+    const EncodingTable * table = _encodingTable(encoding);
+    if(table == NULL)
+        return;
+
+    size_t len = _calcTextLen(text);
+    if(len >= text->size / sizeof(unicode_t))
+        len = text->size / sizeof(unicode_t) - 1;
+
+    _expandText(table, text->data, len, false, false, NULL);
+    ((unicode_t*)text->data)[len] = chrEndOfText;
+}
+
+void Encoding_fromUnicode(const LPM_Buf * text, LPM_Encoding encoding)
+{
+    if(encoding == LPM_ENCODING_UTF8)
+    {
+        _unicodeToUtf8(text);
+        return;
+    }
+
+    const EncodingTable * table = _encodingTable(encoding);
+    if(table == NULL)
+        return;
+
+    const unicode_t * src = (const unicode_t*)text->data;
+    uint8_t * dst = _compactText( table, src, src + _calcUnicodeTextLen(text),
+                                  text->data );
+    *dst = (uint8_t)chrEndOfText;
+}
+
+const EncodingTable * _encodingTable(LPM_Encoding encoding)
+{
+    switch(encoding)
+    {
+    case LPM_ENCODING_ASCII:
+        return &asciiTable;
+    case LPM_ENCODING_KOI_7H0:
+        return &koi7h0Table;
+    case LPM_ENCODING_KOI_7H1:
+        return &koi7h1Table;
+    case LPM_ENCODING_KOI_8:
+        return &koi8Table;
+    default:
+        return NULL;
+    }
+}
+
+// Длина текста до нуля или размер буфера, если нуля нет
+size_t _calcTextLen(const LPM_Buf * text)
+{
+    const uint8_t * endOfText = memchr(text->data, chrEndOfText, text->size);
+    return endOfText != NULL ? (size_t)(endOfText - text->data) : text->size;
+}
+
+size_t _calcUnicodeTextLen(const LPM_Buf * text)
+{
+    const unicode_t * begin = (const unicode_t*)text->data;
+    const unicode_t * end   = begin + text->size / sizeof(unicode_t);
+    const unicode_t * pchr;
+    for(pchr = begin; pchr != end; pchr++)
+        if(*pchr == chrEndOfText)
+            break;
+    return (size_t)(pchr - begin);
+}
+
+// Наибольшая длина текста, который поместится в UCS-2 вместе с нулем в конце
+//  и в буфер текста, и в maxSize
+size_t _calcMaxTextLen(const LPM_Buf * text, size_t maxSize)
+{
+    size_t size = maxSize < text->size ? maxSize : text->size;
+    return size >= sizeof(unicode_t) ? size / sizeof(unicode_t) - 1 : 0;
+}
+
+// Смещение в байтах первого символа, не прошедшего проверку, или
+//  LPM_ENCODING_TEXT_OK. Концы строк считаются, если endlCount не NULL (для
+//  8-битных кодировок - нет, их считает _expandText)
+size_t _findBadPos
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount )
+{
+    size_t maxLen = _calcMaxTextLen(text, maxSize);
+    if(encoding == LPM_ENCODING_UNICODE_UCS2LE)
+    {
+        size_t len = _calcUnicodeTextLen(text);
+        if(len > maxLen)
+            return maxLen * sizeof(unicode_t);
+
+        const unicode_t * begin = (const unicode_t*)text->data;
+        const unicode_t * bad = _findUnicodeBadChr(begin, begin + len, ignoreSpecChars, endlCount);
+        return bad != begin + len ? (size_t)(bad - begin) * sizeof(unicode_t) :
+                                    LPM_ENCODING_TEXT_OK;
+    }
+
+    if(encoding == LPM_ENCODING_UTF8)
+    {
+        size_t chrAmount;
+        bool packed;
+        return _findUtf8BadPos(text, maxSize, ignoreSpecChars, endlCount, &chrAmount, &packed);
+    }
+
+    const EncodingTable * table = _encodingTable(encoding);
+    if(table == NULL)
+        return 0;
+
+    // Текст в UCS-2 должен поместиться в тот же буфер (текст без нуля в конце
+    //  длиннее maxLen)
+    size_t len = _calcTextLen(text);
+    if(len > maxLen)
+        return maxLen;
+
+    const uint8_t * bad = _findBadChr(table, text->data, text->data + len, ignoreSpecChars);
+    return bad != text->data + len ? (size_t)(bad - text->data) : LPM_ENCODING_TEXT_OK;
+}
+
+bool _isPrintable(unicode_t chr)
+{
+    return chr >= chrSpace && chr <= chrTilde;
+}
+
+bool _isText(unicode_t chr, bool ignoreSpecChars)
+{
+    if(chr == chrCr || chr == chrLf || chr == UNICODE_LIGHT_SHADE)
+        return true;
+    if(chr < chrSpace || chr == chrDel)
+        return ignoreSpecChars;
+
+    Unicode_SymType type = Unicode_getSymType(chr);
+    return type != UNICODE_SYM_TYPE_UNSUPPORTED &&
+           type != UNICODE_SYM_TYPE_CONTROL;
+}
+
+// Концы строк считаются попутно с проверкой, на символах вне участков из
+//  печатных символов (CR и LF к ним не относятся). Считаются все CR и все LF,
+//  а пара - на LF сразу за CR; пары вычитаются в _finishEndlCount
+void _countEndl(LPM_EndlCount * endlCount, unicode_t chr, bool afterCr)
+{
+    if(endlCount == NULL)
+        return;
+
+    if(chr == chrCr)
+    {
+        endlCount->cr++;
+    }
+    else if(chr == chrLf)
+    {
+        endlCount->lf++;
+        if(afterCr)
+            endlCount->crLf++;
+    }
+}
+
+void _finishEndlCount(LPM_EndlCount * endlCount)
+{
+    if(endlCount == NULL)
+        return;
+
+    endlCount->cr -= endlCount->crLf;
+    endlCount->lf -= endlCount->crLf;
+}
+
+// Печатные символы ASCII - текст в любой 8-битной кодировке (в KOI-7 H1
+//  часть из них - кириллица), поэтому проверяются только остальные байты
+const uint8_t * _findBadChr
+        ( const EncodingTable * table,
+          const uint8_t * begin,
+          const uint8_t * end,
+          bool ignoreSpecChars )
+{
+    for( ; ; begin++)
+    {
+        begin = _skipPrintable(begin, end);
+        if(begin == end || !_isText(table->decodeTable[*begin], ignoreSpecChars))
+            return begin;
+    }
+}
+
+const unicode_t * _findUnicodeBadChr
+        ( const unicode_t * begin,
+          const unicode_t * end,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount )
+{
+    const unicode_t * const textBegin = begin;
+    for( ; ; begin++)
+    {
+        begin = _skipUnicodePrintable(begin, end);
+        if(begin == end)
+        {
+            _finishEndlCount(endlCount);
+            return begin;
+        }
+        if(!_isText(*begin, ignoreSpecChars))
+            return begin;
+        _countEndl(endlCount, *begin, begin != textBegin && begin[-1] == chrCr);
+    }
+}
+
+// Вернуть в кодировку перекодированные символы текста с позиции pos.
+//  Проверенные символы кодируются обратно в те же байты. Байт j пишется
+//  после чтения кодовой единицы j, как в Encoding_fromUnicode
+void _restoreText
+        ( const EncodingTable * table,
+          const LPM_Buf * text,
+          size_t pos,
+          size_t len )
+{
+    const unicode_t * src = (const unicode_t*)text->data;
+    uint8_t * dst = text->data;
+    for( ; pos < len; pos++)
+        dst[pos] = (uint8_t)_encodeChr(table, src[pos]);
+    dst[len] = (uint8_t)chrEndOfText;
+}
+
+/*
+ * Перекодирование на месте без второго буфера. Кодовая единица i занимает
+ *  байты 2i и 2i+1, поэтому при расширении с конца текста запись идет только
+ *  по уже прочитанным байтам, а при сжатии с начала байт j пишется после
+ *  чтения кодовой единицы j и всех перед ней. Каждый байт читается и каждая
+ *  кодовая единица пишется один раз, участки из печатных символов ASCII -
+ *  векторно
+ */
+
+// Расширить байты [0, len) текста в UCS-2. С check - до первого с конца
+//  байта, не прошедшего проверку: возвращает позицию за ним (0 - ошибок нет).
+//  Концы строк считаются, если endlCount не NULL. Текст идет с конца, поэтому
+//  пара CR LF считается по LF, а байт CR перед ним еще не перезаписан
+size_t _expandText
+        ( const EncodingTable * table,
+          uint8_t * text,
+          size_t len,
+          bool check,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount )
+{
+    const unicode_t printableEnd = _calcPrintableEnd(table);
+    unicode_t * dst = (unicode_t*)text;
+    size_t pos = len;
+    while(pos > 0)
+    {
+        size_t blockPos = pos > BLOCK_SIZE ? pos - BLOCK_SIZE : 0;
+        if( pos - blockPos == BLOCK_SIZE &&
+            _isPrintableBlock(text + blockPos, printableEnd) )
+        {
+            _expandBlock(text + blockPos, dst + blockPos);
+            pos = blockPos;
+            continue;
+        }
+
+        for( ; pos > blockPos; pos--)
+        {
+            uint8_t byte = text[pos-1];
+            unicode_t chr = table->decodeTable[byte];
+            if(check && !_isPrintable(byte) && !_isText(chr, ignoreSpecChars))
+                return pos;
+            _countEndl( endlCount, chr,
+                        pos > 1 && table->decodeTable[text[pos-2]] == chrCr );
+            dst[pos-1] = chr;
+        }
+    }
+    _finishEndlCount(endlCount);
+    return 0;
+}
+
+// Сжать кодовые единицы [src, end) в байты с позиции dst. Возвращает позицию
+//  за последним записанным байтом
+uint8_t * _compactText
+        ( const EncodingTable * table,
+          const unicode_t * src,
+          const unicode_t * end,
+          uint8_t * dst )
+{
+    const unicode_t printableEnd = _calcPrintableEnd(table);
+    while(src != end)
+    {
+        if( end - src >= BLOCK_SIZE &&
+            _isUnicodePrintableBlock(src, printableEnd) )
+        {
+            _compactBlock(src, dst);
+            src += BLOCK_SIZE;
+            dst += BLOCK_SIZE;
+            continue;
+        }
+
+        // Символ с диакритическим знаком может выйти за участок
+        const unicode_t * blockEnd = end - src > BLOCK_SIZE ? src + BLOCK_SIZE : end;
+        while(src < blockEnd)
+            src = _compactChr(table, src, end, &dst);
+    }
+    return dst;
+}
+
+// Закодировать символ (вместе с диакритическим знаком за ним). Возвращает
+//  позицию следующего символа
+const unicode_t * _compactChr
+        ( const EncodingTable * table,
+          const unicode_t * src,
+          const unicode_t * end,
+          uint8_t ** dst )
+{
+    unicode_t chr = *src++;
+    if(src != end && Unicode_isChrDiacritic(*src))
+    {
+        unicode_t letter = _encodeChr(table, _findDiacriticLetter(chr, *src));
+        if(letter != ENCODING_NO_CHAR)
+        {
+            chr = letter;
+            src++;
+        }
+        else
+        {
+            chr = _encodeChr(table, chr);
+        }
+    }
+    else
+    {
+        if(Unicode_isChrDiacritic(chr))
+            return src;
+        chr = _encodeChr(table, chr);
+    }
+    *(*dst)++ = chr != ENCODING_NO_CHAR ? (uint8_t)chr : (uint8_t)chrQuestion;
+    return src;
+}
+
+// Печатные символы ASCII ниже этого кода записываются в кодировке тем же
+//  кодом
+unicode_t _calcPrintableEnd(const EncodingTable * table)
+{
+    return table->identityEnd < chrDel ? table->identityEnd : chrDel;
+}
+
+/*
+ * UTF-8. Символ занимает в UCS-2 два байта, а в UTF-8 - от одного до трех,
+ *  поэтому текст при перекодировании на месте в одних участках растет, а в
+ *  других сжимается, и ни с начала, ни с конца его не перекодировать.
+ *  Перекодирование идет через упакованную запись, где символ занимает не
+ *  больше двух байтов:
+ *  - ASCII - один байт, как в UTF-8;
+ *  - U+0080-U+07FF - два байта, как в UTF-8 (второй - 0x80-0xBF);
+ *  - U+0800-U+47FF - два байта: старшие 8 бит (символ - 0x0800) и младшие
+ *    6 бит с 0xC0 (второй байт - 0xC0-0xFF);
+ *  - остальные символы (среди них нет текста) - '?'.
+ * Последний байт символа определяет его длину, поэтому упакованная запись
+ *  читается с конца. Запись короче исходной и в UTF-8, и в UCS-2: текст
+ *  упаковывается с начала и распаковывается с конца, как при расширении
+ *  8-битной кодировки
+ */
+
+// Смещение в байтах первого символа, не прошедшего проверку, или символа,
+//  который уже не помещается, или LPM_ENCODING_TEXT_OK. Для проверенного
+//  текста chrAmount - количество символов, packed - нет символов из трех
+//  байтов, endlCount (если не NULL) - концы строк. CR и LF в UTF-8 - один
+//  байт, и другие символы его не содержат
+size_t _findUtf8BadPos
+        ( const LPM_Buf * text,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount,
+          size_t * chrAmount,
+          bool * packed )
+{
+    const size_t maxLen = _calcMaxTextLen(text, maxSize);
+    const uint8_t * const begin = text->data;
+    const uint8_t * const end = begin + _calcTextLen(text);
+    const uint8_t * pchr = begin;
+    size_t len = 0;
+    *packed = true;
+    for(;;)
+    {
+        if(pchr == end)
+        {
+            *chrAmount = len;
+            _finishEndlCount(endlCount);
+            return LPM_ENCODING_TEXT_OK;
+        }
+
+        if(_isPrintable(*pchr))
+        {
+            const uint8_t * printableEnd = _skipPrintable(pchr, end);
+            if((size_t)(printableEnd - pchr) > maxLen - len)
+                return (size_t)(pchr - begin) + maxLen - len;
+            len += printableEnd - pchr;
+            pchr = printableEnd;
+            continue;
+        }
+
+        if(len == maxLen)
+            return (size_t)(pchr - begin);
+
+        unicode_t chr;
+        const uint8_t * next = _decodeUtf8Chr(pchr, end, &chr);
+        if(chr == ENCODING_NO_CHAR || !_isText(chr, ignoreSpecChars))
+            return (size_t)(pchr - begin);
+        if(chr >= PACKED_LONG_CHR_BEGIN)
+            *packed = false;
+        _countEndl(endlCount, chr, pchr != begin && pchr[-1] == chrCr);
+        pchr = next;
+        len++;
+    }
+}
+
+void _utf8ToUnicode(const LPM_Buf * text)
+{
+    if(text->size < sizeof(unicode_t))
+        return;
+
+    size_t chrAmount;
+    size_t size = _packUtf8Text( text->data, _calcTextLen(text),
+                                 text->size / sizeof(unicode_t) - 1, &chrAmount );
+    _unpackToUnicode(text->data, size, chrAmount);
+    ((unicode_t*)text->data)[chrAmount] = chrEndOfText;
+}
+
+void _unicodeToUtf8(const LPM_Buf * text)
+{
+    if(text->size == 0)
+        return;
+
+    size_t longChrAmount;
+    size_t size = _packUnicodeText(text->data, _calcUnicodeTextLen(text), &longChrAmount);
+    _unpackToUtf8(text->data, size, longChrAmount, text->size);
+}
+
+// Символ UTF-8 или ENCODING_NO_CHAR для неверной последовательности (она
+//  занимает один байт) и символа вне UCS-2. Возвращает позицию следующего
+//  символа
+const uint8_t * _decodeUtf8Chr
+        ( const uint8_t * src,
+          const uint8_t * end,
+          unicode_t * chr )
+{
+    uint8_t lead = *src;
+    if(lead < 0x80)
+    {
+        *chr = lead;
+        return src + 1;
+    }
+
+    // Два байта (кириллица, диакритические знаки) - отдельно, без цикла
+    if(lead >= 0xC2 && lead <= 0xDF)
+    {
+        if(end - src >= 2 && (src[1] & 0xC0) == 0x80)
+        {
+            *chr = (unicode_t)(((lead & 0x1F) << 6) | (src[1] & 0x3F));
+            return src + 2;
+        }
+        *chr = ENCODING_NO_CHAR;
+        return src + 1;
+    }
+
+    size_t len;
+    uint32_t code;
+    if(lead >= 0xE0 && lead <= 0xEF)
+    {
+        len  = 3;
+        code = lead & 0x0F;
+    }
+    else if(lead >= 0xF0 && lead <= 0xF4)
+    {
+        len  = 4;
+        code = lead & 0x07;
+    }
+    else
+    {
+        *chr = ENCODING_NO_CHAR;
+        return src + 1;
+    }
+
+    *chr = ENCODING_NO_CHAR;
+    if((size_t)(end - src) < len)
+        return src + 1;
+
+    size_t i;
+    for(i = 1; i < len; i++)
+    {
+        if((src[i] & 0xC0) != 0x80)
+            return src + 1;
+        code = (code << 6) | (src[i] & 0x3F);
+    }
+
+    // Лишне длинные записи и суррогаты неверны, символы вне UCS-2 пропускаются
+    //  целиком
+    if(len == 3 && (code < 0x0800 || (code >= 0xD800 && code <= 0xDFFF)))
+        return src + 1;
+    if(len == 4)
+        return code >= 0x10000 && code <= 0x10FFFF ? src + len : src + 1;
+
+    *chr = (unicode_t)code;
+    return src + len;
+}
+
+// Упаковать не больше maxLen символов UTF-8 с начала текста. Возвращает размер
+//  упакованной записи
+size_t _packUtf8Text
+        ( uint8_t * text,
+          size_t len,
+          size_t maxLen,
+          size_t * chrAmount )
+{
+    const uint8_t * src = text;
+    const uint8_t * const end = text + len;
+    uint8_t * dst = text;
+    size_t amount = 0;
+    while(src != end && amount != maxLen)
+    {
+        if( _isPrintable(*src) &&
+            end - src >= BLOCK_SIZE && maxLen - amount >= BLOCK_SIZE &&
+            _isPrintableBlock(src, chrDel) )
+        {
+            if(dst != src)
+                memmove(dst, src, BLOCK_SIZE);
+            src += BLOCK_SIZE;
+            dst += BLOCK_SIZE;
+            amount += BLOCK_SIZE;
+            continue;
+        }
+
+        unicode_t chr;
+        src = _decodeUtf8Chr(src, end, &chr);
+        dst = _packChr(chr, dst);
+        amount++;
+    }
+    *chrAmount = amount;
+    return (size_t)(dst - text);
+}
+
+// Распаковать chrAmount символов в UCS-2 с конца записи
+void _unpackToUnicode(uint8_t * text, size_t size, size_t chrAmount)
+{
+    unicode_t * dst = (unicode_t*)text;
+    const uint8_t * pos = text + size;
+    while(chrAmount > 0)
+    {
+        // Второй байт символа из двух байтов - не ASCII, поэтому участок из
+        //  ASCII - это участок из символов по одному байту
+        if( _isPrintable(pos[-1]) && pos - text >= BLOCK_SIZE &&
+            _isPrintableBlock(pos - BLOCK_SIZE, chrDel) )
+        {
+            pos -= BLOCK_SIZE;
+            chrAmount -= BLOCK_SIZE;
+            _expandBlock(pos, dst + chrAmount);
+            continue;
+        }
+
+        unicode_t chr;
+        pos = _unpackChr(pos, &chr);
+        dst[--chrAmount] = chr;
+    }
+}
+
+// Упаковать len символов UCS-2 с начала текста. Возвращает размер упакованной
+//  записи, longChrAmount - количество символов, которые займут в UTF-8 три
+//  байта
+size_t _packUnicodeText(uint8_t * text, size_t len, size_t * longChrAmount)
+{
+    const unicode_t * src = (const unicode_t*)text;
+    const unicode_t * const end = src + len;
+    uint8_t * dst = text;
+    size_t amount = 0;
+    while(src != end)
+    {
+        if( _isPrintable(*src) && end - src >= BLOCK_SIZE &&
+            _isUnicodePrintableBlock(src, chrDel) )
+        {
+            _compactBlock(src, dst);
+            src += BLOCK_SIZE;
+            dst += BLOCK_SIZE;
+            continue;
+        }
+
+        unicode_t chr = *src++;
+        if(chr >= PACKED_LONG_CHR_BEGIN && chr < PACKED_LONG_CHR_END)
+            amount++;
+        dst = _packChr(chr, dst);
+    }
+    *longChrAmount = amount;
+    return (size_t)(dst - text);
+}
+
+// Распаковать запись в UTF-8 с конца. Символы, которые с нулем в конце не
+//  помещаются в буфер, отбрасываются с конца текста
+void _unpackToUtf8
+        ( uint8_t * text,
+          size_t size,
+          size_t longChrAmount,
+          size_t bufSize )
+{
+    const uint8_t * pos = text + size;
+    size_t outSize = size + longChrAmount;
+    while(outSize + 1 > bufSize)
+    {
+        unicode_t chr;
+        const uint8_t * prev = _unpackChr(pos, &chr);
+        outSize -= (size_t)(pos - prev) + (chr >= PACKED_LONG_CHR_BEGIN ? 1 : 0);
+        pos = prev;
+    }
+
+    // Символы до первого из трех байтов уже на месте
+    uint8_t * dst = text + outSize;
+    *dst = (uint8_t)chrEndOfText;
+    while(dst != pos)
+    {
+        unicode_t chr;
+        const uint8_t * prev = _unpackChr(pos, &chr);
+        if(chr >= PACKED_LONG_CHR_BEGIN)
+        {
+            *--dst = (uint8_t)(0x80 | (chr & 0x3F));
+            *--dst = (uint8_t)(0x80 | ((chr >> 6) & 0x3F));
+            *--dst = (uint8_t)(0xE0 | (chr >> 12));
+        }
+        else
+        {
+            while(pos != prev)
+                *--dst = *--pos;
+        }
+        pos = prev;
+    }
+}
+
+// Записать символ в упакованном виде. Возвращает позицию за ним
+uint8_t * _packChr(unicode_t chr, uint8_t * dst)
+{
+    if(chr < 0x0080)
+    {
+        *dst++ = (uint8_t)chr;
+    }
+    else if(chr < PACKED_LONG_CHR_BEGIN)
+    {
+        *dst++ = (uint8_t)(0xC0 | (chr >> 6));
+        *dst++ = (uint8_t)(0x80 | (chr & 0x3F));
+    }
+    else if(chr < PACKED_LONG_CHR_END)
+    {
+        chr -= PACKED_LONG_CHR_BEGIN;
+        *dst++ = (uint8_t)(chr >> 6);
+        *dst++ = (uint8_t)(0xC0 | (chr & 0x3F));
+    }
+    else
+    {
+        *dst++ = (uint8_t)chrQuestion;
+    }
+    return dst;
+}
+
+// Прочитать символ упакованной записи, который кончается перед pos.
+//  Возвращает позицию его начала
+const uint8_t * _unpackChr(const uint8_t * pos, unicode_t * chr)
+{
+    uint8_t last = pos[-1];
+    if(last < 0x80)
+    {
+        *chr = last;
+        return pos - 1;
+    }
+
+    uint8_t first = pos[-2];
+    if(last < 0xC0)
+        *chr = (unicode_t)(((first & 0x1F) << 6) | (last & 0x3F));
+    else
+        *chr = (unicode_t)(PACKED_LONG_CHR_BEGIN + ((first << 6) | (last & 0x3F)));
+    return pos - 2;
+}
+
+#if defined(ENCODING_SSE2)
+
+/*
+ * Байты 0x20-0x7E - единственные, которые больше 0x1F и меньше 0x7F при
+ *  сравнении со знаком: байты от 0x80 отрицательны
+ */
+
+const uint8_t * _skipPrintable(const uint8_t * begin, const uint8_t * end)
+{
+    const __m128i low  = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    for( ; end - begin >= 16; begin += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)begin);
+        __m128i m = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+        int mask  = _mm_movemask_epi8(m) ^ 0xFFFF;
+        if(mask != 0)
+            return begin + __builtin_ctz(mask);
+    }
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+const unicode_t * _skipUnicodePrintable(const unicode_t * begin, const unicode_t * end)
+{
+    const __m128i low  = _mm_set1_epi16(0x1F);
+    const __m128i high = _mm_set1_epi16(0x7F);
+    for( ; end - begin >= 8; begin += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)begin);
+        __m128i m = _mm_and_si128(_mm_cmpgt_epi16(v, low), _mm_cmplt_epi16(v, high));
+        int mask  = _mm_movemask_epi8(m) ^ 0xFFFF;
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / 2;
+    }
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+bool _isPrintableBlock(const uint8_t * block, unicode_t printableEnd)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)block);
+    __m128i m = _mm_and_si128( _mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+                               _mm_cmplt_epi8(v, _mm_set1_epi8((char)printableEnd)) );
+    return _mm_movemask_epi8(m) == 0xFFFF;
+}
+
+bool _isUnicodePrintableBlock(const unicode_t * block, unicode_t printableEnd)
+{
+    const __m128i low  = _mm_set1_epi16(0x1F);
+    const __m128i high = _mm_set1_epi16((short)printableEnd);
+    __m128i v0 = _mm_loadu_si128((const __m128i*)block);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)(block + 8));
+    __m128i m  = _mm_and_si128( _mm_and_si128(_mm_cmpgt_epi16(v0, low), _mm_cmplt_epi16(v0, high)),
+                                _mm_and_si128(_mm_cmpgt_epi16(v1, low), _mm_cmplt_epi16(v1, high)) );
+    return _mm_movemask_epi8(m) == 0xFFFF;
+}
+
+void _expandBlock(const uint8_t * src, unicode_t * dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    _mm_storeu_si128((__m128i*)dst,       _mm_unpacklo_epi8(v, zero));
+    _mm_storeu_si128((__m128i*)(dst + 8), _mm_unpackhi_epi8(v, zero));
+}
+
+void _compactBlock(const unicode_t * src, uint8_t * dst)
+{
+    __m128i v0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)(src + 8));
+    _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(v0, v1));
+}
+
+#elif defined(ENCODING_NEON)
+
+/*
+ * Вектор только проверяется целиком, место первого непечатного символа
+ *  ищется скалярно
+ */
+
+const uint8_t * _skipPrintable(const uint8_t * begin, const uint8_t * end)
+{
+    const uint8x16_t low  = vdupq_n_u8(chrSpace);
+    const uint8x16_t high = vdupq_n_u8(chrTilde);
+    for( ; end - begin >= 16; begin += 16)
+    {
+        uint8x16_t v = vld1q_u8(begin);
+        if(vminvq_u8(vandq_u8(vcgeq_u8(v, low), vcleq_u8(v, high))) == 0)
+            break;
+    }
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+const unicode_t * _skipUnicodePrintable(const unicode_t * begin, const unicode_t * end)
+{
+    const uint16x8_t low  = vdupq_n_u16(chrSpace);
+    const uint16x8_t high = vdupq_n_u16(chrTilde);
+    for( ; end - begin >= 8; begin += 8)
+    {
+        uint16x8_t v = vld1q_u16(begin);
+        if(vminvq_u16(vandq_u16(vcgeq_u16(v, low), vcleq_u16(v, high))) == 0)
+            break;
+    }
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+bool _isPrintableBlock(const uint8_t * block, unicode_t printableEnd)
+{
+    uint8x16_t v = vld1q_u8(block);
+    uint8x16_t m = vandq_u8( vcgeq_u8(v, vdupq_n_u8(chrSpace)),
+                             vcltq_u8(v, vdupq_n_u8(printableEnd)) );
+    return vminvq_u8(m) != 0;
+}
+
+bool _isUnicodePrintableBlock(const unicode_t * block, unicode_t printableEnd)
+{
+    const uint16x8_t low  = vdupq_n_u16(chrSpace);
+    const uint16x8_t high = vdupq_n_u16(printableEnd);
+    uint16x8_t v0 = vld1q_u16(block);
+    uint16x8_t v1 = vld1q_u16(block + 8);
+    uint16x8_t m  = vandq_u16( vandq_u16(vcgeq_u16(v0, low), vcltq_u16(v0, high)),
+                               vandq_u16(vcgeq_u16(v1, low), vcltq_u16(v1, high)) );
+    return vminvq_u16(m) != 0;
+}
+
+void _expandBlock(const uint8_t * src, unicode_t * dst)
+{
+    uint8x16_t v = vld1q_u8(src);
+    vst1q_u16(dst,     vmovl_u8(vget_low_u8(v)));
+    vst1q_u16(dst + 8, vmovl_high_u8(v));
+}
+
+void _compactBlock(const unicode_t * src, uint8_t * dst)
+{
+    uint16x8_t v0 = vld1q_u16(src);
+    uint16x8_t v1 = vld1q_u16(src + 8);
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(v0), vmovn_u16(v1)));
+}
+
+#else
+
+const uint8_t * _skipPrintable(const uint8_t * begin, const uint8_t * end)
+{
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+const unicode_t * _skipUnicodePrintable(const unicode_t * begin, const unicode_t * end)
+{
+    for( ; begin != end; begin++)
+        if(!_isPrintable(*begin))
+            break;
+    return begin;
+}
+
+bool _isPrintableBlock(const uint8_t * block, unicode_t printableEnd)
+{
+    size_t i;
+    for(i = 0; i < BLOCK_SIZE; i++)
+        if(block[i] < chrSpace || block[i] >= printableEnd)
+            return false;
+    return true;
+}
+
+bool _isUnicodePrintableBlock(const unicode_t * block, unicode_t printableEnd)
+{
+    size_t i;
+    for(i = 0; i < BLOCK_SIZE; i++)
+        if(block[i] < chrSpace || block[i] >= printableEnd)
+            return false;
+    return true;
+}
+
+// Расширение - с конца участка, сжатие - с начала (см. _expandText)
+void _expandBlock(const uint8_t * src, unicode_t * dst)
+{
+    size_t i;
+    for(i = BLOCK_SIZE; i-- > 0; )
+        dst[i] = src[i];
+}
+
+void _compactBlock(const unicode_t * src, uint8_t * dst)
+{
+    size_t i;
+    for(i = 0; i < BLOCK_SIZE; i++)
+        dst[i] = (uint8_t)src[i];
+}
+
+#endif
+
+// Байт символа в кодировке или ENCODING_NO_CHAR
+unicode_t _encodeChr(const EncodingTable * table, unicode_t chr)
+{
+    if(chr < table->identityEnd)
+        return chr;
+
+    size_t first = 0;
+    size_t last  = table->encodePairAmount;
+    while(first < last)
+    {
+        size_t middle = first + (last - first) / 2;
+        if(table->encodeTable[middle].chr < chr)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    if(first < table->encodePairAmount && table->encodeTable[first].chr == chr)
+        return table->encodeTable[first].byte;
+    return ENCODING_NO_CHAR;
+}
+
+unicode_t _findDiacriticLetter(unicode_t base, unicode_t mark)
+{
+    size_t i;
+    for(i = 0; i < sizeof(diacriticLetterTable)/sizeof(DiacriticLetter); i++)
+        if(diacriticLetterTable[i].base == base && diacriticLetterTable[i].mark == mark)
+            return diacriticLetterTable[i].letter;
+    return ENCODING_NO_CHAR;
+}
@@ -0,0 +1,56 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include "lpm_unicode.h"
+#include "lpm_encoding_api.h"
+
+/*
+ * Перекодирование текста для LPM_EncodingFxns. 8-битные кодировки задаются
+ *  таблицами (encoding_tables.h): ASCII - кодовая страница CP866, KOI-7 H0 -
+ *  латиница ГОСТ 13052, KOI-7 H1 - кириллица вместо строчных и заглавных
+ *  латинских букв, KOI-8 - KOI8-R.
+ * Текст лежит в буфере text и заканчивается нулем (нулевым байтом или нулевой
+ *  кодовой единицей UCS-2). Перекодирование идет на месте: toUnicode
+ *  расширяет текст вдвое, поэтому буфер должен вмещать его в UCS-2 вместе с
+ *  нулем в конце - это проверяет checkText.
+ * Текстом считаются символы, которые выводит редактор (Unicode_getSymType),
+ *  символ полей вставки UNICODE_LIGHT_SHADE и концы строк CR, LF. Остальные
+ *  управляющие символы - спец. символы (например, служебные символы
+ *  метеосообщений): с ignoreSpecChars они считаются текстом, без него текст
+ *  с ними не проходит проверку.
+ * При кодировании из UCS-2 буква с диакритическим знаком, для которой в
+ *  кодировке есть готовая буква (Й, Ё), записывается ею, знак без такой
+ *  буквы отбрасывается, остальные символы вне кодировки заменяются на '?'.
+ * UTF-8 проверяется и перекодируется без таблиц, тоже на месте. Неверные и
+ *  лишне длинные последовательности и символы вне UCS-2 проверку не проходят.
+ *  toUnicode и fromUnicode заменяют на '?' их и символы от U+4800 (среди них
+ *  нет текста), диакритические знаки записываются как есть. В UTF-8 текст
+ *  бывает в полтора раза длиннее, чем в UCS-2: контроллер ограничивает
+ *  размер текста так, чтобы он поместился в буфер. Если текст все же не
+ *  помещается, fromUnicode отбрасывает символы с конца.
+ * Макрос ENCODING_SCALAR_ONLY отключает векторный (SSE2, NEON) пропуск
+ *  участков из печатных символов ASCII при проверке.
+ */
+
+bool Encoding_checkText
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars );
+
+// checkText и toUnicode за один проход (для UCS-2 - только проверка). При
+//  ошибке возвращает смещение первого символа, не прошедшего проверку, или
+//  наибольшую длину текста, если он не помещается, - текст в буфере тогда
+//  остается прежним (до нуля в конце). В том же проходе считает концы строк
+//  по видам (endlCount может быть NULL)
+size_t Encoding_checkTextAndToUnicode
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount );
+
+void Encoding_toUnicode(const LPM_Buf * text, LPM_Encoding encoding);
+void Encoding_fromUnicode(const LPM_Buf * text, LPM_Encoding encoding);
+
+#endif // ENCODING_H
@@ -0,0 +1,262 @@
+#ifndef ENCODING_TABLES_H
+#define ENCODING_TABLES_H
+
+#include "lpm_unicode.h"
+
+/*
+ * Таблицы 8-битных кодировок. Таблица декодирования - символ для каждого
+ *  байта (ENCODING_NO_CHAR - байта в кодировке нет). Таблица кодирования -
+ *  пары символ-байт, отсортированные по символу, для всех байт от identityEnd
+ *  и выше: байты ниже identityEnd кодируют символы с тем же кодом. Таблицы
+ *  сверены с образцами из _Doc/кодировки.
+ */
+
+#define ENCODING_NO_CHAR 0xFFFF
+
+typedef struct EncodingPair
+{
+    unicode_t chr;
+    uint8_t byte;
+} EncodingPair;
+
+// ASCII (CP866)
+static const unicode_t asciiDecodeTable[256] =
+{
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x007F,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0401, 0x0451, 0x0404, 0x0454, 0x0407, 0x0457, 0x040E, 0x045E,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x2116, 0x00A4, 0x25A0, 0x00A0
+};
+
+static const EncodingPair asciiEncodeTable[128] =
+{
+    { 0x00A0, 0xFF }, { 0x00A4, 0xFD }, { 0x00B0, 0xF8 }, { 0x00B7, 0xFA },
+    { 0x0401, 0xF0 }, { 0x0404, 0xF2 }, { 0x0407, 0xF4 }, { 0x040E, 0xF6 },
+    { 0x0410, 0x80 }, { 0x0411, 0x81 }, { 0x0412, 0x82 }, { 0x0413, 0x83 },
+    { 0x0414, 0x84 }, { 0x0415, 0x85 }, { 0x0416, 0x86 }, { 0x0417, 0x87 },
+    { 0x0418, 0x88 }, { 0x0419, 0x89 }, { 0x041A, 0x8A }, { 0x041B, 0x8B },
+    { 0x041C, 0x8C }, { 0x041D, 0x8D }, { 0x041E, 0x8E }, { 0x041F, 0x8F },
+    { 0x0420, 0x90 }, { 0x0421, 0x91 }, { 0x0422, 0x92 }, { 0x0423, 0x93 },
+    { 0x0424, 0x94 }, { 0x0425, 0x95 }, { 0x0426, 0x96 }, { 0x0427, 0x97 },
+    { 0x0428, 0x98 }, { 0x0429, 0x99 }, { 0x042A, 0x9A }, { 0x042B, 0x9B },
+    { 0x042C, 0x9C }, { 0x042D, 0x9D }, { 0x042E, 0x9E }, { 0x042F, 0x9F },
+    { 0x0430, 0xA0 }, { 0x0431, 0xA1 }, { 0x0432, 0xA2 }, { 0x0433, 0xA3 },
+    { 0x0434, 0xA4 }, { 0x0435, 0xA5 }, { 0x0436, 0xA6 }, { 0x0437, 0xA7 },
+    { 0x0438, 0xA8 }, { 0x0439, 0xA9 }, { 0x043A, 0xAA }, { 0x043B, 0xAB },
+    { 0x043C, 0xAC }, { 0x043D, 0xAD }, { 0x043E, 0xAE }, { 0x043F, 0xAF },
+    { 0x0440, 0xE0 }, { 0x0441, 0xE1 }, { 0x0442, 0xE2 }, { 0x0443, 0xE3 },
+    { 0x0444, 0xE4 }, { 0x0445, 0xE5 }, { 0x0446, 0xE6 }, { 0x0447, 0xE7 },
+    { 0x0448, 0xE8 }, { 0x0449, 0xE9 }, { 0x044A, 0xEA }, { 0x044B, 0xEB },
+    { 0x044C, 0xEC }, { 0x044D, 0xED }, { 0x044E, 0xEE }, { 0x044F, 0xEF },
+    { 0x0451, 0xF1 }, { 0x0454, 0xF3 }, { 0x0457, 0xF5 }, { 0x045E, 0xF7 },
+    { 0x2116, 0xFC }, { 0x2219, 0xF9 }, { 0x221A, 0xFB }, { 0x2500, 0xC4 },
+    { 0x2502, 0xB3 }, { 0x250C, 0xDA }, { 0x2510, 0xBF }, { 0x2514, 0xC0 },
+    { 0x2518, 0xD9 }, { 0x251C, 0xC3 }, { 0x2524, 0xB4 }, { 0x252C, 0xC2 },
+    { 0x2534, 0xC1 }, { 0x253C, 0xC5 }, { 0x2550, 0xCD }, { 0x2551, 0xBA },
+    { 0x2552, 0xD5 }, { 0x2553, 0xD6 }, { 0x2554, 0xC9 }, { 0x2555, 0xB8 },
+    { 0x2556, 0xB7 }, { 0x2557, 0xBB }, { 0x2558, 0xD4 }, { 0x2559, 0xD3 },
+    { 0x255A, 0xC8 }, { 0x255B, 0xBE }, { 0x255C, 0xBD }, { 0x255D, 0xBC },
+    { 0x255E, 0xC6 }, { 0x255F, 0xC7 }, { 0x2560, 0xCC }, { 0x2561, 0xB5 },
+    { 0x2562, 0xB6 }, { 0x2563, 0xB9 }, { 0x2564, 0xD1 }, { 0x2565, 0xD2 },
+    { 0x2566, 0xCB }, { 0x2567, 0xCF }, { 0x2568, 0xD0 }, { 0x2569, 0xCA },
+    { 0x256A, 0xD8 }, { 0x256B, 0xD7 }, { 0x256C, 0xCE }, { 0x2580, 0xDF },
+    { 0x2584, 0xDC }, { 0x2588, 0xDB }, { 0x258C, 0xDD }, { 0x2590, 0xDE },
+    { 0x2591, 0xB0 }, { 0x2592, 0xB1 }, { 0x2593, 0xB2 }, { 0x25A0, 0xFE }
+};
+
+// KOI-7 H0
+static const unicode_t koi7h0DecodeTable[256] =
+{
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x007F,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+};
+
+// KOI-7 H1
+static const unicode_t koi7h1DecodeTable[256] =
+{
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+    0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+    0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+    0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+    0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x007F,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+};
+
+static const EncodingPair koi7h1EncodeTable[64] =
+{
+    { 0x007F, 0x7F }, { 0x0410, 0x61 }, { 0x0411, 0x62 }, { 0x0412, 0x77 },
+    { 0x0413, 0x67 }, { 0x0414, 0x64 }, { 0x0415, 0x65 }, { 0x0416, 0x76 },
+    { 0x0417, 0x7A }, { 0x0418, 0x69 }, { 0x0419, 0x6A }, { 0x041A, 0x6B },
+    { 0x041B, 0x6C }, { 0x041C, 0x6D }, { 0x041D, 0x6E }, { 0x041E, 0x6F },
+    { 0x041F, 0x70 }, { 0x0420, 0x72 }, { 0x0421, 0x73 }, { 0x0422, 0x74 },
+    { 0x0423, 0x75 }, { 0x0424, 0x66 }, { 0x0425, 0x68 }, { 0x0426, 0x63 },
+    { 0x0427, 0x7E }, { 0x0428, 0x7B }, { 0x0429, 0x7D }, { 0x042B, 0x79 },
+    { 0x042C, 0x78 }, { 0x042D, 0x7C }, { 0x042E, 0x60 }, { 0x042F, 0x71 },
+    { 0x0430, 0x41 }, { 0x0431, 0x42 }, { 0x0432, 0x57 }, { 0x0433, 0x47 },
+    { 0x0434, 0x44 }, { 0x0435, 0x45 }, { 0x0436, 0x56 }, { 0x0437, 0x5A },
+    { 0x0438, 0x49 }, { 0x0439, 0x4A }, { 0x043A, 0x4B }, { 0x043B, 0x4C },
+    { 0x043C, 0x4D }, { 0x043D, 0x4E }, { 0x043E, 0x4F }, { 0x043F, 0x50 },
+    { 0x0440, 0x52 }, { 0x0441, 0x53 }, { 0x0442, 0x54 }, { 0x0443, 0x55 },
+    { 0x0444, 0x46 }, { 0x0445, 0x48 }, { 0x0446, 0x43 }, { 0x0447, 0x5E },
+    { 0x0448, 0x5B }, { 0x0449, 0x5D }, { 0x044A, 0x5F }, { 0x044B, 0x59 },
+    { 0x044C, 0x58 }, { 0x044D, 0x5C }, { 0x044E, 0x40 }, { 0x044F, 0x51 }
+};
+
+// KOI-8 (KOI8-R)
+static const unicode_t koi8DecodeTable[256] =
+{
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x007F,
+    0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524,
+    0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248,
+    0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+    0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+    0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+    0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+    0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+    0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+    0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+    0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A
+};
+
+static const EncodingPair koi8EncodeTable[128] =
+{
+    { 0x00A0, 0x9A }, { 0x00A9, 0xBF }, { 0x00B0, 0x9C }, { 0x00B2, 0x9D },
+    { 0x00B7, 0x9E }, { 0x00F7, 0x9F }, { 0x0401, 0xB3 }, { 0x0410, 0xE1 },
+    { 0x0411, 0xE2 }, { 0x0412, 0xF7 }, { 0x0413, 0xE7 }, { 0x0414, 0xE4 },
+    { 0x0415, 0xE5 }, { 0x0416, 0xF6 }, { 0x0417, 0xFA }, { 0x0418, 0xE9 },
+    { 0x0419, 0xEA }, { 0x041A, 0xEB }, { 0x041B, 0xEC }, { 0x041C, 0xED },
+    { 0x041D, 0xEE }, { 0x041E, 0xEF }, { 0x041F, 0xF0 }, { 0x0420, 0xF2 },
+    { 0x0421, 0xF3 }, { 0x0422, 0xF4 }, { 0x0423, 0xF5 }, { 0x0424, 0xE6 },
+    { 0x0425, 0xE8 }, { 0x0426, 0xE3 }, { 0x0427, 0xFE }, { 0x0428, 0xFB },
+    { 0x0429, 0xFD }, { 0x042A, 0xFF }, { 0x042B, 0xF9 }, { 0x042C, 0xF8 },
+    { 0x042D, 0xFC }, { 0x042E, 0xE0 }, { 0x042F, 0xF1 }, { 0x0430, 0xC1 },
+    { 0x0431, 0xC2 }, { 0x0432, 0xD7 }, { 0x0433, 0xC7 }, { 0x0434, 0xC4 },
+    { 0x0435, 0xC5 }, { 0x0436, 0xD6 }, { 0x0437, 0xDA }, { 0x0438, 0xC9 },
+    { 0x0439, 0xCA }, { 0x043A, 0xCB }, { 0x043B, 0xCC }, { 0x043C, 0xCD },
+    { 0x043D, 0xCE }, { 0x043E, 0xCF }, { 0x043F, 0xD0 }, { 0x0440, 0xD2 },
+    { 0x0441, 0xD3 }, { 0x0442, 0xD4 }, { 0x0443, 0xD5 }, { 0x0444, 0xC6 },
+    { 0x0445, 0xC8 }, { 0x0446, 0xC3 }, { 0x0447, 0xDE }, { 0x0448, 0xDB },
+    { 0x0449, 0xDD }, { 0x044A, 0xDF }, { 0x044B, 0xD9 }, { 0x044C, 0xD8 },
+    { 0x044D, 0xDC }, { 0x044E, 0xC0 }, { 0x044F, 0xD1 }, { 0x0451, 0xA3 },
+    { 0x2219, 0x95 }, { 0x221A, 0x96 }, { 0x2248, 0x97 }, { 0x2264, 0x98 },
+    { 0x2265, 0x99 }, { 0x2320, 0x93 }, { 0x2321, 0x9B }, { 0x2500, 0x80 },
+    { 0x2502, 0x81 }, { 0x250C, 0x82 }, { 0x2510, 0x83 }, { 0x2514, 0x84 },
+    { 0x2518, 0x85 }, { 0x251C, 0x86 }, { 0x2524, 0x87 }, { 0x252C, 0x88 },
+    { 0x2534, 0x89 }, { 0x253C, 0x8A }, { 0x2550, 0xA0 }, { 0x2551, 0xA1 },
+    { 0x2552, 0xA2 }, { 0x2553, 0xA4 }, { 0x2554, 0xA5 }, { 0x2555, 0xA6 },
+    { 0x2556, 0xA7 }, { 0x2557, 0xA8 }, { 0x2558, 0xA9 }, { 0x2559, 0xAA },
+    { 0x255A, 0xAB }, { 0x255B, 0xAC }, { 0x255C, 0xAD }, { 0x255D, 0xAE },
+    { 0x255E, 0xAF }, { 0x255F, 0xB0 }, { 0x2560, 0xB1 }, { 0x2561, 0xB2 },
+    { 0x2562, 0xB4 }, { 0x2563, 0xB5 }, { 0x2564, 0xB6 }, { 0x2565, 0xB7 },
+    { 0x2566, 0xB8 }, { 0x2567, 0xB9 }, { 0x2568, 0xBA }, { 0x2569, 0xBB },
+    { 0x256A, 0xBC }, { 0x256B, 0xBD }, { 0x256C, 0xBE }, { 0x2580, 0x8B },
+    { 0x2584, 0x8C }, { 0x2588, 0x8D }, { 0x258C, 0x8E }, { 0x2590, 0x8F },
+    { 0x2591, 0x90 }, { 0x2592, 0x91 }, { 0x2593, 0x92 }, { 0x25A0, 0x94 }
+};
+
+#endif // ENCODING_TABLES_H
@@ -15,6 +15,14 @@ typedef struct LPM_Point
     uint8_t y;
 } LPM_Point;
 
+// Концы строк по видам: одиночные CR и LF и пары CR LF
+typedef struct LPM_EndlCount
+{
+    size_t cr;
+    size_t lf;
+    size_t crLf;
+} LPM_EndlCount;
+
 typedef struct LPM_SelectionCursor
 {
     size_t pos;
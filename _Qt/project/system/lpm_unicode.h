@@ -87,4 +87,11 @@ typedef struct Unicode_Buf
     size_t size;
 } Unicode_Buf;
 
+// Текст только для чтения: например, участок прямо из хранилища текста
+typedef struct Unicode_ConstBuf
+{
+    const unicode_t * data;
+    size_t size;
+} Unicode_ConstBuf;
+
 #endif // LPM_UNICODE_H
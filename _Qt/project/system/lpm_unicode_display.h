@@ -10,13 +10,42 @@
 
 struct LPM_UnicodeDisplay;
 
+// Текст строки передается только для чтения: он может лежать прямо в
+//  хранилище текста (в т.ч. в отображенном только для чтения файле)
 typedef struct LPM_UnicodeDisplayFxns
 {
     void (*writeLine)   ( struct LPM_UnicodeDisplay * i,
                           size_t lineIndex,
-                          const Unicode_Buf * lineBuf,
+                          const Unicode_ConstBuf * lineBuf,
                           const LPM_SelectionCursor * selCurs);
     void (*clearScreen) (struct LPM_UnicodeDisplay * i);
+
+    // Необязательная (может быть NULL): вывести только символы строки с
+    //  позиции pos (spanBuf). Курсор выделения - в позициях всей строки
+    void (*writeSpan)   ( struct LPM_UnicodeDisplay * i,
+                          size_t lineIndex,
+                          size_t pos,
+                          const Unicode_ConstBuf * spanBuf,
+                          const LPM_SelectionCursor * selCurs);
+
+    // Необязательная (может быть NULL): сменить только курсор выделения
+    //  строки, выведенной раньше (текст строки не изменился)
+    void (*setSelection)( struct LPM_UnicodeDisplay * i,
+                          size_t lineIndex,
+                          const LPM_SelectionCursor * selCurs);
+
+    // Необязательные (могут быть NULL): начало и конец кадра. Все выводы
+    //  между ними относятся к одному обновлению экрана, и дисплей может
+    //  передать их одной посылкой в endFrame
+    void (*beginFrame)  (struct LPM_UnicodeDisplay * i);
+    void (*endFrame)    (struct LPM_UnicodeDisplay * i);
+
+    // Необязательная (может быть NULL): сдвинуть выведенные строки вместе с
+    //  выделением на lineAmount строк вверх (up) или вниз. Открывшиеся строки
+    //  затем выводятся заново
+    void (*scroll)      ( struct LPM_UnicodeDisplay * i,
+                          bool up,
+                          size_t lineAmount );
 } LPM_UnicodeDisplayFxns;
 
 typedef struct LPM_UnicodeDisplay
@@ -27,12 +56,62 @@ typedef struct LPM_UnicodeDisplay
 
 inline void LPM_UnicodeDisplay_writeLine( LPM_UnicodeDisplay * i,
                                           size_t lineIndex,
-                                          const Unicode_Buf * lineBuf,
+                                          const Unicode_ConstBuf * lineBuf,
                                           const LPM_SelectionCursor * selCurs )
 {
     (*(i->fxns->writeLine))(i, lineIndex, lineBuf, selCurs);
 }
 
+inline bool LPM_UnicodeDisplay_hasWriteSpan(LPM_UnicodeDisplay * i)
+{
+    return i->fxns->writeSpan != NULL;
+}
+
+inline void LPM_UnicodeDisplay_writeSpan( LPM_UnicodeDisplay * i,
+                                          size_t lineIndex,
+                                          size_t pos,
+                                          const Unicode_ConstBuf * spanBuf,
+                                          const LPM_SelectionCursor * selCurs )
+{
+    (*(i->fxns->writeSpan))(i, lineIndex, pos, spanBuf, selCurs);
+}
+
+inline bool LPM_UnicodeDisplay_hasSetSelection(LPM_UnicodeDisplay * i)
+{
+    return i->fxns->setSelection != NULL;
+}
+
+inline void LPM_UnicodeDisplay_setSelection( LPM_UnicodeDisplay * i,
+                                             size_t lineIndex,
+                                             const LPM_SelectionCursor * selCurs )
+{
+    (*(i->fxns->setSelection))(i, lineIndex, selCurs);
+}
+
+inline void LPM_UnicodeDisplay_beginFrame(LPM_UnicodeDisplay * i)
+{
+    if(i->fxns->beginFrame != NULL)
+        (*(i->fxns->beginFrame))(i);
+}
+
+inline void LPM_UnicodeDisplay_endFrame(LPM_UnicodeDisplay * i)
+{
+    if(i->fxns->endFrame != NULL)
+        (*(i->fxns->endFrame))(i);
+}
+
+inline bool LPM_UnicodeDisplay_hasScroll(LPM_UnicodeDisplay * i)
+{
+    return i->fxns->scroll != NULL;
+}
+
+inline void LPM_UnicodeDisplay_scroll( LPM_UnicodeDisplay * i,
+                                       bool up,
+                                       size_t lineAmount )
+{
+    (*(i->fxns->scroll))(i, up, lineAmount);
+}
+
 inline void LPM_UnicodeDisplay_clearScreen(LPM_UnicodeDisplay * i)
 {
     (*(i->fxns->clearScreen))(i);
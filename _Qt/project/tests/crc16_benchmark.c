@@ -0,0 +1,102 @@
+/*
+ * Сравнение побайтового расчета CRC16 (crc16_table_calc_for_array) с
+ *  расчетом по 8 байт за шаг (crc16_slice8_calc_for_array) из crc16_table.h.
+ *  Сначала проверяется, что оба расчета дают одинаковую CRC на массивах
+ *  разной длины и выравнивания, затем замеряется время на строку экрана
+ *  типичных длин (строка в UTF-16 - по 2 байта на символ).
+ * Отдельная программа на C, в проект Qt не входит. Сборка и запуск:
+ *  gcc -std=c99 -O2 -I../editor_core crc16_benchmark.c -o crc16_benchmark
+ *  ./crc16_benchmark
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crc16_table.h"
+
+#ifdef CRC16_TABLE_BYTEWISE
+#error "Расчет по 8 байт за шаг выключен (CRC16_TABLE_BYTEWISE) - сравнивать не с чем"
+#endif
+
+#define BUFFER_SIZE         4096
+#define MAX_CHECKED_SIZE    300
+#define MAX_CHECKED_OFFSET  8
+#define BYTES_PER_RUN       200000000L
+
+static uint8_t buffer[BUFFER_SIZE];
+
+static double _now(void);
+static int _checkEquality(void);
+static void _measure(size_t size);
+
+int main(void)
+{
+    static const size_t lineSizeTable[] = { 16, 64, 128, 160 };
+
+    srand(1);
+    for(size_t i = 0; i < BUFFER_SIZE; i++)
+        buffer[i] = (uint8_t)rand();
+
+    if(_checkEquality() != 0)
+        return 1;
+
+    for(size_t i = 0; i < sizeof(lineSizeTable)/sizeof(lineSizeTable[0]); i++)
+        _measure(lineSizeTable[i]);
+    return 0;
+}
+
+double _now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int _checkEquality(void)
+{
+    for(size_t size = 0; size < MAX_CHECKED_SIZE; size++)
+    {
+        for(size_t offset = 0; offset < MAX_CHECKED_OFFSET; offset++)
+        {
+            uint16_t bytewise = crc16_table_calc_for_array(buffer + offset, size);
+            uint16_t slice8   = crc16_slice8_calc_for_array(buffer + offset, size);
+            if(bytewise != slice8)
+            {
+                printf( "CRC не совпадает: размер %zu, смещение %zu: %04X и %04X\n",
+                        size, offset, bytewise, slice8 );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Начало массива сдвигается на каждом шаге, чтобы расчет не сводился к
+//  одному и тому же выровненному участку
+void _measure(size_t size)
+{
+    const long runs = BYTES_PER_RUN / (long)size;
+    volatile uint16_t sink = 0;
+    long i;
+
+    double t0 = _now();
+    for(i = 0; i < runs; i++)
+        sink ^= crc16_table_calc_for_array(buffer + (i & 63), size);
+
+    double t1 = _now();
+    for(i = 0; i < runs; i++)
+        sink ^= crc16_slice8_calc_for_array(buffer + (i & 63), size);
+
+    double t2 = _now();
+    (void)sink;
+
+    printf( "%3zu байт: побайтово %6.2f нс, по 8 байт %6.2f нс (в %.1f раза быстрее)\n",
+            size,
+            (t1 - t0) / runs * 1e9,
+            (t2 - t1) / runs * 1e9,
+            (t1 - t0) / (t2 - t1) );
+}
@@ -0,0 +1,457 @@
+/*
+ * Проверка перекодирования (editor_support/encoding.c):
+ *  - образцы из _Doc/кодировки: строки образца после перекодирования в UCS-2
+ *    совпадают с теми же строками unicode.txt, а образец, перекодированный в
+ *    UCS-2 и обратно, совпадает с исходным побайтно;
+ *  - все 256 значений байта каждой 8-битной кодировки: байт переходит в
+ *    символ из таблицы и обратно в тот же байт (байт без символа - в '?');
+ *  - перекодирование на месте: случайные тексты (с постоянным начальным
+ *    числом) в буфере, который только-только вмещает текст в UCS-2,
+ *    перекодируются в UCS-2 и обратно так же, как посимвольно;
+ *  - векторный вариант (пропуск участков из печатных символов ASCII) дает
+ *    то же, что скалярный (ENCODING_SCALAR_ONLY), на случайных текстах, в
+ *    том числе с ошибками и в UTF-8. Скалярный вариант собирается в эту же
+ *    программу под другими именами.
+ * Отдельная программа на C, в проект Qt не входит. Сборка и запуск:
+ *  gcc -std=c99 -O2 -I../editor_support -I../editor_api -I../system
+ *      encoding_check.c ../editor_support/encoding.c -o encoding_check
+ *  ./encoding_check [каталог образцов [количество текстов]]
+ * Каталог образцов по умолчанию - ../../../_Doc/кодировки (запуск из tests).
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENCODING_SCALAR_ONLY
+#define Encoding_checkText              ScalarEncoding_checkText
+#define Encoding_checkTextAndToUnicode  ScalarEncoding_checkTextAndToUnicode
+#define Encoding_toUnicode              ScalarEncoding_toUnicode
+#define Encoding_fromUnicode            ScalarEncoding_fromUnicode
+#include "encoding.c"
+#undef Encoding_checkText
+#undef Encoding_checkTextAndToUnicode
+#undef Encoding_toUnicode
+#undef Encoding_fromUnicode
+#undef ENCODING_SCALAR_ONLY
+
+// Векторный вариант - из encoding.c, собранного отдельно
+bool Encoding_checkText
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars );
+size_t Encoding_checkTextAndToUnicode
+        ( const LPM_Buf * text,
+          LPM_Encoding encoding,
+          size_t maxSize,
+          bool ignoreSpecChars,
+          LPM_EndlCount * endlCount );
+void Encoding_toUnicode(const LPM_Buf * text, LPM_Encoding encoding);
+void Encoding_fromUnicode(const LPM_Buf * text, LPM_Encoding encoding);
+
+#define DEFAULT_CHARTS_DIR  "../../../_Doc/кодировки"
+#define DEFAULT_RUNS        3000
+#define MAX_CHART_SIZE      2048
+#define MAX_TEXT_SIZE       300
+#define CHART_HEADER_SIZE   2
+
+// Строки образца, которые совпадают с теми же строками unicode.txt. Во всех
+//  образцах первая строка - заголовок со своим названием кодировки
+typedef struct Chart
+{
+    LPM_Encoding encoding;
+    const char * fileName;
+    size_t linesAmount;
+    size_t lines[3];
+} Chart;
+
+static const Chart charts[] =
+{
+    { LPM_ENCODING_ASCII,   "cp866.txt",   3, { 1, 2, 3 } },
+    { LPM_ENCODING_KOI_8,   "koi8-r.txt",  3, { 1, 2, 3 } },
+    { LPM_ENCODING_KOI_7H0, "koi7-n0.txt", 1, { 3 } },
+    { LPM_ENCODING_KOI_7H1, "koi7-n1.txt", 1, { 1 } }
+};
+
+#define CHARTS_AMOUNT       (sizeof(charts)/sizeof(charts[0]))
+#define ENCODINGS_AMOUNT    (LPM_ENCODING_UTF8 + 1)
+
+static const char * encodingNames[] =
+{
+    "UCS-2LE", "ASCII", "KOI-7 H0", "KOI-7 H1", "KOI-8", "UTF-8"
+};
+
+// Символ каждого байта 8-битных кодировок (по Encoding_toUnicode одного байта)
+static unicode_t decodedBytes[ENCODINGS_AMOUNT][256];
+
+static unicode_t unicodeChart[MAX_CHART_SIZE];
+static unicode_t chartBuf[MAX_CHART_SIZE];
+static uint8_t chartBytes[MAX_CHART_SIZE];
+
+static int _checkCharts(const char * dir);
+static int _checkBytes(LPM_Encoding encoding);
+static int _checkInPlace(LPM_Encoding encoding, int runs);
+static int _checkVariants(LPM_Encoding encoding, int runs);
+static size_t _loadChart(const char * dir, const char * fileName, uint8_t * data, size_t size);
+static const unicode_t * _findLine(const unicode_t * text, size_t index, size_t * len);
+static size_t _fillBytes(LPM_Encoding encoding, uint8_t * text, bool validOnly);
+static size_t _fillUnicode(unicode_t * text);
+static uint8_t * _putUtf8(unicode_t chr, uint8_t * dst);
+static bool _isEightBit(LPM_Encoding encoding);
+
+int main(int argc, char ** argv)
+{
+    const char * dir = argc > 1 ? argv[1] : DEFAULT_CHARTS_DIR;
+    const int runs   = argc > 2 ? atoi(argv[2]) : DEFAULT_RUNS;
+    int failed = 0;
+
+    srand(1);
+
+    for(int e = 0; e < (int)ENCODINGS_AMOUNT; e++)
+        if(_isEightBit((LPM_Encoding)e))
+            failed += _checkBytes((LPM_Encoding)e);
+
+    failed += _checkCharts(dir);
+
+    for(int e = 0; e < (int)ENCODINGS_AMOUNT; e++)
+    {
+        if(_isEightBit((LPM_Encoding)e))
+            failed += _checkInPlace((LPM_Encoding)e, runs);
+        failed += _checkVariants((LPM_Encoding)e, runs);
+    }
+
+    printf("Текстов: %d, расхождений: %d\n", runs, failed);
+    return failed == 0 ? 0 : 1;
+}
+
+int _checkCharts(const char * dir)
+{
+    int failed = 0;
+
+    size_t unicodeSize = _loadChart( dir, "unicode.txt", (uint8_t*)unicodeChart,
+                                     sizeof(unicodeChart) - sizeof(unicode_t) );
+    if(unicodeSize == 0)
+        return 1;
+    unicodeChart[unicodeSize / sizeof(unicode_t)] = 0x0000;
+
+    for(size_t c = 0; c < CHARTS_AMOUNT; c++)
+    {
+        const Chart * chart = &charts[c];
+        size_t len = _loadChart( dir, chart->fileName, chartBytes,
+                                 sizeof(chartBytes) - 1 );
+        if(len == 0)
+        {
+            failed++;
+            continue;
+        }
+        chartBytes[len] = 0x00;
+        len = strlen((const char*)chartBytes);
+
+        LPM_Buf text = { (uint8_t*)chartBuf, (len + 1) * sizeof(unicode_t) };
+        memcpy(chartBuf, chartBytes, len + 1);
+        Encoding_toUnicode(&text, chart->encoding);
+
+        for(size_t i = 0; i < chart->linesAmount; i++)
+        {
+            size_t chartLen, refLen;
+            const unicode_t * chartLine = _findLine(chartBuf, chart->lines[i], &chartLen);
+            const unicode_t * refLine   = _findLine(unicodeChart, chart->lines[i], &refLen);
+            if( chartLen != refLen ||
+                memcmp(chartLine, refLine, refLen * sizeof(unicode_t)) != 0 )
+            {
+                printf( "Образец %s: строка %zu не совпадает с unicode.txt\n",
+                        chart->fileName, chart->lines[i] );
+                failed++;
+            }
+        }
+
+        Encoding_fromUnicode(&text, chart->encoding);
+        if(memcmp(chartBuf, chartBytes, len + 1) != 0)
+        {
+            printf("Образец %s: после перекодирования туда и обратно текст другой\n", chart->fileName);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int _checkBytes(LPM_Encoding encoding)
+{
+    int failed = 0;
+
+    for(int byte = 1; byte < 256; byte++)
+    {
+        unicode_t buf[2] = { 0, 0 };
+        LPM_Buf text = { (uint8_t*)buf, sizeof(buf) };
+        ((uint8_t*)buf)[0] = (uint8_t)byte;
+
+        Encoding_toUnicode(&text, encoding);
+        unicode_t chr = buf[0];
+        decodedBytes[encoding][byte] = chr;
+
+        Encoding_fromUnicode(&text, encoding);
+        uint8_t expected = chr != ENCODING_NO_CHAR ? (uint8_t)byte : (uint8_t)'?';
+        if(((uint8_t*)buf)[0] != expected || ((uint8_t*)buf)[1] != 0x00)
+        {
+            printf( "%s: байт %02X -> символ %04X -> байт %02X\n",
+                    encodingNames[encoding], byte, chr, ((uint8_t*)buf)[0] );
+            failed++;
+        }
+    }
+    return failed;
+}
+
+// Текст из байт с символами занимает буфер UCS-2 длиной ровно в текст с нулем
+int _checkInPlace(LPM_Encoding encoding, int runs)
+{
+    static uint8_t original[MAX_TEXT_SIZE + 1];
+    static unicode_t buf[MAX_TEXT_SIZE + 1];
+    int failed = 0;
+
+    for(int run = 0; run < runs; run++)
+    {
+        size_t len = _fillBytes(encoding, original, true);
+        LPM_Buf text = { (uint8_t*)buf, (len + 1) * sizeof(unicode_t) };
+
+        memcpy(buf, original, len + 1);
+        Encoding_toUnicode(&text, encoding);
+        bool passed = buf[len] == 0x0000;
+        for(size_t i = 0; i < len && passed; i++)
+            passed = buf[i] == decodedBytes[encoding][original[i]];
+
+        Encoding_fromUnicode(&text, encoding);
+        passed = passed && memcmp(buf, original, len + 1) == 0;
+
+        // Текст, который не проходит проверку, остается прежним
+        memcpy(buf, original, len + 1);
+        bool isText = Encoding_checkText(&text, encoding, text.size, false);
+        LPM_EndlCount endlCount;
+        size_t result = Encoding_checkTextAndToUnicode( &text, encoding, text.size,
+                                                        false, &endlCount );
+        if(!isText)
+            passed = passed && result != LPM_ENCODING_TEXT_OK &&
+                     memcmp(buf, original, len + 1) == 0;
+        else
+            passed = passed && result == LPM_ENCODING_TEXT_OK && buf[len] == 0x0000;
+        for(size_t i = 0; i < len && passed && isText; i++)
+            passed = buf[i] == decodedBytes[encoding][original[i]];
+
+        if(!passed)
+        {
+            printf( "%s: перекодирование на месте, текст %d длиной %zu\n",
+                    encodingNames[encoding], run, len );
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int _checkVariants(LPM_Encoding encoding, int runs)
+{
+    static unicode_t src[MAX_TEXT_SIZE * 2 + 1];
+    static unicode_t buf1[MAX_TEXT_SIZE * 2 + 1];
+    static unicode_t buf2[MAX_TEXT_SIZE * 2 + 1];
+    int failed = 0;
+
+    for(int run = 0; run < runs; run++)
+    {
+        bool passed = true;
+        size_t size;
+        if(encoding == LPM_ENCODING_UNICODE_UCS2LE)
+            size = (_fillUnicode(src) + 1) * sizeof(unicode_t);
+        else
+            size = (_fillBytes(encoding, (uint8_t*)src, rand() % 2) + 1) * sizeof(unicode_t);
+        if(rand() % 4 == 0)
+            size += rand() % (sizeof(src) - size + 1);
+
+        size_t maxSize = rand() % 4 == 0 ? (size_t)rand() % (size + 1) : size;
+        bool ignoreSpecChars = rand() % 2;
+
+        LPM_Buf text1 = { (uint8_t*)buf1, size };
+        LPM_Buf text2 = { (uint8_t*)buf2, size };
+
+        memcpy(buf1, src, sizeof(src));
+        memcpy(buf2, src, sizeof(src));
+        passed = passed && Encoding_checkText(&text1, encoding, maxSize, ignoreSpecChars) ==
+                           ScalarEncoding_checkText(&text2, encoding, maxSize, ignoreSpecChars);
+
+        LPM_EndlCount endlCount1, endlCount2;
+        size_t result1 = Encoding_checkTextAndToUnicode( &text1, encoding, maxSize,
+                                                         ignoreSpecChars, &endlCount1 );
+        size_t result2 = ScalarEncoding_checkTextAndToUnicode( &text2, encoding, maxSize,
+                                                               ignoreSpecChars, &endlCount2 );
+        passed = passed && result1 == result2 && memcmp(buf1, buf2, size) == 0;
+        if(passed && result1 == LPM_ENCODING_TEXT_OK)
+            passed = endlCount1.cr   == endlCount2.cr   &&
+                     endlCount1.lf   == endlCount2.lf   &&
+                     endlCount1.crLf == endlCount2.crLf;
+
+        memcpy(buf1, src, sizeof(src));
+        memcpy(buf2, src, sizeof(src));
+        Encoding_toUnicode(&text1, encoding);
+        ScalarEncoding_toUnicode(&text2, encoding);
+        passed = passed && memcmp(buf1, buf2, size) == 0;
+
+        size = (_fillUnicode(src) + 1) * sizeof(unicode_t);
+        text1.size = text2.size = size;
+        memcpy(buf1, src, sizeof(src));
+        memcpy(buf2, src, sizeof(src));
+        Encoding_fromUnicode(&text1, encoding);
+        ScalarEncoding_fromUnicode(&text2, encoding);
+        passed = passed && memcmp(buf1, buf2, size) == 0;
+
+        if(!passed)
+        {
+            printf( "%s: векторный и скалярный варианты расходятся, текст %d\n",
+                    encodingNames[encoding], run );
+            failed++;
+        }
+    }
+    return failed;
+}
+
+// Образцы начинаются с двух байт FF FE, они в текст не входят
+size_t _loadChart(const char * dir, const char * fileName, uint8_t * data, size_t size)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, fileName);
+
+    FILE * file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf("Нет образца %s\n", path);
+        return 0;
+    }
+
+    uint8_t header[CHART_HEADER_SIZE];
+    size_t len = 0;
+    if(fread(header, 1, sizeof(header), file) == sizeof(header))
+        len = fread(data, 1, size, file);
+    fclose(file);
+    return len;
+}
+
+// Строка с номером index - до LF, без CR перед ним
+const unicode_t * _findLine(const unicode_t * text, size_t index, size_t * len)
+{
+    for( ; index > 0 && *text != 0x0000; text++)
+        if(*text == 0x000A)
+            index--;
+
+    const unicode_t * end = text;
+    while(*end != 0x0000 && *end != 0x000A)
+        end++;
+    *len = (size_t)(end - text);
+    if(*len > 0 && end[-1] == 0x000D)
+        (*len)--;
+    return text;
+}
+
+// Длинные участки печатных символов ASCII (их кодировка пропускает
+//  векторно), концы строк и байты с символами. Без validOnly - и байты без
+//  символов, и управляющие. Для UTF-8 - символы до U+4800 и неверные байты
+size_t _fillBytes(LPM_Encoding encoding, uint8_t * text, bool validOnly)
+{
+    size_t len = 0;
+    size_t maxLen = rand() % MAX_TEXT_SIZE;
+
+    while(len < maxLen)
+    {
+        int r = rand() % 100;
+        if(r < 10)
+        {
+            size_t run = 1 + rand() % 40;
+            for( ; run > 0 && len < maxLen; run--)
+                text[len++] = (uint8_t)(0x20 + rand() % 0x5F);
+        }
+        else if(r < 20)
+        {
+            text[len++] = rand() % 2 ? 0x0D : 0x0A;
+        }
+        else if(encoding == LPM_ENCODING_UTF8)
+        {
+            if(!validOnly && r < 25)
+            {
+                text[len++] = (uint8_t)(0x80 + rand() % 0x80);
+                continue;
+            }
+            unicode_t chr = r < 60 ? 0x0410 + rand() % 0x40 :
+                            r < 80 ? 0x20 + rand() % 0x5F  :
+                                     0x0800 + rand() % 0x4000;
+            if(len + 3 > maxLen)
+                break;
+            len = (size_t)(_putUtf8(chr, text + len) - text);
+        }
+        else
+        {
+            uint8_t byte = (uint8_t)(1 + rand() % 255);
+            if(!validOnly || decodedBytes[encoding][byte] != ENCODING_NO_CHAR)
+                text[len++] = byte;
+        }
+    }
+    text[len] = 0x00;
+    return len;
+}
+
+// Печатные символы ASCII (и длинные участки из них), кириллица с буквами И,
+//  Е и диакритическими знаками, концы строк, символ полей вставки,
+//  псевдографика и символы, которых нет в 8-битных кодировках
+size_t _fillUnicode(unicode_t * text)
+{
+    static const unicode_t others[] =
+    {
+        0x0418, 0x0438, 0x0415, 0x0435, 0x0306, 0x0308, 0x0301,
+        0x2591, 0x2592, 0x2500, 0x00A0, 0x00B0, 0x0E81, 0x0EB1, 0x4000, 0x7FFF
+    };
+    size_t len = 0;
+    size_t maxLen = rand() % MAX_TEXT_SIZE;
+
+    while(len < maxLen)
+    {
+        int r = rand() % 100;
+        if(r < 10)
+        {
+            size_t run = 1 + rand() % 40;
+            for( ; run > 0 && len < maxLen; run--)
+                text[len++] = (unicode_t)(0x20 + rand() % 0x5F);
+        }
+        else if(r < 20)
+            text[len++] = rand() % 2 ? 0x000D : 0x000A;
+        else if(r < 60)
+            text[len++] = (unicode_t)(0x0410 + rand() % 0x40);
+        else if(r < 80)
+            text[len++] = (unicode_t)(0x20 + rand() % 0x5F);
+        else
+            text[len++] = others[rand() % (sizeof(others)/sizeof(others[0]))];
+    }
+    text[len] = 0x0000;
+    return len;
+}
+
+uint8_t * _putUtf8(unicode_t chr, uint8_t * dst)
+{
+    if(chr < 0x80)
+    {
+        *dst++ = (uint8_t)chr;
+    }
+    else if(chr < 0x800)
+    {
+        *dst++ = (uint8_t)(0xC0 | (chr >> 6));
+        *dst++ = (uint8_t)(0x80 | (chr & 0x3F));
+    }
+    else
+    {
+        *dst++ = (uint8_t)(0xE0 | (chr >> 12));
+        *dst++ = (uint8_t)(0x80 | ((chr >> 6) & 0x3F));
+        *dst++ = (uint8_t)(0x80 | (chr & 0x3F));
+    }
+    return dst;
+}
+
+bool _isEightBit(LPM_Encoding encoding)
+{
+    return encoding != LPM_ENCODING_UNICODE_UCS2LE &&
+           encoding != LPM_ENCODING_UTF8;
+}
@@ -0,0 +1,189 @@
+/*
+ * Сверка разбивки всего текста на страницы (Pagination_calcPageBases) в
+ *  нескольких частях с разбивкой в одной части и с проходом по строкам, как
+ *  листает PageFormatter: страница k начинается с начала последней строки
+ *  страницы k-1. Тексты и параметры страниц случайные (с постоянным
+ *  начальным числом): длинные и короткие строки, пробелы, все виды концов
+ *  строк, разное количество частей и ограничение таблицы страниц.
+ * Отдельная программа на C, в проект Qt не входит. Сборка с потоками и запуск:
+ *  gcc -std=c99 -O2 -DPAGINATION_THREADS -I../editor_core -I../editor_api
+ *      -I../editor_support -I../system pagination_check.c
+ *      ../editor_core/pagination.c ../editor_core/text_operator.c
+ *      ../editor_core/text_scan.c ../editor_support/lang_rus_eng.c
+ *      -lpthread -o pagination_check
+ *  ./pagination_check [количество текстов]
+ * Без PAGINATION_THREADS части разбиваются по очереди - так проверяется
+ *  само деление текста на части.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pagination.h"
+#include "text_operator.h"
+#include "lpm_lang_api.h"
+#include "lang_rus_eng.h"
+
+#define MAX_TEXT_SIZE       4000
+#define MAX_PAGES_AMOUNT    (MAX_TEXT_SIZE + 1)
+#define DEFAULT_RUNS        3000
+
+static LPM_LangFxns langFxns =
+{
+    Lang_RusEng_checkInputChar,
+    Lang_RusEng_nextChar,
+    Lang_RusEng_prevChar
+};
+
+static TextOperator textOperator;
+static unicode_t text[MAX_TEXT_SIZE + 1];
+static size_t walkTable[MAX_PAGES_AMOUNT];
+static size_t seqTable[MAX_PAGES_AMOUNT];
+static size_t thrTable[MAX_PAGES_AMOUNT];
+
+static size_t _fillText(void);
+static size_t _walkPages( const LPM_EditorPageParams * pageParams,
+                          size_t * pageBaseTable,
+                          size_t maxPagesAmount );
+static bool _sameResult( size_t pagesAmount1, const size_t * table1,
+                         size_t pagesAmount2, const size_t * table2,
+                         size_t maxPagesAmount );
+
+int main(int argc, char ** argv)
+{
+    const int runs = argc > 1 ? atoi(argv[1]) : DEFAULT_RUNS;
+    int failed = 0;
+
+    TextOperator_init(&textOperator, &langFxns);
+    srand(1);
+
+    for(int run = 0; run < runs; run++)
+    {
+        size_t textSize = _fillText();
+        LPM_EditorPageParams pageParams =
+        {
+            (uint16_t)(2 + rand() % 40),
+            (uint16_t)(1 + rand() % 8),
+            4, 4
+        };
+        size_t maxPagesAmount = rand() % 5 == 0 ? (size_t)(rand() % 10) : MAX_PAGES_AMOUNT;
+        size_t threadAmount   = 2 + rand() % (PAGINATION_MAX_THREADS - 1);
+
+        size_t walkPages = _walkPages(&pageParams, walkTable, maxPagesAmount);
+        size_t seqPages  = Pagination_calcPageBases( &textOperator, text, textSize,
+                                                     &pageParams, seqTable,
+                                                     maxPagesAmount, 1 );
+        size_t thrPages  = Pagination_calcPageBases( &textOperator, text, textSize,
+                                                     &pageParams, thrTable,
+                                                     maxPagesAmount, threadAmount );
+
+        bool seqPassed = _sameResult(walkPages, walkTable, seqPages, seqTable, maxPagesAmount);
+        bool thrPassed = _sameResult(seqPages, seqTable, thrPages, thrTable, maxPagesAmount);
+        if(!seqPassed || !thrPassed)
+        {
+            printf( "Расхождение в тексте %d: размер %zu, строка %u x %u, частей %zu, "
+                    "страниц: проход %zu, одна часть %zu, части %zu\n",
+                    run, textSize, pageParams.charAmount, pageParams.lineAmount,
+                    threadAmount, walkPages, seqPages, thrPages );
+            failed++;
+        }
+    }
+
+    printf("Текстов: %d, расхождений: %d\n", runs, failed);
+    return failed == 0 ? 0 : 1;
+}
+
+// Слова из латиницы с кириллицей (в т.ч. "й" из буквы и знака краткой - один
+//  символ из двух кодовых единиц), пробелы (и их серии) и концы строк LF, CR
+//  и CRLF. В части текстов CRLF стоят часто - на них текст делится на части
+size_t _fillText(void)
+{
+    size_t textSize = rand() % MAX_TEXT_SIZE;
+
+    for(size_t i = 0; i < textSize; i++)
+    {
+        int r = rand() % 100;
+        if(r < 70)
+            text[i] = 'a' + rand() % 5;
+        else if(r < 85)
+            text[i] = ' ';
+        else if(r < 90)
+            text[i] = '\n';
+        else if(r < 94)
+            text[i] = '\r';
+        else if(r < 96)
+            text[i] = 0x0430;
+        else if(r < 97)
+        {
+            text[i] = 0x0438;
+            if(i + 1 < textSize)
+                text[++i] = 0x0306;
+        }
+        else
+            text[i] = rand() % 2 ? '\r' : '\n';
+    }
+
+    if(rand() % 3 == 0)
+    {
+        for(size_t i = 0; i < textSize; i += 1 + rand() % 200)
+        {
+            text[i] = '\r';
+            if(i + 1 < textSize)
+                text[i+1] = '\n';
+        }
+    }
+
+    text[textSize] = 0x0000;
+    return textSize;
+}
+
+size_t _walkPages( const LPM_EditorPageParams * pageParams,
+                   size_t * pageBaseTable,
+                   size_t maxPagesAmount )
+{
+    // Текст кончается нулем внутри массива, массив читается весь
+    const unicode_t * const textEnd = text + MAX_TEXT_SIZE + 1;
+    LPM_TextLineMap lineMap;
+    size_t pagesAmount = 0;
+    size_t pageBase    = 0;
+
+    for(;;)
+    {
+        if(pagesAmount < maxPagesAmount)
+            pageBaseTable[pagesAmount] = pageBase;
+        pagesAmount++;
+
+        // Первая строка страницы, кроме нулевой, - последняя строка предыдущей
+        size_t lineBase = pageBase;
+        if(pagesAmount > 1)
+        {
+            TextOperator_analizeLine( &textOperator, text + lineBase, textEnd,
+                                      pageParams->charAmount, &lineMap );
+            lineBase = lineMap.nextLine - text;
+        }
+
+        size_t lastLineBase = lineBase;
+        for(size_t i = 0; i < pageParams->lineAmount; i++)
+        {
+            lastLineBase = lineBase;
+            if(TextOperator_analizeLine( &textOperator, text + lineBase, textEnd,
+                                         pageParams->charAmount, &lineMap ))
+                return pagesAmount;
+            lineBase = lineMap.nextLine - text;
+        }
+        pageBase = lastLineBase;
+    }
+}
+
+bool _sameResult( size_t pagesAmount1, const size_t * table1,
+                  size_t pagesAmount2, const size_t * table2,
+                  size_t maxPagesAmount )
+{
+    if(pagesAmount1 != pagesAmount2)
+        return false;
+
+    size_t written = pagesAmount1 < maxPagesAmount ? pagesAmount1 : maxPagesAmount;
+    return memcmp(table1, table2, written * sizeof(size_t)) == 0;
+}
@@ -3,15 +3,33 @@
 
 static void writeLine( LPM_UnicodeDisplay * i,
                        size_t index,
-                       const Unicode_Buf * line,
+                       const Unicode_ConstBuf * line,
                        const LPM_SelectionCursor * curs );
 
+static void writeSpan( LPM_UnicodeDisplay * i,
+                       size_t index,
+                       size_t pos,
+                       const Unicode_ConstBuf * span,
+                       const LPM_SelectionCursor * curs );
+
+static void setSelection( LPM_UnicodeDisplay * i,
+                          size_t index,
+                          const LPM_SelectionCursor * curs );
+
 static void clearScreen(LPM_UnicodeDisplay * i);
+static void scroll(LPM_UnicodeDisplay * i, bool up, size_t lineAmount);
+static void beginFrame(LPM_UnicodeDisplay * i);
+static void endFrame(LPM_UnicodeDisplay * i);
 
 static const LPM_UnicodeDisplayFxns fxns =
 {
-    .writeLine   = &writeLine,
-    .clearScreen = &clearScreen
+    .writeLine    = &writeLine,
+    .clearScreen  = &clearScreen,
+    .writeSpan    = &writeSpan,
+    .setSelection = &setSelection,
+    .beginFrame   = &beginFrame,
+    .endFrame     = &endFrame,
+    .scroll       = &scroll
 };
 
 void TestDisplay_init(TestDisplay * dsp, TestDisplayInteractor * itc)
@@ -22,27 +40,90 @@ void TestDisplay_init(TestDisplay * dsp, TestDisplayInteractor * itc)
         .error = LPM_NO_ERROR
     };
     dsp->interactor = itc;
+    dsp->inFrame = false;
+    dsp->frameWriteAmount  = 0;
+    dsp->writeAmount       = 0;
+    dsp->transactionAmount = 0;
+    dsp->spanChrAmount     = 0;
+    dsp->selectionAmount   = 0;
+    dsp->scrollAmount      = 0;
     // ...
 }
 
-static QString unicode_line_to_string(const Unicode_Buf * buf);
+static QString unicode_line_to_string(const Unicode_ConstBuf * buf);
+static void countWrite(TestDisplay * dsp);
 
 void writeLine( LPM_UnicodeDisplay * i,
                 size_t index,
-                const Unicode_Buf * line,
+                const Unicode_ConstBuf * line,
                 const LPM_SelectionCursor * curs )
 {
+    countWrite((TestDisplay*)i);
     ((TestDisplay*)i)->interactor->writeLine( index,
                                               unicode_line_to_string(line),
                                               QPoint(curs->pos, curs->len) );
 }
 
+void writeSpan( LPM_UnicodeDisplay * i,
+                size_t index,
+                size_t pos,
+                const Unicode_ConstBuf * span,
+                const LPM_SelectionCursor * curs )
+{
+    countWrite((TestDisplay*)i);
+    ((TestDisplay*)i)->spanChrAmount += span->size;
+    ((TestDisplay*)i)->interactor->writeSpan( index, pos,
+                                              unicode_line_to_string(span),
+                                              QPoint(curs->pos, curs->len) );
+}
+
+void setSelection( LPM_UnicodeDisplay * i,
+                   size_t index,
+                   const LPM_SelectionCursor * curs )
+{
+    countWrite((TestDisplay*)i);
+    ((TestDisplay*)i)->selectionAmount++;
+    ((TestDisplay*)i)->interactor->setSelection(index, QPoint(curs->pos, curs->len));
+}
+
 void clearScreen(LPM_UnicodeDisplay * i)
 {
+    countWrite((TestDisplay*)i);
     ((TestDisplay*)i)->interactor->clear();
 }
 
-QString unicode_line_to_string(const Unicode_Buf * buf)
+void scroll(LPM_UnicodeDisplay * i, bool up, size_t lineAmount)
+{
+    countWrite((TestDisplay*)i);
+    ((TestDisplay*)i)->scrollAmount++;
+    ((TestDisplay*)i)->interactor->scroll(up, lineAmount);
+}
+
+void beginFrame(LPM_UnicodeDisplay * i)
+{
+    TestDisplay * dsp = (TestDisplay*)i;
+    dsp->inFrame = true;
+    dsp->frameWriteAmount = 0;
+}
+
+void endFrame(LPM_UnicodeDisplay * i)
+{
+    TestDisplay * dsp = (TestDisplay*)i;
+    if(dsp->frameWriteAmount > 0)
+        dsp->transactionAmount++;
+    dsp->inFrame = false;
+}
+
+void countWrite(TestDisplay * dsp)
+{
+    dsp->writeAmount++;
+    if(dsp->inFrame)
+        dsp->frameWriteAmount++;
+    else
+        dsp->transactionAmount++;
+}
+
+QString unicode_line_to_string(const Unicode_ConstBuf * buf)
 {
     QString r(buf->size, 0);
     auto data = buf->data;
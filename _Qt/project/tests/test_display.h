@@ -8,14 +8,53 @@
 
 class TestDisplayInteractor;
 
+/*
+ * Кроме вывода на виджет считает посылки, которые ушли бы на настоящий
+ *  дисплей: каждый вывод вне кадра - отдельная посылка, кадр с выводами -
+ *  одна посылка на весь кадр. Для выводов участков строк (writeSpan)
+ *  считаются еще и выведенные символы, смены одного курсора выделения
+ *  (setSelection) и сдвиги строк (scroll) считаются отдельно.
+ */
 struct TestDisplay
 {
     LPM_UnicodeDisplay base;
     TestDisplayInteractor * interactor;
+    bool inFrame;
+    size_t frameWriteAmount;
+    size_t writeAmount;
+    size_t transactionAmount;
+    size_t spanChrAmount;
+    size_t selectionAmount;
+    size_t scrollAmount;
 };
 
 void TestDisplay_init(TestDisplay * dsp, TestDisplayInteractor * itc);
 
+inline size_t TestDisplay_writeAmount(const TestDisplay * dsp)
+{
+    return dsp->writeAmount;
+}
+
+inline size_t TestDisplay_transactionAmount(const TestDisplay * dsp)
+{
+    return dsp->transactionAmount;
+}
+
+inline size_t TestDisplay_spanChrAmount(const TestDisplay * dsp)
+{
+    return dsp->spanChrAmount;
+}
+
+inline size_t TestDisplay_selectionAmount(const TestDisplay * dsp)
+{
+    return dsp->selectionAmount;
+}
+
+inline size_t TestDisplay_scrollAmount(const TestDisplay * dsp)
+{
+    return dsp->scrollAmount;
+}
+
 inline LPM_UnicodeDisplay * TestDisplay_base(TestDisplay * dsp)
 {
     return &dsp->base;
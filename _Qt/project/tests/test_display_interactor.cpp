@@ -58,6 +58,7 @@ void TestDisplayInteractor::clear()
 
 void TestDisplayInteractor::writeLine(int index, QString line, QPoint curs)
 {
+    vm.data[index] = line;
     html[index] = TestDisplayHtmlConvertor::convertLine(line, curs, selectAreaUnderlined);
     for(auto & sym : html[index])
     {
@@ -69,16 +70,53 @@ void TestDisplayInteractor::writeLine(int index, QString line, QPoint curs)
 
     if(latencyEnabled)
         QThread::msleep(12);
-    //QString text = "<PRE><span style=\" color:#FABD05;\">"; //#FFC90E
-    QString text = "<span style=\" color:#FABD05;\">"; //#FFC90E
-    for(const auto & line : html)
-        text += line;
-    //text += "</span></PRE>";
-    text += "</span>";
-    emit _htmlTextChanged(text);
+    emitHtmlText();
     emit _lineUpdated(index);
 }
 
+// Символы строки с позиции pos заменяются, остальные остаются прежними
+void TestDisplayInteractor::writeSpan(int index, int pos, QString span, QPoint curs)
+{
+    QString line = vm.data[index];
+    if(line.size() < pos + span.size())
+        line = line.leftJustified(pos + span.size(), ' ');
+    line.replace(pos, span.size(), span);
+    writeLine(index, line, curs);
+}
+
+void TestDisplayInteractor::setSelection(int index, QPoint curs)
+{
+    writeLine(index, vm.data[index], curs);
+}
+
+// Строки сдвигаются вместе с выделением (оно уже в html строк), открывшиеся
+//  строки пустые - редактор выводит их заново
+void TestDisplayInteractor::scroll(bool up, int lineAmount)
+{
+    lineAmount = qMin(lineAmount, vm.lineAmount);
+    for(int i = 0; i < lineAmount; i++)
+    {
+        if(up)
+        {
+            vm.data.removeFirst();
+            vm.data.append(QString());
+            html.removeFirst();
+            html.append(QString());
+        }
+        else
+        {
+            vm.data.removeLast();
+            vm.data.prepend(QString());
+            html.removeLast();
+            html.prepend(QString());
+        }
+    }
+
+    if(latencyEnabled)
+        QThread::msleep(12);
+    emitHtmlText();
+}
+
 QString TestDisplayInteractor::toString() const
 {
     return vm.toString();
@@ -111,3 +149,14 @@ void TestDisplayInteractor::waitForGuiRepaint()
     emit _htmlTextChanged(html);
     //loop.exec();
 }
+
+void TestDisplayInteractor::emitHtmlText()
+{
+    //QString text = "<PRE><span style=\" color:#FABD05;\">"; //#FFC90E
+    QString text = "<span style=\" color:#FABD05;\">"; //#FFC90E
+    for(const auto & line : html)
+        text += line;
+    //text += "</span></PRE>";
+    text += "</span>";
+    emit _htmlTextChanged(text);
+}
@@ -16,6 +16,9 @@ public:
                                     QObject * parent = nullptr );
     void clear();
     void writeLine(int index, QString line, QPoint curs);
+    void writeSpan(int index, int pos, QString span, QPoint curs);
+    void setSelection(int index, QPoint curs);
+    void scroll(bool up, int lineAmount);
 
     QString toString() const;
 
@@ -36,6 +39,7 @@ private:
     QStringList html;
 
     void waitForGuiRepaint();    
+    void emitHtmlText();
 };
 
 #endif // TEST_DISPLAY_INTERACTOR_H
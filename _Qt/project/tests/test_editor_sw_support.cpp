@@ -1,5 +1,6 @@
 #include "test_editor_sw_support.h"
 #include <QDebug>
+#include <QVector>
 
 extern "C"
 {
@@ -8,6 +9,7 @@ extern "C"
 #include "lpm_meteo_api.h"
 #include "lpm_gui_texts_api.h"
 #include "lang_rus_eng.h"
+#include "encoding.h"
 
 }
 
@@ -16,14 +18,12 @@ static const size_t UNDO_BUFFER_SIZE = 4096;
 static const size_t CLIPBOARD_SIZE = 4096;
 static const size_t INSERTIONS_BUFFER_SIZE = 4096;
 static const size_t RECOVERY_BUFFER_SIZE = 4096;
-static const size_t HEAP_SIZE = 1200;
 
 static uint32_t textBuffer[TEXT_BUFFER_SIZE/4];
 static uint32_t undoBuffer[UNDO_BUFFER_SIZE/4];
 static uint32_t clipboard[CLIPBOARD_SIZE/4];
 static uint32_t insertionsBuffer[INSERTIONS_BUFFER_SIZE/4];
 static uint32_t recoveryBuffer[RECOVERY_BUFFER_SIZE/4];
-static uint32_t heap[HEAP_SIZE/4];
 
 static const size_t MAX_METEO_SIZE = 14000;
 static const size_t MAX_FAX_CHAIN_SIZE = 14000;
@@ -45,6 +45,7 @@ static const LPM_EndlType DEFAULT_END_OF_LINE_TYPE = LPM_ENDL_TYPE_CRLF;
 static const LPM_insertionInputPolicy INSERTION_INPUT_POLICY = LPM_INSERTION_INPUT_POLICY_NO_INPUT;
 static const uint32_t KEYBOARD_TIMEOUT = 1000;
 static const uint8_t TAB_SPACE_AMOUNT = 5;
+static const char * const TEXT_FILE_NAME = NULL;
 
 static const LPM_EditorSettings editorSettings =
 {
@@ -53,7 +54,7 @@ static const LPM_EditorSettings editorSettings =
     { (uint8_t*)clipboard,        CLIPBOARD_SIZE         },
     { (uint8_t*)insertionsBuffer, INSERTIONS_BUFFER_SIZE },
     { (uint8_t*)recoveryBuffer,   RECOVERY_BUFFER_SIZE   },
-    { (uint8_t*)heap, HEAP_SIZE },
+    { NULL, 0 }, // куча - в readSettings
     MAX_METEO_SIZE,
     MAX_FAX_CHAIN_SIZE,
     MAX_TEMPLATE_SIZE,
@@ -71,12 +72,24 @@ static const LPM_EditorSettings editorSettings =
     INSERTION_BORDER_CHAR,
     DEFAULT_END_OF_LINE_TYPE,
     INSERTION_INPUT_POLICY,
-    TAB_SPACE_AMOUNT
+    TAB_SPACE_AMOUNT,
+    TEXT_FILE_NAME
 };
 
 bool TestEditorSwSupport::readSettings(LPM_EditorSettings * setting)
 {
     *setting = editorSettings;
+
+    // Размер кучи зависит от частей редактора, включенных при сборке, поэтому
+    //  берется у самого редактора (QVector<size_t> - чтобы куча была выровнена)
+    static QVector<size_t> heap;
+    LPM_EditorSystemParams params = {};
+    params.settings = setting;
+    size_t heapSize = LPM_API_getDesiredHeapSize(&params);
+    heap.resize((heapSize + sizeof(size_t) - 1) / sizeof(size_t));
+    setting->heap.data = (uint8_t*)heap.data();
+    setting->heap.size = heap.size() * sizeof(size_t);
+
     qDebug() << (int)textBuffer;
     return true;
 }
@@ -102,34 +115,14 @@ bool TestEditorSwSupport::readSupportFxns(LPM_SupportFxns * fxns, LPM_Lang lang)
         qDebug() << "Преобразую текст в метеосообщение формата" << format;
     };
 
-    auto encodingCheckText = [](const LPM_Buf * text, LPM_Encoding encoding, size_t maxTextSize, bool ignoreSpecChars)
-    {
-        Q_UNUSED(text);
-        qDebug() << "Проверяю текст размером:" << maxTextSize
-                 << "на соотвествие кодировке:" << encoding << "спец. символы"
-                 << (ignoreSpecChars ? "считаю текстом" : "не считаю текстом");
-        return true;
-    };
-
-    auto encodingFromUnicode = [](const LPM_Buf * text, LPM_Encoding encoding)
-    {
-        Q_UNUSED(text);
-        qDebug() << "Перекодирую из кодировки" << encoding << "в UCS2-LE";
-    };
-
-    auto encodingToUnicode = [](const LPM_Buf * text, LPM_Encoding encoding)
-    {
-        Q_UNUSED(text);
-        qDebug() << "Перекодирую из UCS2-LE в кодировку" << encoding;
-    };
-
     fxns->meteo->checkFormat = meteoCheckFormat;
     fxns->meteo->fromMeteo   = fromMeteo;
     fxns->meteo->toMeteo     = toMeteo;
 
-    fxns->encoding->checkText   = encodingCheckText;
-    fxns->encoding->toUnicode   = encodingToUnicode;
-    fxns->encoding->fromUnicode = encodingFromUnicode;
+    fxns->encoding->checkText   = &Encoding_checkText;
+    fxns->encoding->toUnicode   = &Encoding_toUnicode;
+    fxns->encoding->fromUnicode = &Encoding_fromUnicode;
+    fxns->encoding->checkTextAndToUnicode = &Encoding_checkTextAndToUnicode;
 
     if(lang == LPM_LANG_RUS_ENG)
     {
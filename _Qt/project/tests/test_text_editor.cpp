@@ -99,6 +99,11 @@ void TestTextEditor::start(const Param & param)
             arr.append((uint8_t)result);
             qDebug() << "Работа завершена с ошибкой:" << arr.toHex();
         }
+        qDebug() << "Выводов на дисплей:" << TestDisplay_writeAmount(&dsp)
+                 << "посылок:" << TestDisplay_transactionAmount(&dsp)
+                 << "символов в участках строк:" << TestDisplay_spanChrAmount(&dsp)
+                 << "смен выделения:" << TestDisplay_selectionAmount(&dsp)
+                 << "сдвигов строк:" << TestDisplay_scrollAmount(&dsp);
 
         fileImpl.save("template_file.bin");
 
@@ -5,6 +5,9 @@
 #include <QTextStream>
 #include <QTextCodec>
 #include <QVector>
+#if defined(TEXT_STORAGE_IMPL_MMAP)
+#include <QTemporaryFile>
+#endif
 
 extern "C" {
 #include "text_storage.h"
@@ -13,6 +16,38 @@ extern "C" {
 const QChar textNullChr = QChar::Null;
 const QChar logNullChr  = 0x25A3;
 
+// Реализация хранилища выбирается при сборке (text_storage_impl.h), и тесты
+//  хранилища проверяют ту, с которой собран проект. Чтобы проверить все
+//  реализации, проект собирается с каждым из макросов TEXT_STORAGE_IMPL_*
+static const char * storageImplName()
+{
+#if defined(TEXT_STORAGE_IMPL_GAP_BUFFER)
+    return "буфер с разрывом";
+#elif defined(TEXT_STORAGE_IMPL_PIECE_TABLE)
+    return "таблица кусков";
+#elif defined(TEXT_STORAGE_IMPL_ROPE)
+    return "канат";
+#elif defined(TEXT_STORAGE_IMPL_PAGED)
+    return "кэш страниц";
+#elif defined(TEXT_STORAGE_IMPL_MMAP)
+    return "отображение файла";
+#else
+    return "сплошной буфер";
+#endif
+}
+
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+// Канату нужна куча под куски. Хранилища в тестах не живут одновременно, поэтому
+//  куча одна на все (QVector<size_t> - чтобы куски были выровнены)
+static void * ropeHeap(size_t textBufferSize)
+{
+    static QVector<size_t> heap;
+    size_t heapSize = TextStorageImpl_calcHeapSize(textBufferSize);
+    heap.resize(static_cast<int>((heapSize + sizeof(size_t) - 1) / sizeof(size_t)));
+    return heap.data();
+}
+#endif
+
 void TextOperatorAndStorageTester::exec( const QString & logFileName,
                                          size_t maxSize,
                                          bool fullLog )
@@ -71,6 +106,9 @@ void TextOperatorAndStorageTester::exec( const QString & logFileName,
         fillUnicodeBuf(txtIns, bfrIns);
         TextStorage op;
         TextStorageImpl impl;
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+        TextStorageImpl_setHeap(&impl, ropeHeap(bfrSrc.size), bfrSrc.size);
+#endif
         TextStorageImpl_init(&impl, &bfrSrc);
         //TextStorage_init(&op, &);
         LPM_SelectionCursor rmar = { .pos = (size_t)rmawrPos, .len = (size_t)rmLen };
@@ -115,11 +153,15 @@ void TextOperatorAndStorageTester::testStorage(const QString & logFileName)
     QString src = createText(5, 5, true);
     QString mod = src;
     mod.replace(5, 1, createText(2,2,false));
-    QString log;
+    QString log = QString("Хранилище: ") + storageImplName() + "\n\n";
     log += testStorageCalcEndOfText();
     log += testStorageAppend();
     log += testStorageInsert();
     log += testStorageReplace();
+    log += testStorageEditSequence();
+#if defined(TEXT_STORAGE_IMPL_MMAP)
+    log += testStorageMappedFile();
+#endif
     // ...
     writeLog(log, logFileName);
 }
@@ -143,6 +185,9 @@ QString TextOperatorAndStorageTester::testStorageCalcEndOfTextStep(int textSize,
     TextStorageImpl strg;
     Unicode_Buf bfr;
     fillUnicodeBuf(text, bfr);
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    TextStorageImpl_setHeap(&strg, ropeHeap(bfr.size), bfr.size);
+#endif
     TextStorageImpl_init(&strg, &bfr);
     size_t calcedEndOfText = TextStorageImpl_endOfText(&strg);
     size_t actualEndOfText = textSize;
@@ -184,13 +229,20 @@ QString TextOperatorAndStorageTester::testStorageAppendStep(int textSize, int ap
     Unicode_Buf apndBfr;
     fillUnicodeBuf(srcText, srcBfr);
     fillUnicodeBuf(apndText, apndBfr);
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    TextStorageImpl_setHeap(&strg, ropeHeap(srcBfr.size), srcBfr.size);
+#endif
     TextStorageImpl_init(&strg, &srcBfr);
     QString log = QString("До: ") + prepareToLog(srcText) + ", " +
             QString::number(textSize) + " ";
     TextStorageImpl_append(&strg, &apndBfr);
+    TextStorageImpl_sync(&strg);
+    QString expected = createText(textSize, textSize, true) + apndText;
     log += QString("После: ") + prepareToLog(srcText) + ", " +
             QString::number(TextStorageImpl_endOfText(&strg)) + " ";
-    log += QString("Добавлено: ") + QString::number(appendSize);
+    log += QString("Добавлено: ") + QString::number(appendSize) + " ";
+    log += QString("Пройдено: ") +
+            yesOrNo(checkText(srcText, expected, TextStorageImpl_endOfText(&strg)));
     return log;
 }
 
@@ -248,13 +300,20 @@ QString TextOperatorAndStorageTester::testStorageInsertStep(int textSize, int in
     Unicode_Buf insBfr;
     fillUnicodeBuf(srcTxt, srcBfr);
     fillUnicodeBuf(insTxt, insBfr);
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    TextStorageImpl_setHeap(&strg, ropeHeap(srcBfr.size), srcBfr.size);
+#endif
     TextStorageImpl_init(&strg, &srcBfr);
     QString log = QString("До: ") + prepareToLog(srcTxt) + ", " +
             QString::number(textSize) + " ";
     TextStorageImpl_insert(&strg, &insBfr, insPos);
+    TextStorageImpl_sync(&strg);
+    QString expected = createText(textSize, textSize, true).insert(insPos, insTxt);
     log += QString("После: ") + prepareToLog(srcTxt) + ", " +
             QString::number(TextStorageImpl_endOfText(&strg)) + " ";
-    log += QString("Вставлено: ") + QString::number(insSize);
+    log += QString("Вставлено: ") + QString::number(insSize) + " ";
+    log += QString("Пройдено: ") +
+            yesOrNo(checkText(srcTxt, expected, TextStorageImpl_endOfText(&strg)));
     return log;
 }
 
@@ -299,16 +358,225 @@ QString TextOperatorAndStorageTester::testStorageReplaceStep(int textSize, int r
     Unicode_Buf rplBfr;
     fillUnicodeBuf(srcTxt, srcBfr);
     fillUnicodeBuf(rplTxt, rplBfr);
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    TextStorageImpl_setHeap(&strg, ropeHeap(srcBfr.size), srcBfr.size);
+#endif
     TextStorageImpl_init(&strg, &srcBfr);
     QString log = QString("До: ") + prepareToLog(srcTxt) + ", " +
             QString::number(textSize) + " ";
     TextStorageImpl_replace(&strg, &rplBfr, rplPos);
+    TextStorageImpl_sync(&strg);
+    QString expected = createText(textSize, textSize, true).replace(rplPos, rplSize, rplTxt);
     log += QString("После: ") + prepareToLog(srcTxt) + ", " +
             QString::number(TextStorageImpl_endOfText(&strg)) + " ";
-    log += QString("Заменено: ") + QString::number(rplSize);
+    log += QString("Заменено: ") + QString::number(rplSize) + " ";
+    log += QString("Пройдено: ") +
+            yesOrNo(checkText(srcTxt, expected, TextStorageImpl_endOfText(&strg)));
+    return log;
+}
+
+// Вставки, удаления и замены вперемешку в разных местах текста: в буфере с
+//  разрывом разрыв переносится то вперед, то назад. Правки сверяются с той же
+//  правкой QString после каждого шага (чтением текста) и в конце (в буфере
+//  текста после TextStorageImpl_sync)
+QString TextOperatorAndStorageTester::testStorageEditSequence()
+{
+    QString log = QString("Тест последовательности правок:\n");
+    log += testStorageEditSequenceStep(20,  200,  3) + "\n";
+    log += testStorageEditSequenceStep(64,  500,  8) + "\n";
+    log += testStorageEditSequenceStep(512, 2000, 40) + "\n";
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    // Текст на полтора десятка кусков, правки длиннее куска: куски делятся,
+    //  сливаются, а дерево перебалансируется
+    log += testStorageEditSequenceStep( TEXT_STORAGE_IMPL_CHUNK_SIZE*16, 2000,
+                                        TEXT_STORAGE_IMPL_CHUNK_SIZE*2 ) + "\n";
+#endif
+#if defined(TEXT_STORAGE_IMPL_PAGED)
+    // Текст длиннее, чем помещается в кэш: страницы вытесняются и
+    //  перечитываются из хранилища
+    log += testStorageEditSequenceStep( TEXT_STORAGE_IMPL_PAGE_SIZE*TEXT_STORAGE_IMPL_PAGES_AMOUNT*4,
+                                        2000, TEXT_STORAGE_IMPL_PAGE_SIZE ) + "\n";
+#endif
+#if defined(TEXT_STORAGE_IMPL_PIECE_TABLE)
+    // Правок больше, чем кусков в таблице, а вставленного текста больше, чем
+    //  места в буфере добавлений: куски несколько раз собираются в буфер текста
+    log += testStorageEditSequenceStep( TEXT_STORAGE_IMPL_ADD_BUFFER_SIZE*2,
+                                        TEXT_STORAGE_IMPL_PIECES_AMOUNT*8, 64 ) + "\n";
+#endif
+    log += "\n";
     return log;
 }
 
+QString TextOperatorAndStorageTester::testStorageEditSequenceStep(int bufSize, int opsAmount, int maxOpSize)
+{
+    QString srcTxt = createText(0, bufSize, true);
+    QString model;
+    TextStorageImpl strg;
+    Unicode_Buf srcBfr;
+    fillUnicodeBuf(srcTxt, srcBfr);
+#if defined(TEXT_STORAGE_IMPL_ROPE)
+    TextStorageImpl_setHeap(&strg, ropeHeap(srcBfr.size), srcBfr.size);
+#endif
+    TextStorageImpl_init(&strg, &srcBfr);
+
+    uint32_t rnd = 1;
+    auto nextRnd = [&rnd](int range)
+    {
+        rnd = rnd * 1103515245u + 12345u;
+        return range > 0 ? static_cast<int>((rnd >> 8) % static_cast<uint32_t>(range)) : 0;
+    };
+
+    bool passed = true;
+    int failedOp = -1;
+    for(int op = 0; op < opsAmount && passed; op++)
+    {
+        int pos = nextRnd(model.size() + 1);
+        int len = nextRnd(maxOpSize) + 1;
+        QString txt;
+        for(int i = 0; i < len; i++)
+            txt += QChar('a' + (op + i) % 26);
+        Unicode_Buf txtBfr;
+        fillUnicodeBuf(txt, txtBfr);
+
+        switch(nextRnd(3))
+        {
+        case 0:
+            if(model.size() + len >= bufSize)
+                break;
+            TextStorageImpl_insert(&strg, &txtBfr, pos);
+            model.insert(pos, txt);
+            break;
+        case 1:
+            if(pos + len > model.size())
+                len = model.size() - pos;
+            TextStorageImpl_remove(&strg, pos, len);
+            model.remove(pos, len);
+            break;
+        default:
+            if(pos + len > model.size())
+                break;
+            TextStorageImpl_replace(&strg, &txtBfr, pos);
+            model.replace(pos, len, txt);
+            break;
+        }
+
+        QString readTxt(model.size(), textNullChr);
+        Unicode_Buf readBfr;
+        fillUnicodeBuf(readTxt, readBfr);
+        TextStorageImpl_read(&strg, 0, &readBfr);
+        passed = TextStorageImpl_endOfText(&strg) == static_cast<size_t>(model.size()) &&
+                 readTxt == model;
+        if(!passed)
+            failedOp = op;
+    }
+
+#if defined(TEXT_STORAGE_IMPL_PAGED)
+    const TextStorageImpl_CacheStats * stats = TextStorageImpl_cacheStats(&strg);
+    QString cacheLog = QString("Страниц прочитано: ") + QString::number(stats->pageReads) +
+            ", записано: " + QString::number(stats->pageWrites) + " ";
+#endif
+    if(passed)
+    {
+        TextStorageImpl_sync(&strg);
+        passed = checkText(srcTxt, model, TextStorageImpl_endOfText(&strg));
+    }
+
+    QString log = QString("Буфер: ") + QString::number(bufSize) + " ";
+    log += QString("Правок: ") + QString::number(opsAmount) + " ";
+    log += QString("Конец текста: ") + QString::number(TextStorageImpl_endOfText(&strg)) +
+            "(" + QString::number(model.size()) + ") ";
+#if defined(TEXT_STORAGE_IMPL_PAGED)
+    log += cacheLog;
+#endif
+    if(failedOp >= 0)
+        log += QString("Ошибка на правке ") + QString::number(failedOp) + " ";
+    log += QString("Пройдено: ") + yesOrNo(passed);
+    return log;
+}
+
+#if defined(TEXT_STORAGE_IMPL_MMAP)
+// Текст записывается в файл (UCS-2LE, без завершающего нуля) и отображается
+//  сначала для просмотра - текст читается из файла как есть и не выгружается в
+//  буфер текста, - затем для правки: правки идут в отображении и выгружаются
+//  TextStorageImpl_sync, а сам файл не меняется
+QString TextOperatorAndStorageTester::testStorageMappedFile()
+{
+    const int bufSize = 20;
+    QString log = QString("Тест отображения файла:\n");
+    log += testStorageMappedFileStep(0,         1,         0,         bufSize) + "\n";
+    log += testStorageMappedFileStep(1,         1,         0,         bufSize) + "\n";
+    log += testStorageMappedFileStep(1,         1,         1,         bufSize) + "\n";
+    log += testStorageMappedFileStep(bufSize/2, 1,         bufSize/4, bufSize) + "\n";
+    log += testStorageMappedFileStep(bufSize/2, bufSize/4, bufSize/2, bufSize) + "\n";
+    log += testStorageMappedFileStep(bufSize-2, 1,         0,         bufSize) + "\n";
+    // Файл на несколько страниц памяти: место под рост текста начинается
+    //  внутри страницы с концом файла
+    log += testStorageMappedFileStep(3000,      100,       1500,      4096) + "\n";
+    log += "\n";
+    return log;
+}
+
+QString TextOperatorAndStorageTester::testStorageMappedFileStep(int textSize, int editSize, int editPos, int bufSize)
+{
+    QString fileTxt = createText(textSize, textSize, true);
+    QByteArray fileData;
+    for(const QChar & chr : fileTxt)
+    {
+        fileData.append(static_cast<char>(chr.unicode() & 0xFF));
+        fileData.append(static_cast<char>(chr.unicode() >> 8));
+    }
+    QTemporaryFile file;
+    if(!file.open() || file.write(fileData) != fileData.size() || !file.flush())
+        return QString("Не удалось записать файл ") + file.fileName();
+    QByteArray fileName = QFile::encodeName(file.fileName());
+
+    QString srcTxt = createText(0, bufSize, true);
+    QString edtTxt = createText(editSize, editSize, false);
+    TextStorageImpl strg;
+    Unicode_Buf srcBfr;
+    Unicode_Buf edtBfr;
+    fillUnicodeBuf(srcTxt, srcBfr);
+    fillUnicodeBuf(edtTxt, edtBfr);
+    TextStorageImpl_init(&strg, &srcBfr);
+
+    bool viewMapped = TextStorageImpl_mapFile(&strg, fileName.constData(), false);
+    QString viewTxt(textSize, textNullChr);
+    Unicode_Buf viewBfr;
+    fillUnicodeBuf(viewTxt, viewBfr);
+    TextStorageImpl_read(&strg, 0, &viewBfr);
+    size_t viewEndOfText = TextStorageImpl_endOfText(&strg);
+    TextStorageImpl_sync(&strg);
+    bool viewPassed = viewMapped &&
+                      viewEndOfText == static_cast<size_t>(textSize) &&
+                      viewTxt == fileTxt &&
+                      srcTxt == createText(0, bufSize, true);
+
+    bool editMapped = TextStorageImpl_mapFile(&strg, fileName.constData(), true);
+    QString expected = fileTxt;
+    TextStorageImpl_insert(&strg, &edtBfr, editPos);
+    expected.insert(editPos, edtTxt);
+    TextStorageImpl_replace(&strg, &edtBfr, 0);
+    expected.replace(0, editSize, edtTxt);
+    TextStorageImpl_append(&strg, &edtBfr);
+    expected += edtTxt;
+    TextStorageImpl_sync(&strg);
+    size_t editEndOfText = TextStorageImpl_endOfText(&strg);
+    TextStorageImpl_unmapFile(&strg);
+    bool editPassed = editMapped && checkText(srcTxt, expected, editEndOfText);
+
+    file.seek(0);
+    bool fileKept = file.readAll() == fileData;
+
+    QString log = QString("Текст: ") + QString::number(textSize) + " ";
+    log += QString("Просмотр: ") + yesOrNo(viewPassed) + " ";
+    log += QString("Правка: ") + yesOrNo(editPassed) + ", " +
+            QString::number(editEndOfText) + "(" + QString::number(expected.size()) + ") ";
+    log += QString("Файл не изменен: ") + yesOrNo(fileKept) + " ";
+    log += QString("Пройдено: ") + yesOrNo(viewPassed && editPassed && fileKept);
+    return log;
+}
+#endif
+
 void TextOperatorAndStorageTester::writeLog( QString & logData,
                                              const QString & logFileName)
 {
@@ -342,6 +610,19 @@ QString TextOperatorAndStorageTester::yesOrNo(bool condition)
     return condition ? QString("Да") : QString("Нет");
 }
 
+// Текст в буфере после TextStorageImpl_sync: ожидаемый текст, за ним - конец
+//  текста (если в буфере есть место)
+bool TextOperatorAndStorageTester::checkText( const QString & text,
+                                              const QString & expected,
+                                              size_t endOfText )
+{
+    if(endOfText != static_cast<size_t>(expected.size()))
+        return false;
+    if(text.left(expected.size()) != expected)
+        return false;
+    return text.size() == expected.size() || text[expected.size()] == textNullChr;
+}
+
 QString TextOperatorAndStorageTester::createText(int textSize, int bufSize, bool numbers)
 {
     QString text(bufSize, textNullChr);
@@ -27,10 +27,19 @@ private:
     QString testStorageReplace();
     QString testStorageReplaceStep(int textSize, int rplSize, int rplPos, int bufSize);
 
+    QString testStorageEditSequence();
+    QString testStorageEditSequenceStep(int bufSize, int opsAmount, int maxOpSize);
+
+#if defined(TEXT_STORAGE_IMPL_MMAP)
+    QString testStorageMappedFile();
+    QString testStorageMappedFileStep(int textSize, int editSize, int editPos, int bufSize);
+#endif
+
     void writeLog(QString & logData, const QString & logFileName);
     void fillUnicodeBuf(QString & text, Unicode_Buf & buf);
     QString prepareToLog(const QString & text);
     QString yesOrNo(bool condition);
+    bool checkText(const QString & text, const QString & expected, size_t endOfText);
     QString createText(int textSize, int bufSize, bool numbers);
     void correctText(QString & text);
 };
@@ -0,0 +1,163 @@
+/*
+ * Сверка вариантов просмотра текста (text_scan.c) со скалярным: поиск конца
+ *  текста и конца строки, последнего конца строки и последнего пробела,
+ *  подсчет концов строк (всех и по видам). Тексты случайные (с постоянным
+ *  начальным числом): буквы, пробелы, CR, LF, пары CR LF, нулевые символы и
+ *  символы с теми же младшими байтами, что у пробела, CR и LF. Диапазоны берутся с произвольным началом и длиной - так проверяются
+ *  невыровненные векторы и хвосты короче вектора; символ за диапазоном -
+ *  следующий символ текста или нулевой.
+ * Проверяются все варианты, которые есть в сборке и поддерживает процессор.
+ * Отдельная программа на C, в проект Qt не входит. Сборка и запуск:
+ *  gcc -std=c99 -O2 -I../editor_core -I../editor_api -I../system
+ *      text_scan_check.c ../editor_core/text_scan.c -o text_scan_check
+ *  ./text_scan_check [количество текстов]
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "text_scan.h"
+
+#define MAX_TEXT_SIZE       300
+#define DEFAULT_RUNS        20000
+
+typedef struct ScanResult
+{
+    size_t endOfText;
+    size_t endOfLine;
+    size_t lastEndOfLine;
+    size_t lastSpace;
+    size_t endsOfLine;
+    TextScan_EndlCount endlCount;
+} ScanResult;
+
+static const TextScan_Variant variants[] =
+{
+    TEXT_SCAN_SSE2,
+    TEXT_SCAN_AVX2,
+    TEXT_SCAN_NEON
+};
+
+static const char * variantNames[] = { "scalar", "SSE2", "AVX2", "NEON" };
+
+static unicode_t text[MAX_TEXT_SIZE];
+
+static size_t _fillText(void);
+static void _scan( const unicode_t * begin,
+                   const unicode_t * end,
+                   unicode_t nextChr,
+                   ScanResult * result );
+static bool _sameResult(const ScanResult * r1, const ScanResult * r2);
+
+int main(int argc, char ** argv)
+{
+    const int runs = argc > 1 ? atoi(argv[1]) : DEFAULT_RUNS;
+    size_t variantsAmount = 0;
+    int failed = 0;
+
+    for(size_t v = 0; v < sizeof(variants)/sizeof(variants[0]); v++)
+    {
+        if(!TextScan_init(variants[v]))
+            continue;
+        printf("Вариант %s\n", variantNames[variants[v]]);
+        variantsAmount++;
+    }
+
+    srand(1);
+
+    for(int run = 0; run < runs; run++)
+    {
+        size_t textSize = _fillText();
+        size_t beginPos = rand() % (textSize + 1);
+        size_t endPos   = beginPos + rand() % (textSize - beginPos + 1);
+        const unicode_t * begin = text + beginPos;
+        const unicode_t * end   = text + endPos;
+        unicode_t nextChr = endPos < textSize && rand() % 4 != 0 ? text[endPos] : 0x0000;
+
+        ScanResult scalar;
+        TextScan_init(TEXT_SCAN_SCALAR);
+        _scan(begin, end, nextChr, &scalar);
+
+        for(size_t v = 0; v < sizeof(variants)/sizeof(variants[0]); v++)
+        {
+            if(!TextScan_init(variants[v]))
+                continue;
+
+            ScanResult result;
+            _scan(begin, end, nextChr, &result);
+            if(!_sameResult(&scalar, &result))
+            {
+                printf( "Расхождение в тексте %d: вариант %s, диапазон %zu-%zu, "
+                        "символ за ним %04X\n",
+                        run, variantNames[variants[v]], beginPos, endPos, nextChr );
+                failed++;
+            }
+        }
+    }
+
+    printf( "Текстов: %d, векторных вариантов: %zu, расхождений: %d\n",
+            runs, variantsAmount, failed );
+    return failed == 0 ? 0 : 1;
+}
+
+// В части текстов концов строк и нулевых символов (или пробелов) нет совсем -
+//  тогда векторы просматриваются до конца (начала) диапазона
+size_t _fillText(void)
+{
+    size_t textSize = rand() % MAX_TEXT_SIZE;
+    int special = rand() % 4 == 0 ? 0 : 1 + rand() % 30;
+    int spaces  = rand() % 4 == 0 ? 0 : 1 + rand() % 50;
+
+    for(size_t i = 0; i < textSize; i++)
+    {
+        int r = rand() % 100;
+        if(r >= special)
+        {
+            if(rand() % 100 >= spaces)
+                text[i] = 'a' + rand() % 26;
+            else
+                text[i] = rand() % 8 ? 0x0020 : 0x2020;
+        }
+        else if(r % 6 == 0)
+            text[i] = 0x0000;
+        else if(r % 6 == 1)
+            text[i] = 0x000D;
+        else if(r % 6 == 2)
+            text[i] = 0x000A;
+        else if(r % 6 == 3)
+            text[i] = rand() % 2 ? 0x0D0D : 0x0A0A;
+        else
+        {
+            text[i] = 0x000D;
+            if(i + 1 < textSize)
+                text[++i] = 0x000A;
+        }
+    }
+    return textSize;
+}
+
+void _scan( const unicode_t * begin,
+            const unicode_t * end,
+            unicode_t nextChr,
+            ScanResult * result )
+{
+    result->endOfText     = TextScan_findEndOfText(begin, end) - begin;
+    result->endOfLine     = TextScan_findEndOfLine(begin, end) - begin;
+    result->lastEndOfLine = TextScan_findLastEndOfLine(begin, end) - begin;
+    result->lastSpace     = TextScan_findLastSpace(begin, end) - begin;
+    result->endsOfLine    = TextScan_countEndsOfLine(begin, end, nextChr);
+    TextScan_countEndlTypes(begin, end, nextChr, &result->endlCount);
+}
+
+bool _sameResult(const ScanResult * r1, const ScanResult * r2)
+{
+    return r1->endOfText      == r2->endOfText      &&
+           r1->endOfLine      == r2->endOfLine      &&
+           r1->lastEndOfLine  == r2->lastEndOfLine  &&
+           r1->lastSpace      == r2->lastSpace      &&
+           r1->endsOfLine     == r2->endsOfLine     &&
+           r1->endlCount.cr   == r2->endlCount.cr   &&
+           r1->endlCount.lf   == r2->endlCount.lf   &&
+           r1->endlCount.crLf == r2->endlCount.crLf;
+}